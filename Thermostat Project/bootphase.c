@@ -0,0 +1,44 @@
+/*
+ *  ======== bootphase.c ========
+ *  Boot timeline, see bootphase.h.
+ */
+#include <stdint.h>
+
+#include "bootphase.h"
+#include "cyclecount.h"
+
+static const char *const names[BOOT_PHASES] = {
+    [BOOT_UART] = "uart",
+    [BOOT_SENSORS] = "sensors",
+    [BOOT_GPIO] = "gpio",
+    [BOOT_FIRST_HEAT] = "first heat",
+    [BOOT_LOG] = "log",
+    [BOOT_UPLINK] = "uplink",
+    [BOOT_SCHEDULER] = "scheduler",
+};
+
+static uint32_t startCycles;
+static uint32_t marks[BOOT_PHASES];
+
+void bootPhaseStart(void)
+{
+    cycleCountInit();
+    startCycles = cycleCount();
+}
+
+void bootPhaseMark(enum BOOT_PHASES phase)
+{
+    uint32_t us = (cycleCount() - startCycles) / CYCLES_PER_US;
+
+    marks[phase] = us != 0 ? us : 1;    // 0 is "not reached"
+}
+
+uint32_t bootPhaseUs(enum BOOT_PHASES phase)
+{
+    return marks[phase];
+}
+
+const char *bootPhaseName(enum BOOT_PHASES phase)
+{
+    return names[phase];
+}
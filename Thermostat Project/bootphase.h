@@ -0,0 +1,34 @@
+/*
+ *  ======== bootphase.h ========
+ *  Boot timeline: when each init step of mainThread finished.
+ *
+ *  Each mark is the cycle count (cyclecount.h) at the end of a step,
+ *  kept as microseconds since bootPhaseStart() at the top of mainThread.
+ *  The ROM bootloader's time from reset to main, which loads the image
+ *  from the serial flash, comes before that and is not counted. The
+ *  core stays awake through init, so the counter covers every step.
+ */
+#ifndef BOOTPHASE_H_
+#define BOOTPHASE_H_
+
+#include <stdint.h>
+
+enum BOOT_PHASES {
+    BOOT_UART,          // UART open, DISPLAY draining
+    BOOT_SENSORS,       // I2C open, sensors found and configured
+    BOOT_GPIO,          // outputs and buttons configured
+    BOOT_FIRST_HEAT,    // first heat decision written to the outputs
+    BOOT_LOG,           // history log found on flash
+    BOOT_UPLINK,        // uplink queue restored
+    BOOT_SCHEDULER,     // tick timer running
+    BOOT_PHASES
+};
+
+extern void bootPhaseStart(void);
+extern void bootPhaseMark(enum BOOT_PHASES phase);
+
+/* Microseconds from bootPhaseStart() to the phase, or 0 if not reached */
+extern uint32_t bootPhaseUs(enum BOOT_PHASES phase);
+extern const char *bootPhaseName(enum BOOT_PHASES phase);
+
+#endif /* BOOTPHASE_H_ */
@@ -0,0 +1,161 @@
+/*
+ *  ======== buttonqueue.c ========
+ *  Debounced button event queue, see buttonqueue.h.
+ *
+ *  Single producer (interrupt level) and single consumer (the button task).
+ *  The producer only advances head and the task only advances tail, and
+ *  both the slots and the indices are volatile, so a slot is always written
+ *  before it is published and read before it is released. No locking.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "buttonqueue.h"
+
+#define BUTTONQUEUE_MASK (BUTTONQUEUE_SIZE - 1)
+
+#if (BUTTONQUEUE_SIZE & BUTTONQUEUE_MASK) != 0 || BUTTONQUEUE_SIZE > 128
+#error "BUTTONQUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+// Per-button debounce state, interrupt level only
+typedef struct {
+    uint_least8_t pin;
+    bool used;
+    bool armed;         // edge interrupt enabled, waiting for a press
+    uint8_t released;   // consecutive ticks the pin has read released
+    uint8_t countdown;  // ticks until the next auto-repeat
+    uint8_t repeats;
+} Button;
+
+static Button buttons[BUTTON_COUNT];
+static volatile ButtonEvent ring[BUTTONQUEUE_SIZE];
+static volatile uint8_t head;   // next slot to fill, interrupt level only
+static volatile uint8_t tail;   // next slot to read, button task only
+static ButtonQueueStats stats;
+
+static bool push(ButtonId button, ButtonAction action, uint32_t now, uint8_t repeat)
+{
+    uint8_t h = head;
+    volatile ButtonEvent *slot;
+
+    if ((uint8_t)(h - tail) >= BUTTONQUEUE_SIZE) {
+        stats.dropped++;
+        return false;
+    }
+    slot = &ring[h & BUTTONQUEUE_MASK];
+    slot->tick = now;
+    slot->button = (uint8_t)button;
+    slot->action = (uint8_t)action;
+    slot->repeat = repeat;
+    head = (uint8_t)(h + 1);
+    return true;
+}
+
+static void arm(Button *b)
+{
+    b->armed = true;
+    GPIO_clearInt(b->pin);      // drop edges latched while disarmed
+    GPIO_enableInt(b->pin);
+}
+
+void buttonQueueInit(uint_least8_t upPin, uint_least8_t downPin)
+{
+    unsigned char i;
+
+    head = tail = 0;
+    memset(&stats, 0, sizeof(stats));
+    memset(buttons, 0, sizeof(buttons));
+    buttons[BUTTON_UP].pin = upPin;
+    buttons[BUTTON_UP].used = true;
+    buttons[BUTTON_DOWN].pin = downPin;
+    buttons[BUTTON_DOWN].used = (downPin != upPin);
+
+    for (i = 0; i < BUTTON_COUNT; ++i) {
+        if (buttons[i].used) {
+            arm(&buttons[i]);
+        }
+    }
+}
+
+bool buttonQueuePress(ButtonId button, uint32_t now)
+{
+    Button *b = &buttons[button];
+
+    if (!b->used || !b->armed) {
+        return false;
+    }
+    // Ignore the rest of the bounce until the tick sees the pin released
+    GPIO_disableInt(b->pin);
+    b->armed = false;
+    b->released = 0;
+    b->countdown = BUTTON_HOLD_TICKS;
+    b->repeats = 0;
+    stats.presses++;
+    return push(button, BUTTON_PRESS, now, 0);
+}
+
+bool buttonQueueTick(uint32_t now)
+{
+    bool queued = false;
+    unsigned char i;
+
+    for (i = 0; i < BUTTON_COUNT; ++i) {
+        Button *b = &buttons[i];
+
+        if (!b->used || b->armed) {
+            continue;
+        }
+        if (GPIO_read(b->pin) == 0) {
+            // Still held (active low): auto-repeat, faster after a few
+            b->released = 0;
+            if (--b->countdown == 0) {
+                if (b->repeats < UINT8_MAX) {
+                    b->repeats++;
+                }
+                b->countdown = b->repeats >= BUTTON_FAST_AFTER ?
+                               BUTTON_FAST_TICKS : BUTTON_REPEAT_TICKS;
+                stats.repeats++;
+                queued |= push((ButtonId)i, BUTTON_REPEAT, now, b->repeats);
+            }
+        } else if (++b->released >= BUTTON_RELEASE_TICKS) {
+            arm(b);
+        }
+    }
+    return queued;
+}
+
+bool buttonQueueGet(ButtonEvent *event)
+{
+    uint8_t t = tail;
+    volatile ButtonEvent *slot;
+
+    if (t == head) {
+        return false;
+    }
+    slot = &ring[t & BUTTONQUEUE_MASK];
+    event->tick = slot->tick;
+    event->button = slot->button;
+    event->action = slot->action;
+    event->repeat = slot->repeat;
+    tail = (uint8_t)(t + 1);
+    return true;
+}
+
+bool buttonQueuePending(void)
+{
+    return head != tail;
+}
+
+void buttonQueueGetStats(ButtonQueueStats *out)
+{
+    uintptr_t key = HwiP_disable();
+
+    *out = stats;
+    HwiP_restore(key);
+}
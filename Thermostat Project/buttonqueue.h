@@ -0,0 +1,73 @@
+/*
+ *  ======== buttonqueue.h ========
+ *  Debounced button events, passed from interrupt level to the scheduler.
+ *
+ *  The GPIO callbacks report the first falling edge of a press; the edge
+ *  interrupt is then disabled until the timer tick has seen the pin released,
+ *  so contact bounce never reaches the queue. While a button stays down the
+ *  timer tick adds auto-repeat events, slowly at first and then faster.
+ *  The button task drains the queue, so every press counts.
+ */
+#ifndef BUTTONQUEUE_H_
+#define BUTTONQUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Events held between two runs of the button task, must be a power of two */
+#ifndef BUTTONQUEUE_SIZE
+#define BUTTONQUEUE_SIZE 16
+#endif
+
+/* Timing, in scheduler ticks */
+#define BUTTON_RELEASE_TICKS 2  // pin reads released this long before re-arming
+#define BUTTON_HOLD_TICKS    5  // held this long before auto-repeat starts
+#define BUTTON_REPEAT_TICKS  3  // first repeats come this far apart
+#define BUTTON_FAST_AFTER    4  // repeats before switching to the fast rate
+#define BUTTON_FAST_TICKS    1  // repeat interval once accelerated
+
+typedef enum {
+    BUTTON_UP,      // raises the set point
+    BUTTON_DOWN,    // lowers the set point
+    BUTTON_COUNT
+} ButtonId;
+
+typedef enum {
+    BUTTON_PRESS,   // first edge after the button was released
+    BUTTON_REPEAT   // button still held down
+} ButtonAction;
+
+typedef struct {
+    uint32_t tick;      // scheduler tick the event was raised in
+    uint8_t button;     // ButtonId
+    uint8_t action;     // ButtonAction
+    uint8_t repeat;     // repeats so far in this hold, saturates at 255
+} ButtonEvent;
+
+typedef struct {
+    uint32_t presses;
+    uint32_t repeats;
+    uint32_t dropped;   // events lost because the queue was full
+} ButtonQueueStats;
+
+/*
+ * Enables the edge interrupts. The pins must already be configured as
+ * pulled-up inputs with falling-edge interrupts. A board with one button
+ * passes the same pin twice and only gets BUTTON_UP.
+ */
+extern void buttonQueueInit(uint_least8_t upPin, uint_least8_t downPin);
+
+/*
+ * Interrupt level only: the GPIO callbacks and the timer callback, which
+ * run at the same priority and so never preempt each other. Both return
+ * true when an event was queued.
+ */
+extern bool buttonQueuePress(ButtonId button, uint32_t now);
+extern bool buttonQueueTick(uint32_t now);
+
+/* Task level: takes the oldest event, false when there is none */
+extern bool buttonQueueGet(ButtonEvent *event);
+extern bool buttonQueuePending(void);
+extern void buttonQueueGetStats(ButtonQueueStats *out);
+
+#endif /* BUTTONQUEUE_H_ */
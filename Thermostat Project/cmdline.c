@@ -0,0 +1,182 @@
+/*
+ *  ======== cmdline.c ========
+ *  UART command lines, see cmdline.h.
+ *
+ *  The buffers form a ring: the read callback fills lines[head] and only
+ *  advances head, the command task runs lines[tail] and only advances
+ *  tail. A buffer between the two belongs to the task, so the callback
+ *  has somewhere to write only while the ring is not full.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "cmdline.h"
+#include "txqueue.h"
+
+#define CMDLINE_MASK (CMDLINE_LINES - 1)
+
+#if (CMDLINE_LINES & CMDLINE_MASK) != 0 || CMDLINE_LINES > 128
+#error "CMDLINE_LINES must be a power of two no larger than 128"
+#endif
+
+static char lines[CMDLINE_LINES][CMDLINE_MAX];
+static volatile uint8_t head;   // line being received, interrupt level only
+static volatile uint8_t tail;   // next line to run, command task only
+static uint8_t len;             // bytes received into lines[head]
+static bool overflow;           // the line is too long, or there is no room for it
+static CmdLineStats stats;
+
+void cmdLineInit(void)
+{
+    head = tail = 0;
+    len = 0;
+    overflow = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool cmdLineReceive(uint8_t byte)
+{
+    uint8_t h = head;
+
+    if (byte == '\r' || byte == '\n') {
+        if (len == 0 && !overflow) {
+            return false;   // blank line, or the LF of a CR LF
+        }
+        if (overflow) {
+            stats.dropped++;
+        } else {
+            lines[h & CMDLINE_MASK][len] = '\0';
+            head = (uint8_t)(h + 1);
+            stats.lines++;
+        }
+        len = 0;
+        overflow = false;
+        return head != tail;
+    }
+    if ((uint8_t)(h - tail) >= CMDLINE_LINES) {
+        overflow = true;    // every buffer is waiting for the task
+    } else if (byte == '\b' || byte == 0x7F) {
+        if (len > 0) {
+            len--;
+        }
+    } else if (len < CMDLINE_MAX - 1) {
+        lines[h & CMDLINE_MASK][len++] = (char)byte;
+    } else {
+        overflow = true;
+    }
+    return false;
+}
+
+bool cmdLinePending(void)
+{
+    return head != tail;
+}
+
+static int split(char *p, char *argv[])
+{
+    int argc = 0;
+
+    for (;;) {
+        while (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+        }
+        if (*p == '\0') {
+            return argc;
+        }
+        if (argc == CMDLINE_ARGS) {
+            return -1;
+        }
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') {
+            ++p;
+        }
+    }
+}
+
+static void execute(char *line, const CmdLineCommand *table, size_t count)
+{
+    char *argv[CMDLINE_ARGS];
+    int argc;
+    size_t i;
+
+    argc = split(line, argv);
+
+    if (argc < 0) {
+        stats.errors++;
+        txQueuePrintf("# too many arguments\n\r");
+    } else if (argc > 0 && strcmp(argv[0], "help") == 0) {
+        for (i = 0; i < count; ++i) {
+            txQueuePrintf("# %s%s%s\n\r", table[i].name, table[i].usage[0] ? " " : "", table[i].usage);
+        }
+    } else if (argc > 0) {
+        for (i = 0; i < count && strcmp(argv[0], table[i].name) != 0; ++i) {}
+        if (i == count) {
+            stats.errors++;
+            txQueuePrintf("# unknown command '%s', try help\n\r", argv[0]);
+        } else if (table[i].handler(argc, argv) < 0) {
+            stats.errors++;
+            txQueuePrintf("# usage: %s %s\n\r", table[i].name, table[i].usage);
+        }
+    }
+}
+
+void cmdLineExecute(const CmdLineCommand *table, size_t count)
+{
+    uint8_t t;
+
+    while ((t = tail) != head) {
+        execute(lines[t & CMDLINE_MASK], table, count);
+        tail = (uint8_t)(t + 1);
+    }
+}
+
+bool cmdLineParseFixed(const char *text, unsigned fracBits, int32_t *value)
+{
+    bool negative = false;
+    int32_t whole = 0, frac = 0, scale = 1, v;
+    unsigned digits = 0;
+
+    if (*text == '-' || *text == '+') {
+        negative = (*text++ == '-');
+    }
+    for (; *text >= '0' && *text <= '9'; ++text, ++digits) {
+        whole = whole * 10 + (*text - '0');
+        if (whole > (INT32_MAX >> fracBits) - 1) {
+            return false;
+        }
+    }
+    if (*text == '.') {
+        for (++text; *text >= '0' && *text <= '9'; ++text, ++digits) {
+            if (scale < 10000) {
+                frac = frac * 10 + (*text - '0');
+                scale *= 10;
+            }
+        }
+    }
+    if (*text != '\0' || digits == 0) {
+        return false;
+    }
+    // Round the fraction to the nearest LSB
+    v = (whole << fracBits) + (int32_t)((((int64_t)frac << fracBits) + scale / 2) / scale);
+    *value = negative ? -v : v;
+    return true;
+}
+
+bool cmdLineParseInt(const char *text, int32_t *value)
+{
+    // A count or an index: "22.5" is a typo, not 23
+    return strchr(text, '.') == NULL && cmdLineParseFixed(text, 0, value);
+}
+
+void cmdLineGetStats(CmdLineStats *out)
+{
+    uintptr_t key = HwiP_disable();
+
+    *out = stats;
+    HwiP_restore(key);
+}
@@ -0,0 +1,65 @@
+/*
+ *  ======== cmdline.h ========
+ *  Line-oriented command interface on the UART receive path.
+ *
+ *  The UART2 read callback hands each received byte to cmdLineReceive(),
+ *  which builds the line in place in a ring of CMDLINE_LINES buffers. A
+ *  complete line is passed to the command task by advancing the ring,
+ *  never copied; the task splits it into words in place, calls the
+ *  command's handler and then gives the buffer back. When every buffer is
+ *  still waiting for the task the next line is dropped and counted rather
+ *  than waited for.
+ *
+ *  A line ends at CR or LF; backspace and DEL erase, and anything longer
+ *  than CMDLINE_MAX - 1 characters is dropped whole.
+ */
+#ifndef CMDLINE_H_
+#define CMDLINE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CMDLINE_MAX     48      // bytes per line, terminator included
+#define CMDLINE_LINES   4       // lines waiting for the task, a power of two
+#define CMDLINE_ARGS    4       // words per line, the command included
+
+typedef struct {
+    const char *name;
+    const char *usage;          // arguments, for help
+    int (*handler)(int argc, char *argv[]);    // 0 = done, < 0 = bad arguments
+} CmdLineCommand;
+
+typedef struct {
+    uint32_t lines;             // complete lines received
+    uint32_t dropped;           // lines lost: too long, or the task was busy
+    uint32_t errors;            // unknown commands and bad arguments
+} CmdLineStats;
+
+extern void cmdLineInit(void);
+
+/* Interrupt level: returns true when a line is waiting for the task */
+extern bool cmdLineReceive(uint8_t byte);
+
+extern bool cmdLinePending(void);
+
+/*
+ * Task level: runs the waiting lines, oldest first, against the table.
+ * "help" lists the table. Replies go out through the UART transmit queue
+ * as "# " lines.
+ */
+extern void cmdLineExecute(const CmdLineCommand *table, size_t count);
+
+/*
+ * Parses a decimal number with up to four fraction digits ("-1.25") into
+ * fixed point with fracBits fraction bits, without floating point.
+ * Returns false if text is not such a number.
+ */
+extern bool cmdLineParseFixed(const char *text, unsigned fracBits, int32_t *value);
+
+/* Parses a whole decimal number ("-12"); false if it has a fraction part */
+extern bool cmdLineParseInt(const char *text, int32_t *value);
+
+extern void cmdLineGetStats(CmdLineStats *out);
+
+#endif /* CMDLINE_H_ */
@@ -0,0 +1,62 @@
+/*
+ *  ======== cyclecount.h ========
+ *  Free-running CPU cycle counter for timing code.
+ *
+ *  On the target this is the Cortex-M4 DWT cycle counter (CYCCNT), which
+ *  counts core clock cycles and wraps every 2^32 / 80 MHz = 53 s. It stops
+ *  while the core sleeps, so only spans that stay awake (an interrupt to
+ *  the task it releases, a task body) measure correctly.
+ *
+ *  Other builds (the host simulation) count CLOCK_MONOTONIC time in cycles
+ *  of the same 80 MHz clock, so figures read in the same units; they
+ *  measure the host CPU, not the Cortex-M4.
+ */
+#ifndef CYCLECOUNT_H_
+#define CYCLECOUNT_H_
+
+#include <stdint.h>
+
+/* CC3220S core clock */
+#define CYCLES_PER_US   80
+
+#if defined(__ARM_ARCH)
+
+#define CYCLE_DEMCR         (*(volatile uint32_t *)0xE000EDFCU)
+#define CYCLE_DEMCR_TRCENA  (1U << 24)
+#define CYCLE_DWT_CTRL      (*(volatile uint32_t *)0xE0001000U)
+#define CYCLE_DWT_CYCCNTENA (1U << 0)
+#define CYCLE_DWT_CYCCNT    (*(volatile uint32_t *)0xE0001004U)
+
+// Starts the counter without zeroing it, so a span already being timed
+// survives a second init
+static inline void cycleCountInit(void)
+{
+    CYCLE_DEMCR |= CYCLE_DEMCR_TRCENA;
+    CYCLE_DWT_CTRL |= CYCLE_DWT_CYCCNTENA;
+}
+
+static inline uint32_t cycleCount(void)
+{
+    return CYCLE_DWT_CYCCNT;
+}
+
+#else
+
+#include <time.h>
+
+static inline void cycleCountInit(void)
+{
+}
+
+static inline uint32_t cycleCount(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * CYCLES_PER_US * 1000000U +
+                      (uint64_t)ts.tv_nsec * CYCLES_PER_US / 1000U);
+}
+
+#endif
+
+#endif /* CYCLECOUNT_H_ */
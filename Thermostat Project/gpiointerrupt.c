@@ -38,29 +38,138 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 /* Driver Header files */
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/Timer.h>
 #include <ti/drivers/I2C.h>
 #include <ti/drivers/UART2.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/dpl/HwiP.h>
+#if defined(THERMOSTAT_RTOS)
+#include <pthread.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+#include <ti/drivers/net/wifi/simplelink.h>
+#endif
 
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+/* Application modules */
+#include "bootphase.h"
+#include "buttonqueue.h"
+#include "cmdline.h"
+#include "cyclecount.h"
+#include "histlog.h"
+#include "samplerate.h"
+#include "sensorfault.h"
+#include "sensorhealth.h"
+#include "taskstats.h"
+#include "tempq7.h"
+#include "thermostat.h"
+#include "tlmframe.h"
+#include "tmpsensor.h"
+#include "txqueue.h"
+#include "uplink.h"
+#include "zones.h"
+
 /* Definitions */
-#define TIMER_PERIOD 100
-#define NUM_TASKS 3
+#define TASKSTATS_REPORT_S 60   // seconds between task statistics summaries
+#define TELEMETRY_HEARTBEAT_S 60    // longest silence in report-on-change mode
+#define TELEMETRY_INTERVAL_MAX_S 3600
+#define SET_POINT_DEFAULT 20
+#define SENSOR_PERIOD 500   // ms between sensor task runs, which start a conversion and then read it
+#define I2C_SCL_GPIO 10     // CONFIG_I2C_0 pins as GPIOs, for bus recovery (boosterpack 9 and 10)
+#define I2C_SDA_GPIO 11
+#define I2C_RECOVER_CLOCKS 9    // enough for a part to finish any byte
+#define I2C_RECOVER_HALF_US 5   // 100 kHz
+
+/*
+ *  ======== Task Set ========
+ *  The one place the tick and the tasks are declared. Each entry is
+ *  X(arg, id, TickFct, initial state, period ms, phase ms, policy,
+ *  priority): the task runs in every tick where
+ *  (tick * TIMER_PERIOD) % period == phase. The timer period, the task
+ *  table and the dispatch table all come from here, and the build fails
+ *  if a period or phase does not fit the tick.
+ *
+ *  The policy says what happens to releases missed while the scheduler was
+ *  busy: TASK_SKIP runs the task once and drops the rest, TASK_CATCH_UP
+ *  runs it once per release, up to TASK_CATCH_UP_MAX times in a pass.
+ *
+ *  The priority only counts in a THERMOSTAT_RTOS build, where each task is
+ *  a thread of its own (see Task Threads); the NoRTOS scheduler runs a
+ *  pass's tasks in table order. The control path is on top, the sensor
+ *  just above the heat decision it feeds; telemetry is at the bottom.
+ */
+#define TIMER_PERIOD 100    // ms per timer tick
+#define HYPERPERIOD 1000    // ms, a common multiple of every task period
+#define TASK_CATCH_UP_MAX 10
+#define TASK_SET(X, arg) \
+    X(arg, BUTTON_TASK, changeSetPointTemp, BUTTON_WAIT,  100,   0, TASK_SKIP,     4) /* drain button events, change set-point temp */ \
+    X(arg, SENSOR_TASK, startTempRead,      SENSOR_READ,  SENSOR_PERIOD, 400, TASK_SKIP, 6) /* start a conversion or a read, one tick ahead of HEAT_TASK */ \
+    X(arg, HEAT_TASK,   adjustHeat,         HEAT_WAIT,    500,   0, TASK_SKIP,     5) /* read temp sensor and adjust heat (update LED) */ \
+    X(arg, UART2_TASK,  UART2Output,        UART2_WAIT,  1000,   0, TASK_SKIP,     1) /* update server */ \
+    X(arg, STATS_TASK,  reportTaskStats,    STATS_WAIT,  1000,   0, TASK_CATCH_UP, 1) /* task statistics summary, or answer a query */ \
+    X(arg, LOG_TASK,    logHistory,         LOG_WAIT,     100,   0, TASK_SKIP,     2) /* history log sample, flush and export */ \
+    X(arg, CMD_TASK,    runCommands,        CMD_WAIT,     100,   0, TASK_SKIP,     3) /* execute a command line from the UART */ \
+    X(arg, WIFI_TASK,   wifiUplink,         WIFI_WAIT,   1000, 500, TASK_SKIP,     1) /* queue readings, send batches to the collector */
+
+enum TASK_POLICIES {TASK_SKIP, TASK_CATCH_UP};
+#define TASK_PRIORITY_MIN 1     // above the RTOS idle task
+#define TASK_PRIORITY_MAX 8     // below the SimpleLink spawn thread
+#define TASK_STACK_SIZE 2048    // bytes per task thread
+#define SPAWN_PRIORITY 9        // SimpleLink spawn thread, above every task
+#define SPAWN_STACK_SIZE 2048
+
+#define TICKS_PER_SECOND (1000 / TIMER_PERIOD)
+#define HYPERPERIOD_TICKS (HYPERPERIOD / TIMER_PERIOD)
+#define TASK_BIT(id) (1u << (id))
+
+#define TASK_ID(arg, id, fct, st, per, ph, pol, pri) id,
+enum TASK_IDS {TASK_SET(TASK_ID, 0) NUM_TASKS};
+
+#define TASK_CHECK(arg, id, fct, st, per, ph, pol, pri) \
+    _Static_assert((per) > 0 && (per) % TIMER_PERIOD == 0, #id " period is not a whole number of ticks"); \
+    _Static_assert(HYPERPERIOD % (per) == 0, #id " period does not divide HYPERPERIOD"); \
+    _Static_assert((ph) % TIMER_PERIOD == 0 && (ph) < (per), #id " phase is not a tick within its period"); \
+    _Static_assert((pol) == TASK_SKIP || (pol) == TASK_CATCH_UP, #id " policy is not a TASK_POLICIES value"); \
+    _Static_assert((pri) >= TASK_PRIORITY_MIN && (pri) <= TASK_PRIORITY_MAX, #id " priority is out of range");
+TASK_SET(TASK_CHECK, 0)
+_Static_assert(1000 % TIMER_PERIOD == 0, "TIMER_PERIOD does not divide one second");
+_Static_assert(HYPERPERIOD % TIMER_PERIOD == 0, "HYPERPERIOD is not a whole number of ticks");
+_Static_assert(NUM_TASKS <= 8, "dispatch table entries are 8-bit task masks");
+
+#define TASK_POLICY(arg, id, fct, st, per, ph, pol, pri) | (((pol) == TASK_CATCH_UP) ? TASK_BIT(id) : 0u)
+#define TASK_CATCH_UP_MASK (0u TASK_SET(TASK_POLICY, 0))
+
+// Event-driven tasks: released every tick, but only worth a wakeup while
+// they have work queued (see scheduleWakeup)
+#define TASK_EVENT_MASK (TASK_BIT(BUTTON_TASK) | TASK_BIT(LOG_TASK) | TASK_BIT(CMD_TASK))
+
+/*
+ * Dispatch table: the tasks released in each tick of the hyperperiod,
+ * evaluated by the compiler. One entry per tick; the assertion below
+ * catches a table that no longer matches HYPERPERIOD.
+ */
+#define TASK_DUE(slot, id, fct, st, per, ph, pol, pri) | ((((slot) * TIMER_PERIOD) % (per) == (ph)) ? TASK_BIT(id) : 0u)
+#define DISPATCH_SLOT(slot) (uint8_t)(0u TASK_SET(TASK_DUE, slot))
+
+static const uint8_t dispatchTable[] = {
+    DISPATCH_SLOT(0), DISPATCH_SLOT(1), DISPATCH_SLOT(2), DISPATCH_SLOT(3), DISPATCH_SLOT(4),
+    DISPATCH_SLOT(5), DISPATCH_SLOT(6), DISPATCH_SLOT(7), DISPATCH_SLOT(8), DISPATCH_SLOT(9)
+};
+_Static_assert(sizeof(dispatchTable) == HYPERPERIOD_TICKS, "dispatchTable needs one entry per tick of HYPERPERIOD");
 // DISPLAY macro definition reference: https://stackoverflow.com/questions/66304786/sprintf-with-elipses-in-c-for-macro-definition-results-in-compilation-error
-#define DISPLAY(fmt, ...) do { \
-    snprintf(output, sizeof(output), fmt, ##__VA_ARGS__);\
-    UART2_write(UART2, output, strlen(output), &bytesToSend);\
-} while (0)
+// Messages are queued for the UART and never wait on it (see txqueue.h)
+#define DISPLAY(fmt, ...) txQueuePrintf(fmt, ##__VA_ARGS__)
 
 // Driver Handles
 UART2_Handle UART2;
 Timer_Handle timer0;
 I2C_Handle  i2c;
+I2C_Params  i2cParams;      // kept to reopen the driver after a bus recovery
 
 /*
  * ======== Task Struct ========
@@ -68,69 +177,254 @@ I2C_Handle  i2c;
 typedef struct task {
     int state;
     unsigned long period;
-    unsigned long elapsedTime;
+    int priority;       // THERMOSTAT_RTOS thread priority
     int (*TickFct)(int);
 } task;
 
-task tasks[NUM_TASKS];
-
 /*
  * ======== Global Variables ========
  */
 // Timer Global Variables
 volatile unsigned char TimerFlag = 0;
-
-// UART2 Global Variables
-char  output[64];
-size_t  bytesToSend;
+volatile unsigned long tickCount = 0;   // timer interrupts since start
+volatile unsigned long wakeTick = 0;    // tick at which the scheduler is next due
+volatile unsigned long eventTick = 0;   // next release of the event-driven tasks
 
 // I2C Global Variables
+// Every sensor that answers the boot scan becomes the next zone
 static const struct {
     uint8_t address;
-    uint8_t resultReg;
     char *id;
+    const TmpDriver *driver;
 }
-sensors[3] = {
-    { 0x48, 0x0000, "11X" },
-    { 0x49, 0x0000, "116" },
-    { 0x41, 0x0001, "006" }
+sensors[] = {
+    { 0x48, "11X", &tmp11xDriver },
+    { 0x49, "116", &tmp11xDriver },
+    { 0x4A, "11X", &tmp11xDriver },
+    { 0x4B, "11X", &tmp11xDriver },
+    { 0x41, "006", &tmp006Driver },
+    { 0x42, "006", &tmp006Driver },
+    { 0x43, "006", &tmp006Driver },
+    { 0x44, "006", &tmp006Driver }
 };
-uint8_t txBuffer[1];
-uint8_t rxBuffer[2];
-I2C_Transaction i2cTransaction;
+#define NUM_SENSORS (sizeof(sensors) / sizeof(sensors[0]))
+const TmpDriver *sensorDrivers[ZONES_MAX];     // each zone's part, see tmpsensor.h
+TmpSensorMode sensorModes[ZONES_MAX];          // ... and its conversion mode
+uint8_t txBuffers[ZONES_MAX][3];
+uint8_t rxBuffers[ZONES_MAX][2];
+uint8_t auxBuffers[ZONES_MAX][2];   // the auxReg bytes read the sweep before
+uint32_t auxValid = 0;              // zones with auxReg bytes to convert with
+tempq7_t readings[ZONES_MAX];       // the latest reading of each zone
+I2C_Transaction i2cTransactions[ZONES_MAX];    // one per zone, queued together, arg = zone
+volatile uint32_t i2cPending = 0;   // zones with a transfer queued, callback not yet run
+volatile uint32_t i2cDone = 0;      // zones whose last transfer succeeded
+uint32_t i2cQueued = 0;     // zones in the last batch startTempRead queued
+uint32_t i2cReading = 0;    // ... and of those, the ones reading a result
+uint32_t i2cAux = 0;        // ... or reading auxReg
+uint32_t sensorCycle = 0;   // zones in the current conversion cycle, see sensorfault.h
+uint32_t sensorCycleFailed = 0; // ... and the ones whose conversion did not start
+bool sensorCycleEnd = false;    // the batch queued is the cycle's read sweep
+SampleRate sampling;            // when each zone is next read, see samplerate.h
+// Why sensorhealth.c rejected a reading, by SENSOR_HEALTH_VERDICTS
+static const char *const healthVerdicts[] = { "ok", "out of range", "stuck", "spike", "jump" };
+uint32_t sensorReconfigure = 0; // zones to configure again on the next start sweep
 
 // Thermostat Global Variables
-int setPointTemp = 20;
-int16_t temperature = 0;
-volatile bool heatOn = 0;
-int seconds = 0;
-volatile bool increaseTemp = 0;
-volatile bool decreaseTemp = 0;
+// Heat output of each zone, in the order the sensors are found
+static const uint_least8_t zoneOutputs[] = {
+    CONFIG_GPIO_LED_0, CONFIG_GPIO_HEAT_1, CONFIG_GPIO_HEAT_2, CONFIG_GPIO_HEAT_3
+};
+#define NUM_ZONE_OUTPUTS (sizeof(zoneOutputs) / sizeof(zoneOutputs[0]))
+ZoneSet zones;              // every zone's sensor, set point and heat state, see zones.h
+uint64_t uptimeTicks = 0;   // ticks up to the current scheduler pass, or the last tick
+
+// Telemetry Global Variables
+#ifndef TELEMETRY_DEFAULT_FORMAT
+#define TELEMETRY_DEFAULT_FORMAT TELEMETRY_ASCII
+#endif
+#ifndef TELEMETRY_DEFAULT_MODE
+#define TELEMETRY_DEFAULT_MODE TELEMETRY_PERIODIC
+#endif
+#ifndef TELEMETRY_DEFAULT_DEADBAND
+#define TELEMETRY_DEFAULT_DEADBAND (TEMP_Q7_ONE / 4)   // 0.25 degC
+#endif
+enum TELEMETRY_FORMATS telemetryFormat = TELEMETRY_DEFAULT_FORMAT;
+enum TELEMETRY_MODES telemetryMode = TELEMETRY_DEFAULT_MODE;
+tempq7_t telemetryDeadband = TELEMETRY_DEFAULT_DEADBAND;
+uint16_t telemetrySequence = 0;
+int telemetryInterval = 1;                      // seconds between periodic reports
+int telemetryElapsed = TELEMETRY_INTERVAL_MAX_S; // seconds since the last report, first one is due
+uint16_t uplinkSequence = 0;                    // the uplink numbers its own records
+int uplinkElapsed = UPLINK_SAMPLE_S;            // seconds since the last queued reading
+tempq7_t reportedTemperature[ZONES_MAX];        // values in the last report
+int8_t reportedSetPoint[ZONES_MAX];
+uint32_t reportedHeatMask;
+
+// Command Global Variables
+uint8_t uartRxBuf[16];
+volatile bool statsRequested = 0;   // stats command
+int statsElapsed = 0;               // seconds since the last summary
+volatile bool logRequested = 0;     // log command
+volatile bool flushRequested = 0;   // flush command, done by the log task
 
 // Enum for States
 enum BUTTON_STATES {INCREASE_TEMP, DECREASE_TEMP, BUTTON_WAIT} BUTTON_STATE;
+enum SENSOR_STATES {SENSOR_CONVERT, SENSOR_READ} SENSOR_STATE;
 enum HEAT_STATES {HEAT_ON, HEAT_OFF, HEAT_WAIT} HEAT_STATE;
 enum UART2_STATES {UART2_UPDATE, UART2_WAIT} UART2_STATE;
+enum STATS_STATES {STATS_REPORT, STATS_WAIT} STATS_STATE;
+enum LOG_STATES {LOG_EXPORT, LOG_WAIT} LOG_STATE;
+enum CMD_STATES {CMD_EXECUTE, CMD_WAIT} CMD_STATE;
+enum WIFI_STATES {WIFI_SAMPLE, WIFI_WAIT} WIFI_STATE;
+
+// Task table, from TASK_SET
+#define TASK_ENTRY(arg, id, fct, st, per, ph, pol, pri) [id] = {.state = st, .period = per, .priority = pri, .TickFct = &fct},
+task tasks[NUM_TASKS] = {TASK_SET(TASK_ENTRY, 0)};
+
+#if defined(THERMOSTAT_RTOS)
+// Task threads, see Task Threads
+SemaphoreP_Handle taskSems[NUM_TASKS];          // posted when a task is released
+volatile uint8_t taskReleases[NUM_TASKS];       // releases its thread has not taken yet
+volatile unsigned long taskReleaseTick[NUM_TASKS]; // ... the tick of the first
+#endif
+
+// The event-driven tasks have work queued
+static bool eventWork(void)
+{
+    return buttonQueuePending() || cmdLinePending() || flushRequested || histLogExporting();
+}
+
+// Periodic tasks with nothing to do at a release in tick: the sensor task's
+// start sweep while no zone is due (see samplerate.h). Their releases are
+// dropped and never worth a wakeup.
+static uint8_t restingTasks(unsigned long tick)
+{
+    return tasks[SENSOR_TASK].state == SENSOR_CONVERT &&
+           sampleRateResting(&sampling, (uint32_t)(tick * TIMER_PERIOD)) ? TASK_BIT(SENSOR_TASK) : 0;
+}
+
+#if defined(THERMOSTAT_RTOS)
+// Hand the tasks in the mask to their threads. Interrupt level, or with
+// interrupts masked.
+static void releaseTasks(uint8_t mask)
+{
+    unsigned char i;
+
+    for (i = 0; mask != 0; ++i, mask >>= 1) {
+        if (!(mask & 1)) {
+            continue;
+        }
+        if (taskReleases[i] == 0) {
+            taskReleaseTick[i] = tickCount;
+            SemaphoreP_post(taskSems[i]);
+        }
+        if (taskReleases[i] < UINT8_MAX) {
+            taskReleases[i]++;
+        }
+    }
+}
+#endif
 
 /*
  *  ======== Callbacks ========
  */
 
+// Pull the next scheduler wakeup in to the event-driven tasks' release,
+// or with task threads release them now
+void wakeForEvent(void)
+{
+#if defined(THERMOSTAT_RTOS)
+    taskStatsRelease(TASK_EVENT_MASK);
+    releaseTasks(TASK_EVENT_MASK);
+#else
+    if ((long)(eventTick - wakeTick) < 0) {
+        wakeTick = eventTick;
+    }
+    if ((long)(tickCount - wakeTick) >= 0) {
+        if (!TimerFlag) {
+            taskStatsWake();
+        }
+        taskStatsRelease(TASK_EVENT_MASK);
+        TimerFlag = 1;
+    }
+#endif
+}
+
 // GPIO callback to increase temperature
 void gpioIncreaseTempCallback(uint_least8_t index)
 {
-    increaseTemp = 1;
+    if (buttonQueuePress(BUTTON_UP, tickCount)) {
+        wakeForEvent();
+    }
 }
 
 // GPIO callback to decrease temperature
 void gpioDecreaseTempCallback(uint_least8_t index)
 {
-    decreaseTemp = 1;
+    if (buttonQueuePress(BUTTON_DOWN, tickCount)) {
+        wakeForEvent();
+    }
+}
+
+// I2C callback, runs when a zone's transfer completes or is cancelled
+void i2cCallback(I2C_Handle handle, I2C_Transaction *transaction, bool transferStatus)
+{
+    uint32_t bit = ZONE_BIT((uintptr_t)transaction->arg);
+
+    if (transferStatus) {
+        i2cDone |= bit;
+    } else {
+        i2cDone &= ~bit;
+    }
+    i2cPending &= ~bit;
+}
+
+// UART2 read callback: collect command lines, wake the scheduler for one
+void uartReadCallback(UART2_Handle handle, void *buf, size_t count,
+                      void *userArg, int_fast16_t status)
+{
+    bool line = false;
+    size_t i;
+
+    for (i = 0; i < count; ++i) {
+        line |= cmdLineReceive(uartRxBuf[i]);
+    }
+    if (line) {
+        wakeForEvent();
+    }
+    if (status != UART2_STATUS_ECANCELLED) {
+        UART2_read(handle, uartRxBuf, sizeof(uartRxBuf), NULL);
+    }
 }
 
 // Timer callback
 void timerCallback(Timer_Handle myHandle, int_fast16_t status){
-   TimerFlag = 1;
+    uint8_t due;
+
+    ++tickCount;
+    due = dispatchTable[tickCount % HYPERPERIOD_TICKS] & ~restingTasks(tickCount);
+    if (buttonQueueTick(tickCount)) {
+        wakeForEvent();    // auto-repeat from a held button
+    }
+#if defined(THERMOSTAT_RTOS)
+    // The event-driven tasks come with the periodic ones, as in a pass
+    ++uptimeTicks;
+    taskStatsTick();
+    if (!(due & ~TASK_EVENT_MASK) && !eventWork()) {
+        due &= ~TASK_EVENT_MASK;
+    }
+    taskStatsRelease(due);
+    releaseTasks(due);
+#else
+    taskStatsRelease(due & ~TASK_EVENT_MASK);
+    if ((long)(tickCount - wakeTick) >= 0) {
+        if (!TimerFlag) {
+            taskStatsWake();
+        }
+        taskStatsRelease(TASK_EVENT_MASK);
+        TimerFlag = 1;  // a task is due, wake the scheduler
+    }
+#endif
 }
 
 /*
@@ -144,8 +438,11 @@ void initUART2(void) {
     // Configure the driver
     UART2_Params_init(&UART2Params);
     UART2Params.baudRate = 115200;
-    UART2Params.readMode = UART2_Mode_BLOCKING;
-    UART2Params.writeMode = UART2_Mode_BLOCKING;
+    UART2Params.readMode = UART2_Mode_CALLBACK;
+    UART2Params.readCallback = uartReadCallback;
+    UART2Params.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    UART2Params.writeMode = UART2_Mode_CALLBACK;
+    UART2Params.writeCallback = txQueueWriteCallback;
 
     // Open the driver
     UART2 = UART2_open(CONFIG_UART2_0, &UART2Params);
@@ -154,12 +451,96 @@ void initUART2(void) {
         /* UART2_open() failed */
         while (1);
     }
+
+    // Drain DISPLAY output in the background
+    txQueueInit(UART2);
+
+    // Listen for commands
+    cmdLineInit();
+    UART2_read(UART2, uartRxBuf, sizeof(uartRxBuf), NULL);
+}
+
+// Point a zone's transaction at one of its sensor's registers
+void i2cSetupRead(uint8_t zone, uint8_t reg) {
+    txBuffers[zone][0] = reg;
+    i2cTransactions[zone].writeCount = 1;
+    i2cTransactions[zone].readCount = 2;
+}
+
+// ... or at its configuration register; on a one-shot part this starts a conversion
+void i2cSetupConfig(uint8_t zone) {
+    txBuffers[zone][0] = sensorModes[zone].configReg;
+    txBuffers[zone][1] = (uint8_t)(sensorModes[zone].config >> 8);
+    txBuffers[zone][2] = (uint8_t)sensorModes[zone].config;
+    i2cTransactions[zone].writeCount = 3;
+    i2cTransactions[zone].readCount = 0;
+}
+
+// Start a zone's transfer and wait for its callback (boot only)
+bool i2cTransferWait(uint8_t zone) {
+    i2cPending = ZONE_BIT(zone);
+    if (!I2C_transfer(i2c, &i2cTransactions[zone])) {
+        i2cPending = 0;
+        return false;
+    }
+    while (i2cPending) {}
+    return (i2cDone & ZONE_BIT(zone)) != 0;
+}
+
+// Busy-wait, for bit timing at task level
+void delayUs(uint32_t us) {
+    uint32_t start = cycleCount();
+
+    while (cycleCount() - start < us * CYCLES_PER_US) {}
+}
+
+/*
+ *  ======== i2cRecover ========
+ *  Frees a bus that a sensor holds and restarts the controller. A part
+ *  reset or glitched in the middle of a read can be left driving SDA low
+ *  while it waits for the rest of its byte. Up to nine SCL pulses let it
+ *  finish and release SDA, then a STOP returns every part to idle.
+ *  Reopening the driver hands both pins back to the I2C controller. The
+ *  next start sweep configures every sensor again in case it reset too.
+ *  Task level, with nothing queued that will still complete.
+ */
+void i2cRecover(void) {
+    uintptr_t key;
+    int clocks = 0;
+
+    if (i2c != NULL) {
+        I2C_close(i2c);
+        i2c = NULL;
+    }
+    key = HwiP_disable();
+    i2cPending = 0;     // a closed driver makes no more callbacks
+    HwiP_restore(key);
+
+    GPIO_setConfig(I2C_SDA_GPIO, GPIO_CFG_IN_NOPULL);
+    GPIO_setConfig(I2C_SCL_GPIO, GPIO_CFG_OUT_OD_NOPULL | GPIO_CFG_OUT_HIGH);
+    while (clocks < I2C_RECOVER_CLOCKS && GPIO_read(I2C_SDA_GPIO) == 0) {
+        GPIO_write(I2C_SCL_GPIO, 0);
+        delayUs(I2C_RECOVER_HALF_US);
+        GPIO_write(I2C_SCL_GPIO, 1);
+        delayUs(I2C_RECOVER_HALF_US);
+        ++clocks;
+    }
+    // STOP: SDA rises while SCL is high
+    GPIO_setConfig(I2C_SDA_GPIO, GPIO_CFG_OUT_OD_NOPULL | GPIO_CFG_OUT_LOW);
+    delayUs(I2C_RECOVER_HALF_US);
+    GPIO_write(I2C_SDA_GPIO, 1);
+    delayUs(I2C_RECOVER_HALF_US);
+
+    i2c = I2C_open(CONFIG_I2C_0, &i2cParams);
+    sensorReconfigure = zonesMask(&zones);
+    sensorFaultRecovered();
+    DISPLAY("I2C bus recovery: %d clocks, %s\n\r", clocks, i2c != NULL ? "reopened" : "reopen failed");
 }
 
 // Initialize I2C
 void initI2C(void) {
-    int8_t  i, found;
-    I2C_Params  i2cParams;
+    SensorHealthChange health;
+    uint8_t i, z;
 
     DISPLAY("Initializing I2C Driver - ");
 
@@ -169,6 +550,8 @@ void initI2C(void) {
     // Configure the driver
     I2C_Params_init(&i2cParams);
     i2cParams.bitRate = I2C_400kHz;
+    i2cParams.transferMode = I2C_MODE_CALLBACK;
+    i2cParams.transferCallbackFxn = i2cCallback;
 
     // Open the driver
     i2c = I2C_open(CONFIG_I2C_0, &i2cParams);
@@ -181,53 +564,99 @@ void initI2C(void) {
 
     // Boards were shipped with different sensors.
     // Welcome to the world of embedded systems.
-    // Try to determine which sensor we have.
+    // Try to determine which sensors we have.
     // Scan through the possible sensor addresses
 
-    /* Common I2C transaction setup */
-    i2cTransaction.writeBuf   = txBuffer;
-    i2cTransaction.writeCount = 1;
-    i2cTransaction.readBuf = rxBuffer;
-    i2cTransaction.readCount  = 0;
-
-    found = false;
-    for (i=0; i<3; ++i) {
-        i2cTransaction.targetAddress = sensors[i].address;
-        txBuffer[0] = sensors[i].resultReg;
-
-        DISPLAY("Is this %s? ", sensors[i].id);
-        if (I2C_transfer(i2c, &i2cTransaction)) {
-            DISPLAY("Found\n\r");
-            found = true;
-            break;
+    /* Common I2C transaction setup, one per zone */
+    for (z = 0; z < ZONES_MAX; ++z) {
+        i2cTransactions[z].writeBuf   = txBuffers[z];
+        i2cTransactions[z].writeCount = 1;
+        i2cTransactions[z].readBuf = rxBuffers[z];
+        i2cTransactions[z].readCount  = 0;
+        i2cTransactions[z].arg = (void *)(uintptr_t)z;
+    }
+
+    // A part only counts if its ID register says it is that part
+    zonesInit(&zones);
+    sensorFaultInit();
+    sensorHealthInit();
+    sampleRateInit(&sampling, 2 * SENSOR_PERIOD);
+    for (i = 0; i < NUM_SENSORS && zones.count < ZONES_MAX && zones.count < NUM_ZONE_OUTPUTS; ++i) {
+        const TmpDriver *driver = sensors[i].driver;
+
+        z = zones.count;
+        i2cTransactions[z].targetAddress = sensors[i].address;
+        i2cSetupRead(z, driver->idReg);
+
+        // One line per part found; an empty address says nothing
+        if (i2cTransferWait(z) && driver->probe((uint16_t)((rxBuffers[z][0] << 8) | rxBuffers[z][1]))) {
+            DISPLAY("Detected TMP%s I2C address: %x, zone %d\n\r", sensors[i].id, sensors[i].address, z);
+            zonesAdd(&zones, sensors[i].address, driver->resultReg, zoneOutputs[z], SET_POINT_DEFAULT);
+            sensorDrivers[z] = driver;
+            driver->mode(SENSOR_PERIOD, 2 * SENSOR_PERIOD, &sensorModes[z]);
         }
-        DISPLAY("No\n\r");
     }
-    if(found) {
-        DISPLAY("Detected TMP%s I2C address: %x\n\r", sensors[i].id, i2cTransaction.targetAddress);
-    } else {
+    if (zones.count == 0) {
         DISPLAY("Temperature sensor not found, contact professor\n\r");
+        // Keep one zone so the set point and reports still work
+        i2cTransactions[0].targetAddress = sensors[0].address;
+        zonesAdd(&zones, sensors[0].address, sensors[0].driver->resultReg, zoneOutputs[0], SET_POINT_DEFAULT);
+        sensorDrivers[0] = sensors[0].driver;
+        sensors[0].driver->mode(SENSOR_PERIOD, 2 * SENSOR_PERIOD, &sensorModes[0]);
+    }
+
+    // First readings, from the conversions the sensors made out of reset,
+    // then the mode the sensor task runs them in; on a one-shot part that
+    // starts the conversion its first read collects, so the zone is in the
+    // sensor task's first cycle. The others join the next one. The first
+    // reading starts the zone's health window (sensorhealth.h), which the
+    // sensor task fills; the zone is unread, and held off, until then.
+    sensorReconfigure = zonesMask(&zones);
+    for (z = 0; z < zones.count; ++z) {
+        if (sensorDrivers[z]->auxReg != TMP_REG_NONE) {
+            i2cSetupRead(z, sensorDrivers[z]->auxReg);
+            if (!i2cTransferWait(z)) {
+                continue;
+            }
+            memcpy(auxBuffers[z], rxBuffers[z], sizeof(auxBuffers[z]));
+            auxValid |= ZONE_BIT(z);
+        }
+        i2cSetupRead(z, zones.resultReg[z]);
+        if (!i2cTransferWait(z)) {
+            continue;
+        }
+        readings[z] = sensorDrivers[z]->convert(rxBuffers[z], auxBuffers[z]);
+        sensorHealthSweep(ZONE_BIT(z), readings, 0, 0, &health);
+        i2cSetupConfig(z);
+        if (i2cTransferWait(z)) {
+            sensorCycle |= ZONE_BIT(z);
+            sensorReconfigure &= ~ZONE_BIT(z);
+            DISPLAY("Zone %d sensor: %s, %d averages, %d ms\n\r", z,
+                    sensorModes[z].oneShot ? "one-shot" : "continuous",
+                    sensorModes[z].averages, sensorModes[z].conversionMs);
+        } else {
+            DISPLAY("Zone %d sensor not configured (%d)\n\r", z, i2cTransactions[z].status);
+        }
     }
 }
 
 // Initialize GPIO
 void initGPIO(void) {
+    uint8_t z;
+
     /* Init the driver */
     GPIO_init();
 
-    /* Configure the LED and button pins */
-    GPIO_setConfig(CONFIG_GPIO_LED_0, GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
+    /* Configure the heat outputs (zone 0 is the LED) and button pins */
+    for (z = 0; z < zones.count; ++z) {
+        GPIO_setConfig(zones.output[z], GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
+        GPIO_write(zones.output[z], CONFIG_GPIO_LED_OFF);
+    }
     GPIO_setConfig(CONFIG_GPIO_BUTTON_0, GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_FALLING);
 
-    /* Turn off LED */
-    GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
-
     /* Install Button callback */
     GPIO_setCallback(CONFIG_GPIO_BUTTON_0, gpioIncreaseTempCallback);
 
-    /* Enable interrupts */
-    GPIO_enableInt(CONFIG_GPIO_BUTTON_0);
-
     /*
      *  If more than one input pin is available for your device, interrupts
      *  will be enabled on CONFIG_GPIO_BUTTON1.
@@ -239,9 +668,11 @@ void initGPIO(void) {
 
         /* Install Button callback */
         GPIO_setCallback(CONFIG_GPIO_BUTTON_1, gpioDecreaseTempCallback);
-        GPIO_enableInt(CONFIG_GPIO_BUTTON_1);
     }
 
+    /* Enable interrupts, the button queue re-arms them after each press */
+    buttonQueueInit(CONFIG_GPIO_BUTTON_0, CONFIG_GPIO_BUTTON_1);
+
 }
 
 // Initialize timer
@@ -253,7 +684,7 @@ void initTimer(void) {
 
     // Configure the driver
     Timer_Params_init(&params);
-    params.period = 100000;
+    params.period = TIMER_PERIOD * 1000UL;
     params.periodUnits = Timer_PERIOD_US;
     params.timerMode = Timer_CONTINUOUS_CALLBACK;
     params.timerCallback = timerCallback;
@@ -270,138 +701,945 @@ void initTimer(void) {
     }
 }
 
+// Initialize power management
+void initPower(void) {
+    /* Let Power_idleFunc() run the sleep policy between ticks */
+    Power_enablePolicy();
+}
+
 /*
  * ======== changeSetPointTemp ========
  */
 int changeSetPointTemp(int state) {
-    if (increaseTemp) {
-        state = INCREASE_TEMP;
-    } else if (decreaseTemp) {
-        state = DECREASE_TEMP;
+    ButtonEvent event;
+
+    // Apply every press and repeat queued since the last run, in order
+    while (buttonQueueGet(&event)) {
+        state = (event.button == BUTTON_UP) ? INCREASE_TEMP : DECREASE_TEMP;
+
+        // The buttons set zone 0, the zone with the LED
+        switch (state) {
+        case INCREASE_TEMP:
+            zonesStepSetPoint(&zones, 0, +1);
+            break;
+        case DECREASE_TEMP:
+            zonesStepSetPoint(&zones, 0, -1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    state = BUTTON_WAIT;
+    BUTTON_STATE = state;
+    return state;
+}
+
+
+/*
+ *  ======== startTempRead ========
+ *  Alternates between starting a conversion on every one-shot sensor and
+ *  reading every zone's result a sensor period later, one tick ahead of
+ *  adjustHeat. The driver queues the transfers and runs them back to back
+ *  in the background while the scheduler sleeps; i2cCallback() marks each
+ *  one done, so the results are waiting when adjustHeat runs. A sensor
+ *  that converts continuously has its auxReg, if any, read in place of the
+ *  conversion start, unless it needs configuring again.
+ *
+ *  The zones in a cycle are the ones samplerate.c has due and sensorfault.c
+ *  does not have sitting out a backoff; with none due the start sweep
+ *  waits for the next release. A bus that keeps failing, or a transfer
+ *  that a cancel did not end within a whole sensor period, is recovered
+ *  first.
+ */
+int startTempRead(int state) {
+    uint32_t batch = 0, aux = 0, failed = 0, due = 0;
+    uintptr_t key;
+    uint8_t z;
+
+    if (state == SENSOR_CONVERT) {
+        due = sampleRateDue(&sampling, zonesMask(&zones), (uint32_t)(uptimeTicks * TIMER_PERIOD));
+        if (due == 0) {
+            return state;
+        }
+    }
+    if (i2cPending != 0 || sensorFaultRecoveryDue()) {
+        i2cRecover();
+    }
+    if (state == SENSOR_CONVERT) {
+        sensorCycle = sensorFaultCycle(due);
+        sensorCycleFailed = 0;
+    }
+    for (z = 0; z < zones.count && i2c != NULL; ++z) {
+        if (!(sensorCycle & ~sensorCycleFailed & ZONE_BIT(z))) {
+            continue;
+        }
+        if (state == SENSOR_READ) {
+            i2cSetupRead(z, zones.resultReg[z]);
+            batch |= ZONE_BIT(z);
+        } else if (sensorModes[z].oneShot || (sensorReconfigure & ZONE_BIT(z))) {
+            i2cSetupConfig(z);
+            batch |= ZONE_BIT(z);
+        } else if (sensorDrivers[z]->auxReg != TMP_REG_NONE) {
+            i2cSetupRead(z, sensorDrivers[z]->auxReg);
+            aux |= ZONE_BIT(z);
+        }
+    }
+    batch |= aux;
+    i2cDone = 0;
+    i2cQueued = batch;
+    i2cReading = (state == SENSOR_READ) ? batch : 0;
+    i2cAux = aux;
+    sensorCycleEnd = (state == SENSOR_READ);
+    i2cPending = batch;     // no callback can run yet
+    for (z = 0; z < zones.count; ++z) {
+        if ((batch & ZONE_BIT(z)) && !I2C_transfer(i2c, &i2cTransactions[z])) {
+            failed |= ZONE_BIT(z);
+        }
+    }
+    if (failed) {
+        key = HwiP_disable();
+        i2cPending &= ~failed;
+        HwiP_restore(key);
+    }
+    state = (state == SENSOR_READ) ? SENSOR_CONVERT : SENSOR_READ;
+    SENSOR_STATE = state;
+    return state;
+}
+
+/*
+ *  ======== readTemps ========
+ *  Collects the batch started by startTempRead and converts each result
+ *  with its zone's driver; returns the zones that have a new reading in
+ *  readings[]. A conversion that failed to start leaves the old result in
+ *  the sensor, so that zone is not read this cycle. A failed auxReg read
+ *  leaves the previous bytes in use. The readings then go through
+ *  sensorhealth.c, which drops the ones no working sensor returns. At the
+ *  end of a cycle sensorfault.c learns which zones read, and the two say
+ *  which to hold off; only changes are printed, so a dead sensor does not
+ *  fill the UART.
+ */
+uint32_t readTemps(void) {
+    uint32_t stuck = i2cPending, done = i2cDone, fresh = 0, good;
+    uint32_t failed = i2cQueued & ~(done & ~stuck);
+    SensorFaultChange change;
+    SensorHealthChange health;
+    uint8_t z;
+
+    if (stuck) {
+        // Still running a tick after they started: the bus is stuck
+        I2C_cancel(i2c);
+        DISPLAY("Timeout reading temperature sensor\n\r");
+    }
+    sensorFaultSweep(i2cQueued, failed, stuck != 0);
+    if (i2cReading) {
+        fresh = i2cReading & ~failed;
     } else {
-        state = BUTTON_WAIT;
+        sensorCycleFailed |= failed;
+        sensorReconfigure &= ~(i2cQueued & ~failed);
+    }
+    for (z = 0; z < zones.count; ++z) {
+        if ((i2cAux & ~failed) & ZONE_BIT(z)) {
+            memcpy(auxBuffers[z], rxBuffers[z], sizeof(auxBuffers[z]));
+            auxValid |= ZONE_BIT(z);
+        }
+        if (sensorDrivers[z]->auxReg != TMP_REG_NONE && !(auxValid & ZONE_BIT(z))) {
+            fresh &= ~ZONE_BIT(z);
+        }
+        if (fresh & ZONE_BIT(z)) {
+            readings[z] = sensorDrivers[z]->convert(rxBuffers[z], auxBuffers[z]);
+        }
+    }
+    good = sensorHealthSweep(fresh, readings, zones.heatMask, (uint32_t)(uptimeTicks * TIMER_PERIOD), &health);
+    for (z = 0; z < zones.count; ++z) {
+        if (health.suspect & ZONE_BIT(z)) {
+            DISPLAY("Zone %d reading rejected (%s)\n\r", z, healthVerdicts[health.verdict[z]]);
+        }
+        if (health.heatOff & ZONE_BIT(z)) {
+            DISPLAY("Zone %d readings suspect, heat off until one checks out\n\r", z);
+        }
+        if (health.restored & ZONE_BIT(z)) {
+            DISPLAY("Zone %d reading accepted again\n\r", z);
+        }
     }
+    if (sensorCycleEnd) {
+        sensorFaultCycleEnd(sensorCycle, fresh, &change);
+        for (z = 0; z < zones.count; ++z) {
+            if (change.failing & ZONE_BIT(z)) {
+                // A transfer still queued is one that hung
+                DISPLAY("Zone %d sensor not answering (%d), retrying\n\r", z,
+                        i2cTransactions[z].status == I2C_STATUS_QUEUED ? I2C_STATUS_TIMEOUT :
+                        i2cTransactions[z].status);
+            }
+            if (change.heatOff & ZONE_BIT(z)) {
+                DISPLAY("Zone %d sensor failed, heat off until it reads again\n\r", z);
+            }
+            if (change.restored & ZONE_BIT(z)) {
+                DISPLAY("Zone %d sensor reading again\n\r", z);
+            }
+        }
+        sensorCycleEnd = false;
+    }
+    zones.heatOff = sensorFaultHeatOff() | sensorHealthHeatOff();
+    i2cQueued = 0;
+    i2cReading = 0;
+    i2cAux = 0;
+    return good;
+}
 
-    switch (state) {
-    case INCREASE_TEMP:
-        if (setPointTemp < 40) {
-            setPointTemp +=1;
-            increaseTemp = 0;
+/*
+ * ======== adjustHeat ========
+ * One control sweep over every zone, from the readings each zone's
+ * driver converted to Q7 (see tmpsensor.h). The controllers time their
+ * output windows off the timer tick. Every output is written each sweep,
+ * so a pin that glitched is put right within a period. The sweep then
+ * tells samplerate.c what it read and changed, for the next cycles.
+ */
+int adjustHeat(int state) {
+    uint32_t fresh = readTemps(), nowMs = (uint32_t)(uptimeTicks * TIMER_PERIOD);
+    uint8_t z;
+
+    zonesControl(&zones, readings, fresh, nowMs);
+    for (z = 0; z < zones.count; ++z) {
+        GPIO_write(zones.output[z], zoneHeatOn(&zones, z) ? CONFIG_GPIO_LED_ON : CONFIG_GPIO_LED_OFF);
+    }
+    sampleRateUpdate(&sampling, &zones, fresh, nowMs);
+    state = HEAT_WAIT;
+    return state;
+
+}
+
+/*
+ *  ======== zoneStatus ========
+ *  A zone as a status record, for the single-zone report and the uplink.
+ */
+void zoneStatus(uint8_t zone, uint16_t sequence, TlmStatus *status) {
+    status->sequence = sequence;
+    status->uptime = (uint32_t)(uptimeTicks / TICKS_PER_SECOND);
+    status->temperature = zones.temperature[zone];  // Q7 is the wire format
+    status->setPoint = TEMP_Q7(zones.setPoint[zone]);
+    status->flags = zoneHeatOn(&zones, zone) ? TLM_FLAG_HEAT_ON : 0;
+}
+
+/*
+ *  ======== sendStatus ========
+ *  One status report in the telemetry format, covering every zone. A
+ *  heartbeat is a report sent only because TELEMETRY_HEARTBEAT_S passed
+ *  without a change. With one zone the report is the original status
+ *  record or tuple; with more, a zones record or one triple per zone.
+ */
+void sendStatus(bool heartbeat) {
+    uint8_t z;
+
+    if (telemetryFormat == TELEMETRY_BINARY) {
+        if (telemetrySequence == 0) {
+            txQueueWrite("", 1);    // delimiter: end whatever text came before
         }
-        state = BUTTON_WAIT;
-        break;
-    case DECREASE_TEMP:
-        if (setPointTemp > 10) {
-            setPointTemp -=1;
-            decreaseTemp = 0;
+        if (zones.count == 1) {
+            // Packed status record, see tlmframe.h
+            TlmStatus status;
+            uint8_t frame[TLM_FRAME_MAX(TLM_STATUS_SIZE)];
+
+            zoneStatus(0, telemetrySequence++, &status);
+            status.flags |= heartbeat ? TLM_FLAG_HEARTBEAT : 0;
+            txQueueWrite(frame, tlmEncodeStatus(&status, frame));
+        } else {
+            TlmZones record;
+            uint8_t frame[TLM_FRAME_MAX(TLM_ZONES_SIZE(ZONES_MAX))];
+
+            record.sequence = telemetrySequence++;
+            record.uptime = (uint32_t)(uptimeTicks / TICKS_PER_SECOND);
+            record.flags = heartbeat ? TLM_FLAG_HEARTBEAT : 0;
+            record.count = zones.count;
+            record.heatMask = zones.heatMask;
+            for (z = 0; z < zones.count; ++z) {
+                record.temperature[z] = zones.temperature[z];
+                record.setPoint[z] = TEMP_Q7(zones.setPoint[z]);
+            }
+            txQueueWrite(frame, tlmEncodeZones(&record, frame));
+        }
+    } else {
+        char line[ZONES_MAX * 14 + 16];
+        int n = 0;
+
+        for (z = 0; z < zones.count; ++z) {
+            n += snprintf(&line[n], sizeof(line) - n, "%02d, %02d, %d, ", tempWholeDegrees(zones.temperature[z]),
+                          zones.setPoint[z], zoneHeatOn(&zones, z));
+        }
+        DISPLAY("<%s%04lu>\n\r", line, (unsigned long)(uptimeTicks / TICKS_PER_SECOND));
+    }
+}
+
+/*
+ * ======== UART2Output ========
+ * Reports every telemetryInterval seconds, or in TELEMETRY_ON_CHANGE mode
+ * only when the temperature has moved more than telemetryDeadband since
+ * the last report, the set point or heat state changed, or the heartbeat
+ * is due.
+ */
+int UART2Output(int state) {
+    bool changed;
+    int delta;
+    uint8_t z;
+
+    ++telemetryElapsed;
+    if (telemetryMode == TELEMETRY_ON_CHANGE) {
+        changed = zones.heatMask != reportedHeatMask;
+        for (z = 0; z < zones.count && !changed; ++z) {
+            delta = zones.temperature[z] - reportedTemperature[z];
+            changed = (delta > telemetryDeadband || -delta > telemetryDeadband ||
+                       zones.setPoint[z] != reportedSetPoint[z]);
         }
-        state = BUTTON_WAIT;
+    } else {
+        changed = telemetryElapsed >= telemetryInterval;
+    }
+    if (changed || (telemetryMode == TELEMETRY_ON_CHANGE && telemetryElapsed >= TELEMETRY_HEARTBEAT_S)) {
+        state = UART2_UPDATE;
+    } else {
+        state = UART2_WAIT;
+    }
+
+    switch (state) {
+    case UART2_UPDATE:
+        sendStatus(!changed);
+        memcpy(reportedTemperature, zones.temperature, sizeof(reportedTemperature));
+        memcpy(reportedSetPoint, zones.setPoint, sizeof(reportedSetPoint));
+        reportedHeatMask = zones.heatMask;
+        telemetryElapsed = 0;
+        state = UART2_WAIT;
         break;
     default:
-        state = BUTTON_WAIT;
+        state = UART2_WAIT;
         break;
     }
-    BUTTON_STATE = state;
+    UART2_STATE = state;
     return state;
 }
 
-
 /*
- *  ======== readTemp ========
- *  Reads current temp from sensor.
+ *  ======== sendTaskStats ========
+ *  One record per task, one for the scheduler and one with the sensor
+ *  fault and health counters, in the telemetry format; in ASCII the two
+ *  sets of counters are a line each.
  */
-int16_t readTemp(void) {
-    int j;
-    i2cTransaction.readCount  = 2;
+void sendTaskStats(void) {
+    char line[160];
+    int n;
+    TaskStats stats;
+    SchedStats sched;
+    SensorFaultStats faults;
+    SensorHealthStats health;
+    uint32_t avg, load = taskStatsLoadPermille();
+    unsigned char i;
 
-    if (I2C_transfer(i2c, &i2cTransaction)) {
-        /* * Extract degrees C from the received data; * see TMP sensor datasheet */
-        temperature = (rxBuffer[0] << 8) | (rxBuffer[1]);
-        temperature *= 0.0078125;
+    for (i = 0; i < NUM_TASKS; ++i) {
+        taskStatsGet(i, &stats);
+        avg = stats.runs ? (uint32_t)(stats.totalCycles / stats.runs) : 0;
+        if (stats.runs == 0) {
+            stats.minCycles = 0;
+        }
+        if (telemetryFormat == TELEMETRY_BINARY) {
+            TlmTask record;
+            uint8_t frame[TLM_FRAME_MAX(TLM_TASK_SIZE)];
 
-        /* * If the MSB is set '1', then we have a 2's complement * negative value which needs to be sign extended */
-        if (rxBuffer[0] & 0x80) {
-            temperature |= 0xF000;
+            record.task = i;
+            record.runs = stats.runs;
+            record.minCycles = stats.minCycles;
+            record.avgCycles = avg;
+            record.maxCycles = stats.maxCycles;
+            record.maxJitter = stats.maxJitter;
+            record.lateReleases = stats.lateReleases > UINT16_MAX ? UINT16_MAX : (uint16_t)stats.lateReleases;
+            record.overruns = stats.overruns > UINT16_MAX ? UINT16_MAX : (uint16_t)stats.overruns;
+            record.skippedReleases = stats.skippedReleases > UINT16_MAX ? UINT16_MAX : (uint16_t)stats.skippedReleases;
+            record.maxResponse = stats.maxResponse;
+            txQueueWrite(frame, tlmEncodeTask(&record, frame));
+        } else {
+            n = snprintf(line, sizeof(line), "# task %d: %lu runs, cycles %lu/%lu/%lu, jitter %lu, response %lu, "
+                         "late %lu, skipped %lu, overruns %lu\n\r",
+                         i, (unsigned long)stats.runs, (unsigned long)stats.minCycles,
+                         (unsigned long)avg, (unsigned long)stats.maxCycles,
+                         (unsigned long)stats.maxJitter, (unsigned long)stats.maxResponse,
+                         (unsigned long)stats.lateReleases, (unsigned long)stats.skippedReleases,
+                         (unsigned long)stats.overruns);
+            if (n > 0) {
+                txQueueWrite(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);   // longer than a DISPLAY line
+            }
         }
+    }
+
+    taskStatsGetSched(&sched);
+    avg = sched.passes ? (uint32_t)(sched.totalLatency / sched.passes) : 0;
+    if (sched.passes == 0) {
+        sched.minLatency = 0;
+    }
+    if (telemetryFormat == TELEMETRY_BINARY) {
+        TlmSched record;
+        uint8_t frame[TLM_FRAME_MAX(TLM_SCHED_SIZE)];
+
+        record.passes = sched.passes;
+        record.ticks = sched.ticks;
+        record.overruns = sched.overruns > UINT16_MAX ? UINT16_MAX : (uint16_t)sched.overruns;
+        record.minLatency = sched.minLatency;
+        record.avgLatency = avg;
+        record.maxLatency = sched.maxLatency;
+        record.loadPermille = (uint16_t)load;
+        txQueueWrite(frame, tlmEncodeSched(&record, frame));
     } else {
-        DISPLAY("Error reading temperature sensor (%d)\n\r",i2cTransaction.status);
-        DISPLAY("Please power cycle your board by unplugging USB and plugging back in.\n\r");
+        DISPLAY("# sched: %lu passes, %lu ticks, overruns %lu, wake %lu/%lu/%lu, load %lu.%lu%%\n\r",
+                (unsigned long)sched.passes, (unsigned long)sched.ticks,
+                (unsigned long)sched.overruns, (unsigned long)sched.minLatency,
+                (unsigned long)avg, (unsigned long)sched.maxLatency,
+                (unsigned long)(load / 10), (unsigned long)(load % 10));
     }
-    return temperature;
 
+    sensorFaultGetStats(&faults);
+    sensorHealthGetStats(&health);
+    if (telemetryFormat == TELEMETRY_BINARY) {
+        TlmFaults record;
+        uint8_t frame[TLM_FRAME_MAX(TLM_FAULTS_SIZE)];
+
+        record.failedTransfers = faults.failedTransfers;
+        record.timeouts = faults.timeouts;
+        record.recoveries = faults.recoveries;
+        record.failSafes = faults.failSafes;
+        record.failing = faults.failing;
+        record.heatOff = faults.heatOff;
+        record.spikes = health.spikes;
+        record.jumps = health.jumps;
+        record.outOfRange = health.outOfRange;
+        record.stuck = health.stuck;
+        record.suspect = health.suspect;
+        record.suspectHeatOff = health.heatOff;
+        txQueueWrite(frame, tlmEncodeFaults(&record, frame));
+    } else {
+        DISPLAY("# i2c: %lu failed, %lu timeouts, %lu recoveries, %lu fail-safes, failing %lx, heat off %lx\n\r",
+                (unsigned long)faults.failedTransfers, (unsigned long)faults.timeouts,
+                (unsigned long)faults.recoveries, (unsigned long)faults.failSafes,
+                (unsigned long)faults.failing, (unsigned long)faults.heatOff);
+        DISPLAY("# readings: %lu spikes, %lu jumps, %lu out of range, %lu stuck, suspect %lx, heat off %lx\n\r",
+                (unsigned long)health.spikes, (unsigned long)health.jumps,
+                (unsigned long)health.outOfRange, (unsigned long)health.stuck,
+                (unsigned long)health.suspect, (unsigned long)health.heatOff);
+    }
 }
 
 /*
- * ======== adjustHeat ========
+ *  ======== bootReport ========
+ *  When each init step finished, in ms from the top of mainThread (see
+ *  bootphase.h), as one text line.
  */
-int adjustHeat(int state) {
-    temperature = readTemp();
-    if (temperature >= setPointTemp) {
-        heatOn = 0;
-        GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF); // Turn off LED
+void bootReport(void) {
+    char line[160];
+    size_t n = 0;
+    uint32_t us;
+    int i;
+
+    n = (size_t)snprintf(line, sizeof(line), "# boot ms:");
+    for (i = 0; i < BOOT_PHASES && n < sizeof(line); ++i) {
+        us = bootPhaseUs((enum BOOT_PHASES)i);
+        if (us != 0) {
+            n += (size_t)snprintf(line + n, sizeof(line) - n, " %s %lu.%03lu", bootPhaseName((enum BOOT_PHASES)i),
+                                  (unsigned long)(us / 1000), (unsigned long)(us % 1000));
+        }
     }
-    else {
-        heatOn = 1;
-        GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON); // Turn on LED
+    if (n > sizeof(line) - 3) {
+        n = sizeof(line) - 3;
     }
-    state = HEAT_WAIT;
+    memcpy(line + n, "\n\r", 2);
+    txQueueWrite(line, n + 2);  // longer than a DISPLAY line
+}
+
+/*
+ * ======== reportTaskStats ========
+ */
+int reportTaskStats(int state) {
+    if (statsRequested || ++statsElapsed >= TASKSTATS_REPORT_S) {
+        state = STATS_REPORT;
+    } else {
+        state = STATS_WAIT;
+    }
+
+    switch (state) {
+    case STATS_REPORT:
+        statsRequested = 0;
+        statsElapsed = 0;
+        sendTaskStats();
+        state = STATS_WAIT;
+        break;
+    default:
+        state = STATS_WAIT;
+        break;
+    }
+    STATS_STATE = state;
+    return state;
+}
+
+/*
+ *  ======== logHistory ========
+ *  Hands the history log a sample (it keeps one a minute) once zone 0 has
+ *  a reading, flushes it when asked and streams the log out while an
+ *  export is running, a UART queue's worth per tick.
+ */
+int logHistory(int state) {
+    if (!(zones.unread & ZONE_BIT(0))) {
+        histLogSample((uint32_t)(uptimeTicks / TICKS_PER_SECOND), zones.temperature[0], zones.setPoint[0],
+                      zoneHeatOn(&zones, 0));
+    }
+
+    if (flushRequested) {
+        flushRequested = 0;
+        histLogFlush();
+    }
+
+    if (logRequested && !histLogExporting()) {
+        logRequested = 0;
+        histLogExportStart();
+    }
+    state = histLogExporting() ? LOG_EXPORT : LOG_WAIT;
+
+    switch (state) {
+    case LOG_EXPORT:
+        state = histLogExportStep() ? LOG_EXPORT : LOG_WAIT;
+        break;
+    default:
+        state = LOG_WAIT;
+        break;
+    }
+    LOG_STATE = state;
     return state;
+}
+
+/*
+ *  ======== wifiUplink ========
+ *  Queues a reading every UPLINK_SAMPLE_S and lets the uplink run its
+ *  radio session, one non-blocking step per second.
+ */
+int wifiUplink(int state) {
+    TlmStatus status;
 
+    if (++uplinkElapsed >= UPLINK_SAMPLE_S) {
+        state = WIFI_SAMPLE;
+    } else {
+        state = WIFI_WAIT;
+    }
+
+    switch (state) {
+    case WIFI_SAMPLE:
+        uplinkElapsed = 0;
+        zoneStatus(0, uplinkSequence++, &status);
+        uplinkQueue(&status);
+        state = WIFI_WAIT;
+        break;
+    default:
+        state = WIFI_WAIT;
+        break;
+    }
+    uplinkRun((uint32_t)(uptimeTicks / TICKS_PER_SECOND));
+    WIFI_STATE = state;
+    return state;
 }
 
 /*
- * ======== UART2Output ========
+ *  ======== Commands ========
+ *  Handlers for the UART command lines (see cmdline.h). They run in the
+ *  command task and set plain globals; work that belongs to another task's
+ *  module, like a log flush, is left to that task with a request flag, so
+ *  a task thread (THERMOSTAT_RTOS) never calls into a module mid-call.
  */
-int UART2Output(int state) {
-    DISPLAY("<%02d, %02d, %d, %04d>\n\r", temperature, setPointTemp, heatOn, seconds);
+
+// Q7 as degrees with two decimals, for replies
+#define Q7_CENTI(t) ((t) < 0 ? "-" : ""), (((t) < 0 ? -(t) : (t)) * 100 / TEMP_Q7_ONE) / 100, \
+                    (((t) < 0 ? -(t) : (t)) * 100 / TEMP_Q7_ONE) % 100
+
+static int cmdStatus(int argc, char *argv[]) {
+    uint8_t z;
+
+    for (z = 0; z < zones.count; ++z) {
+        DISPLAY("# zone %d: temperature %s%d.%02d, set point %d, heat %d, duty %d.%d%%, read every %d s\n\r",
+                z, Q7_CENTI(zones.temperature[z]), zones.setPoint[z], zoneHeatOn(&zones, z),
+                zones.control[z].duty / 10, zones.control[z].duty % 10,
+                sampling.interval[z] * 2 * SENSOR_PERIOD / 1000);
+    }
+    DISPLAY("# uptime %lu\n\r", (unsigned long)(uptimeTicks / TICKS_PER_SECOND));
+    DISPLAY("# format %s, mode %s, interval %d, deadband %s%d.%02d\n\r",
+            telemetryFormat == TELEMETRY_BINARY ? "binary" : "ascii",
+            telemetryMode == TELEMETRY_ON_CHANGE ? "change" : "periodic",
+            telemetryInterval, Q7_CENTI(telemetryDeadband));
+    return 0;
+}
+
+static int cmdSet(int argc, char *argv[]) {
+    int32_t value, zone = 0;
+
+    if (argc < 2 || argc > 3 || !cmdLineParseInt(argv[1], &value) ||
+        value < ZONE_SET_POINT_MIN || value > ZONE_SET_POINT_MAX) {
+        return -1;
+    }
+    if (argc == 3 && (!cmdLineParseInt(argv[2], &zone) || zone < 0 || zone >= zones.count)) {
+        return -1;
+    }
+    zones.setPoint[zone] = (int8_t)value;
+    return 0;
+}
+
+static int cmdInterval(int argc, char *argv[]) {
+    int32_t value;
+
+    if (argc != 2 || !cmdLineParseInt(argv[1], &value) ||
+        value < 1 || value > TELEMETRY_INTERVAL_MAX_S) {
+        return -1;
+    }
+    telemetryInterval = (int)value;
+    return 0;
+}
+
+static int cmdMode(int argc, char *argv[]) {
+    if (argc == 2 && strcmp(argv[1], "periodic") == 0) {
+        telemetryMode = TELEMETRY_PERIODIC;
+    } else if (argc == 2 && strcmp(argv[1], "change") == 0) {
+        telemetryMode = TELEMETRY_ON_CHANGE;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int cmdDeadband(int argc, char *argv[]) {
+    int32_t value;
+
+    if (argc != 2 || !cmdLineParseFixed(argv[1], TEMP_Q7_SHIFT, &value) ||
+        value < 0 || value > TEMP_Q7(10)) {
+        return -1;
+    }
+    telemetryDeadband = (tempq7_t)value;
+    return 0;
+}
+
+static int cmdFormat(int argc, char *argv[]) {
+    if (argc == 2 && strcmp(argv[1], "ascii") == 0) {
+        telemetryFormat = TELEMETRY_ASCII;
+    } else if (argc == 2 && strcmp(argv[1], "binary") == 0) {
+        telemetryFormat = TELEMETRY_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int cmdStats(int argc, char *argv[]) {
+    statsRequested = 1;
+    return argc == 1 ? 0 : -1;
+}
+
+static int cmdLog(int argc, char *argv[]) {
+    logRequested = 1;
+    return argc == 1 ? 0 : -1;
+}
+
+static int cmdBoot(int argc, char *argv[]) {
+    bootReport();
+    return argc == 1 ? 0 : -1;
+}
+
+static int cmdFlush(int argc, char *argv[]) {
+    flushRequested = 1;
+    return argc == 1 ? 0 : -1;
+}
+
+static const CmdLineCommand commands[] = {
+    { "status",   "",                   cmdStatus },
+    { "set",      "<10..40 degC> [zone]", cmdSet },
+    { "interval", "<1..3600 s>",        cmdInterval },
+    { "mode",     "periodic|change",    cmdMode },
+    { "deadband", "<0..10 degC>",       cmdDeadband },
+    { "format",   "ascii|binary",       cmdFormat },
+    { "stats",    "",                   cmdStats },
+    { "log",      "",                   cmdLog },
+    { "flush",    "",                   cmdFlush },
+    { "boot",     "",                   cmdBoot },
+};
+
+/*
+ * ======== runCommands ========
+ */
+int runCommands(int state) {
+    state = cmdLinePending() ? CMD_EXECUTE : CMD_WAIT;
+
+    switch (state) {
+    case CMD_EXECUTE:
+        cmdLineExecute(commands, sizeof(commands) / sizeof(commands[0]));
+        state = CMD_WAIT;
+        break;
+    default:
+        state = CMD_WAIT;
+        break;
+    }
+    CMD_STATE = state;
     return state;
 }
 
+#if !defined(THERMOSTAT_RTOS)
+/*
+ *  ======== scheduleWakeup ========
+ *  Arms the timer callback to wake the scheduler at the first tick after
+ *  `now` (dispatch table entry `slot`) that releases a task other than the
+ *  event-driven ones. Those only count while they have work: a queued
+ *  button event or command line, or a log flush or export in progress.
+ *  Otherwise the callback that queues an event pulls the wakeup in.
+ */
+void scheduleWakeup(unsigned long now, unsigned char slot) {
+    unsigned long next = 0;
+    uintptr_t key;
+
+    do {
+        ++next;
+        slot = (slot + 1 == HYPERPERIOD_TICKS) ? 0 : slot + 1;
+    } while (next < HYPERPERIOD_TICKS &&
+             !(dispatchTable[slot] & ~TASK_EVENT_MASK & ~restingTasks(now + next)));
+
+    key = HwiP_disable();
+    eventTick = now + 1;
+    wakeTick = now + next;
+    TimerFlag = 0;
+    if (eventWork()) {
+        wakeForEvent();
+    } else if ((long)(tickCount - wakeTick) >= 0) {
+        taskStatsWake();
+        TimerFlag = 1;  // overran into the next release
+    }
+    HwiP_restore(key);
+}
+
+/*
+ *  ======== idleUntilDue ========
+ *  Sleeps until the timer or a button callback raises TimerFlag.
+ *  Interrupts are masked around the check so a wakeup raised just before
+ *  sleeping is not lost; a pending interrupt still ends the sleep. The
+ *  Power policy chooses LPDS when no driver constraint forbids it and
+ *  plain Sleep otherwise (the running tick timer holds such a constraint).
+ */
+void idleUntilDue(void) {
+    uintptr_t key;
+
+    key = HwiP_disable();
+    while (!TimerFlag) {
+        Power_idleFunc();
+        HwiP_restore(key);  // service the interrupt that woke us
+        key = HwiP_disable();
+    }
+    TimerFlag = 0;          // lower flag raised by timer
+    HwiP_restore(key);
+}
+
+/*
+ *  ======== runScheduler ========
+ *  The NoRTOS scheduler: one pass per wakeup runs the tasks released
+ *  since the last, in table order, then sleeps until the next is due.
+ */
+void runScheduler(void)
+{
+    unsigned long lastTick = 0;
+    unsigned char slot = 0;             // dispatch table entry of lastTick
+    uint8_t due = dispatchTable[0];     // tasks released since the last pass
+    uint8_t late = 0;                   // the ones released before lastTick
+    uint8_t releases[NUM_TASKS] = {0}; // releases since the last pass, when late
+
+    while (1) {
+        unsigned char i, runs, n;
+        unsigned long ticks, tick;
+        uint32_t start;
+        uint8_t mask;
+        for (i = 0; i < NUM_TASKS; ++i) {
+            if (!(due & TASK_BIT(i))) {
+                continue;
+            }
+            // Once on time; a late task catches up or skips by its policy
+            runs = 1;
+            if (late & TASK_BIT(i)) {
+                if (TASK_CATCH_UP_MASK & TASK_BIT(i)) {
+                    runs = releases[i] < TASK_CATCH_UP_MAX ? releases[i] : TASK_CATCH_UP_MAX;
+                }
+                taskStatsSkipped(i, releases[i] - runs);
+            }
+            for (n = 0; n < runs; ++n) {
+                tick = tickCount;
+                start = taskStatsTaskStart(i);
+                tasks[i].state = tasks[i].TickFct(tasks[i].state);
+                taskStatsTaskEnd(i, start, (late >> i) & 1, tickCount != tick);
+            }
+        }
+        if (tickCount != lastTick) {
+            taskStatsPassOverrun();     // the next tick came before we finished
+        }
+
+        // Sleep through the ticks where no task is due
+        scheduleWakeup(lastTick, slot);
+        idleUntilDue();
+
+        // Collect the releases of every tick since the last pass; any but
+        // the newest tick's are late. Event-driven tasks are never late.
+        ticks = tickCount - lastTick;
+        due = late = 0;
+        memset(releases, 0, sizeof(releases));
+        for (tick = 0; tick < ticks; ++tick) {
+            slot = (slot + 1 == HYPERPERIOD_TICKS) ? 0 : slot + 1;
+            late |= due;
+            mask = dispatchTable[slot] & ~restingTasks(lastTick + tick + 1);
+            due |= mask;
+            for (i = 0; mask != 0; ++i, mask >>= 1) {
+                if ((mask & 1) && releases[i] < UINT8_MAX) {
+                    releases[i]++;
+                }
+            }
+        }
+        late &= ~TASK_EVENT_MASK;
+
+        // 64-bit uptime from the interrupt's tick count: no tick is lost
+        // however long the pass took, and it will not wrap in service
+        lastTick += ticks;
+        uptimeTicks += ticks;
+        taskStatsPass(ticks);
+    }
+}
+#else
+/*
+ *  ======== Task Threads ========
+ *  THERMOSTAT_RTOS: each task is a POSIX thread at the priority TASK_SET
+ *  gives it, so a long flash commit in the log task no longer holds up the
+ *  heat decision behind it. The timer callback releases the tasks due in
+ *  each tick, and the event-driven ones with them or when they have work;
+ *  a release posts the task's semaphore and counts, so a thread that was
+ *  held up applies its policy to the releases it missed.
+ */
+
+// A detached thread. The host refuses RTOS priorities and stack sizes and
+// keeps its own, so only the creation has to succeed.
+static int startThread(void *(*fxn)(void *), void *arg, int priority, size_t stackSize)
+{
+    pthread_t thread;
+    pthread_attr_t attrs;
+    struct sched_param priParam;
+    int rc;
+
+    pthread_attr_init(&attrs);
+    priParam.sched_priority = priority;
+    pthread_attr_setschedparam(&attrs, &priParam);
+    pthread_attr_setstacksize(&attrs, stackSize);
+    rc = pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+    if (rc == 0) {
+        rc = pthread_create(&thread, &attrs, fxn, arg);
+    }
+    pthread_attr_destroy(&attrs);
+    return rc;
+}
+
+static void *taskThread(void *arg0)
+{
+    unsigned char i = (unsigned char)(uintptr_t)arg0;
+    unsigned char runs, n;
+    unsigned long lateTicks, tick;
+    uint8_t releases;
+    uint32_t start;
+    uintptr_t key;
+
+    while (1) {
+        SemaphoreP_pend(taskSems[i], SemaphoreP_WAIT_FOREVER);
+        key = HwiP_disable();
+        releases = taskReleases[i];
+        lateTicks = tickCount - taskReleaseTick[i];
+        taskReleases[i] = 0;
+        HwiP_restore(key);
+
+        // Once on time; a late task catches up or skips by its policy.
+        // Event-driven tasks are never late, every run takes all their work.
+        runs = 1;
+        if (TASK_EVENT_MASK & TASK_BIT(i)) {
+            lateTicks = 0;
+        } else if (releases > 1) {
+            if (TASK_CATCH_UP_MASK & TASK_BIT(i)) {
+                runs = releases < TASK_CATCH_UP_MAX ? releases : TASK_CATCH_UP_MAX;
+            }
+            taskStatsSkipped(i, releases - runs);
+        }
+        for (n = 0; n < runs; ++n) {
+            tick = tickCount;
+            start = taskStatsTaskStart(i);
+            tasks[i].state = tasks[i].TickFct(tasks[i].state);
+            taskStatsTaskEnd(i, start, lateTicks, tickCount != tick);
+        }
+    }
+
+    return (NULL);
+}
+
+static void startTaskThreads(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < NUM_TASKS; ++i) {
+        taskSems[i] = SemaphoreP_createBinary(0);
+        if (taskSems[i] == NULL ||
+            startThread(taskThread, (void *)(uintptr_t)i, tasks[i].priority, TASK_STACK_SIZE) != 0) {
+            DISPLAY("Task thread failed\n\r");
+            while (1);
+        }
+    }
+}
+#endif
+
 /*
  *  ======== mainThread ========
  */
 void *mainThread(void *arg0)
 {
-    task tasks[NUM_TASKS] = {
-                            // Task 0: Check button state, change set-point temp
-                            {.state = BUTTON_WAIT,
-                             .period = 200,
-                             .elapsedTime = 200,
-                             .TickFct = &changeSetPointTemp
-                            },
-                            // Task 1: Read temp sensor and adjust heat (update LED)
-                            {.state = HEAT_WAIT,
-                             .period = 500,
-                             .elapsedTime = 500,
-                             .TickFct = &adjustHeat
-                            },
-                            // Task 2: Update server
-                            {.state = UART2_WAIT,
-                             .period = 1000,
-                             .elapsedTime = 1000,
-                             .TickFct = &UART2Output
-                            }
-    };
+#if defined(THERMOSTAT_RTOS)
+    uintptr_t key;
+#endif
+
     /* Call driver init functions */
+    bootPhaseStart();
     initUART2();
+    bootPhaseMark(BOOT_UART);
     initI2C();
+    bootPhaseMark(BOOT_SENSORS);
     initGPIO();
-    initTimer();
+    bootPhaseMark(BOOT_GPIO);
 
-    while (1) {
-        unsigned char i;
-        for (i = 0; i < NUM_TASKS; ++i) {
-            if (tasks[i].elapsedTime >= tasks[i].period) {
-                tasks[i].state = tasks[i].TickFct(tasks[i].state);
-                tasks[i].elapsedTime = 0;
-            }
-            tasks[i].elapsedTime += TIMER_PERIOD;
-        }
+    /*
+     * Decide the heat from the boot readings before anything that starts
+     * the network processor: sl_Start() alone takes tens of milliseconds.
+     */
+    HEAT_STATE = adjustHeat(HEAT_STATE);
+    bootPhaseMark(BOOT_FIRST_HEAT);
 
-        while (!TimerFlag){} // wait for timer period
-        TimerFlag = 0;      // lower flag raised by timer
-        ++seconds;
+#if defined(THERMOSTAT_RTOS)
+    // SimpleLink's spawn thread delivers its events; sl_Start() needs it
+    if (startThread(sl_Task, NULL, SPAWN_PRIORITY, SPAWN_STACK_SIZE) != 0) {
+        DISPLAY("Spawn thread failed\n\r");
+        while (1);
     }
+#endif
+    initPower();
+    histLogInit();
+    bootPhaseMark(BOOT_LOG);
+    uplinkInit();
+    bootPhaseMark(BOOT_UPLINK);
+    taskStatsInit(TIMER_PERIOD * 1000UL * CYCLES_PER_US);
+#if defined(THERMOSTAT_RTOS)
+    startTaskThreads();
+#endif
+    initTimer();
+    bootPhaseMark(BOOT_SCHEDULER);
+    bootReport();
+
+#if defined(THERMOSTAT_RTOS)
+    // The boot pass, released by nothing; the timer releases the rest
+    key = HwiP_disable();
+    releaseTasks(dispatchTable[0] | TASK_EVENT_MASK);
+    HwiP_restore(key);
+#else
+    runScheduler();
+#endif
 
     return (NULL);
 }
@@ -0,0 +1,136 @@
+/*
+ *  ======== heatctl.c ========
+ *  Per-zone heat controller, see heatctl.h.
+ *
+ *  The measurement and error are Q15 degC, the integral per mille Q16.
+ *  The products that can pass 32 bits are widened to 64, which is a
+ *  multiply and a shift on the M4; the only divides are 32-bit ones.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "heatctl.h"
+#include "tempq7.h"
+
+#if HEAT_TI_S < 1
+#error "HEAT_TI_S must be at least 1 s"
+#endif
+
+#define ERROR_MAX   ((int32_t)32 << 15)     // degC of error that counts, Q15
+#define DELTA_MAX   ((int32_t)1 << 15)      // measurement step the derivative takes, Q15
+
+// Integral gain: per mille Q16 per Q15 degC per ms, Q24
+#define KI  ((int64_t)(((uint64_t)HEAT_KP << 24) / (500ull * HEAT_TI_S)))
+
+// Derivative gain: per mille ms per Q15 degC
+#define KD  ((int32_t)((uint64_t)HEAT_KP * HEAT_TD_S * 1000 / 32768))
+
+#if HEAT_KP < 0 || HEAT_KP > 2000 || HEAT_KP * HEAT_TD_S * 1000 / 32768 > 65535
+#error "HEAT_KP or HEAT_KP * HEAT_TD_S too large for 32-bit terms"
+#endif
+
+#define ON_MS_PER_DUTY  (HEAT_WINDOW_MS / HEAT_DUTY_MAX)
+
+void heatCtlInit(HeatCtl *ctl)
+{
+    memset(ctl, 0, sizeof(*ctl));
+}
+
+/* Time since the last call, at most HEAT_DT_MAX_MS; moves the window on */
+static uint32_t elapsed(HeatCtl *ctl, uint32_t nowMs)
+{
+    uint32_t dt = nowMs - ctl->lastMs;
+
+    if (dt > HEAT_DT_MAX_MS) {
+        dt = HEAT_DT_MAX_MS;
+    }
+    ctl->lastMs = nowMs;
+    ctl->windowMs += dt;
+    if (ctl->windowMs >= HEAT_WINDOW_MS) {
+        ctl->windowMs -= HEAT_WINDOW_MS;
+        ctl->cycled = false;
+    }
+    return dt;
+}
+
+/* The output's on time this window for the duty, with the minimums applied */
+static uint32_t onTime(uint16_t duty)
+{
+    uint32_t onMs = duty * ON_MS_PER_DUTY;
+
+    if (onMs < HEAT_MIN_ON_MS) {
+        onMs = onMs * 2 >= HEAT_MIN_ON_MS ? HEAT_MIN_ON_MS : 0;
+    }
+    if (HEAT_WINDOW_MS - onMs < HEAT_MIN_OFF_MS) {
+        onMs = (HEAT_WINDOW_MS - onMs) * 2 >= HEAT_MIN_OFF_MS ?
+               HEAT_WINDOW_MS - HEAT_MIN_OFF_MS : HEAT_WINDOW_MS;
+    }
+    return onMs;
+}
+
+bool heatCtlUpdate(HeatCtl *ctl, tempq7_t temperature, tempq7_t setPoint, uint32_t nowMs)
+{
+    uint32_t dt = elapsed(ctl, nowMs), alpha;
+    int32_t x = (int32_t)temperature << 8, last, delta, error, p, d, out;
+    bool want;
+
+    // Smooth the measurement; the first reading after init or a hold seeds it
+    if (!ctl->seeded) {
+        ctl->filtered = x;
+        ctl->seeded = true;
+    }
+    last = ctl->filtered;
+    alpha = (dt << 16) / (HEAT_FILTER_MS + dt);
+    ctl->filtered += (int32_t)(((int64_t)(x - last) * alpha) >> 16);
+
+    error = ((int32_t)setPoint << 8) - ctl->filtered;
+    if (error > ERROR_MAX) {
+        error = ERROR_MAX;
+    } else if (error < -ERROR_MAX) {
+        error = -ERROR_MAX;
+    }
+    delta = ctl->filtered - last;
+    if (delta > DELTA_MAX) {
+        delta = DELTA_MAX;
+    } else if (delta < -DELTA_MAX) {
+        delta = -DELTA_MAX;
+    }
+    p = HEAT_KP * error / 32768;
+    d = dt != 0 ? -(delta * KD) / (int32_t)dt : 0;
+
+    // Integrate unless the output is already pinned the way the error pushes
+    out = p + (ctl->integral >> 16) + d;
+    if (!(out >= HEAT_DUTY_MAX && error > 0) && !(out <= 0 && error < 0)) {
+        ctl->integral += (int32_t)(((int64_t)error * dt * KI) >> 24);
+        if (ctl->integral > ((int32_t)HEAT_DUTY_MAX << 16)) {
+            ctl->integral = (int32_t)HEAT_DUTY_MAX << 16;
+        } else if (ctl->integral < 0) {
+            ctl->integral = 0;
+        }
+        out = p + (ctl->integral >> 16) + d;
+    }
+    ctl->duty = (uint16_t)(out > HEAT_DUTY_MAX ? HEAT_DUTY_MAX : out < 0 ? 0 : out);
+
+    // One on stretch per window, switched no sooner than the minimums allow
+    want = ctl->windowMs < onTime(ctl->duty) && (ctl->on || !ctl->cycled);
+    if (want != ctl->on &&
+        (!ctl->started || nowMs - ctl->switchMs >= (ctl->on ? HEAT_MIN_ON_MS : HEAT_MIN_OFF_MS))) {
+        ctl->on = want;
+        ctl->switchMs = nowMs;
+    }
+    ctl->started = true;
+    ctl->cycled |= ctl->on;
+    return ctl->on;
+}
+
+void heatCtlHold(HeatCtl *ctl, uint32_t nowMs)
+{
+    elapsed(ctl, nowMs);
+    if (ctl->on) {
+        ctl->on = false;
+        ctl->switchMs = nowMs;
+    }
+    ctl->duty = 0;
+    ctl->seeded = false;
+}
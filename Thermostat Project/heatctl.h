@@ -0,0 +1,91 @@
+/*
+ *  ======== heatctl.h ========
+ *  Per-zone heat controller: integer PID driving a time-proportioned output.
+ *
+ *  Each update turns the error against the set point into a duty, 0 to
+ *  HEAT_DUTY_MAX per mille, from a proportional band, an integral that
+ *  trims out the steady-state load and a derivative on the measurement
+ *  (so a set point step does not kick). The measurement is smoothed over
+ *  HEAT_FILTER_MS first, which also filters the derivative. The integral
+ *  does not move while the output is saturated in the direction the error
+ *  pushes it and is kept within the duty range, so a long cold start or
+ *  an open window does not wind it up into an overshoot.
+ *
+ *  The duty becomes a slow PWM: the output is on for duty of every
+ *  HEAT_WINDOW_MS window, timed by the caller's clock (the scheduler
+ *  tick). An on or off stretch shorter than HEAT_MIN_ON_MS or
+ *  HEAT_MIN_OFF_MS is rounded to none or to the minimum, and the output
+ *  never switches again before its minimum has passed, so a heater sees
+ *  at most one cycle per window however noisy the reading.
+ *
+ *  An update is straight-line integer code, a few multiplies and two
+ *  32-bit divides; no floating point. Plain C with no driver
+ *  dependencies; zones.c runs one per zone.
+ */
+#ifndef HEATCTL_H_
+#define HEATCTL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+
+#ifndef HEAT_KP
+#define HEAT_KP         800     // per mille duty per degC of error
+#endif
+#ifndef HEAT_TI_S
+#define HEAT_TI_S       900     // integral time, s
+#endif
+#ifndef HEAT_TD_S
+#define HEAT_TD_S       60      // derivative time, s; 0 for PI
+#endif
+#ifndef HEAT_FILTER_MS
+#define HEAT_FILTER_MS  60000   // measurement smoothing time constant
+#endif
+#ifndef HEAT_WINDOW_MS
+#define HEAT_WINDOW_MS  600000  // time-proportioning window
+#endif
+#ifndef HEAT_MIN_ON_MS
+#define HEAT_MIN_ON_MS  60000
+#endif
+#ifndef HEAT_MIN_OFF_MS
+#define HEAT_MIN_OFF_MS 60000
+#endif
+
+#define HEAT_DUTY_MAX   1000    // per mille
+#define HEAT_DT_MAX_MS  60000   // longest step the integral and filter take
+
+#if HEAT_MIN_ON_MS + HEAT_MIN_OFF_MS > HEAT_WINDOW_MS || HEAT_WINDOW_MS % HEAT_DUTY_MAX != 0
+#error "the window must hold a minimum on and off time and be whole ms per mille"
+#endif
+
+typedef struct {
+    int32_t     integral;   // per mille duty, Q16
+    int32_t     filtered;   // smoothed measurement, Q15 degC
+    uint32_t    lastMs;     // clock at the last update
+    uint32_t    switchMs;   // clock when the output last switched
+    uint32_t    windowMs;   // time into the current window
+    uint16_t    duty;       // per mille
+    bool        on;         // output
+    bool        started;    // updated since init: the first switch need not wait
+    bool        cycled;     // on at some point this window
+    bool        seeded;     // filtered holds a reading
+} HeatCtl;
+
+extern void heatCtlInit(HeatCtl *ctl);
+
+/*
+ * One update at nowMs, in ms on a free-running clock; returns whether the
+ * output is on. Updates may come at any interval, but the output can only
+ * switch on one.
+ */
+extern bool heatCtlUpdate(HeatCtl *ctl, tempq7_t temperature, tempq7_t setPoint, uint32_t nowMs);
+
+/*
+ * Output off now, whatever the minimum on time, for a zone without a
+ * reading to act on. The integral is kept; the filter starts over from
+ * the next reading.
+ */
+extern void heatCtlHold(HeatCtl *ctl, uint32_t nowMs);
+
+#endif /* HEATCTL_H_ */
@@ -0,0 +1,519 @@
+/*
+ *  ======== histlog.c ========
+ *  Temperature history ring in serial flash, see histlog.h.
+ *
+ *  The network processor owns the serial flash, so every file system
+ *  session holds it through nwp.h; the log is written about once an hour
+ *  and the NWP can stay off in between.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/net/wifi/simplelink.h>
+
+#include "histlog.h"
+#include "nwp.h"
+#include "tlmframe.h"
+#include "txqueue.h"
+
+#define LOG_PAYLOAD_MAX     (LOG_SEGMENT_SIZE - LOG_HEADER_SIZE)
+#define LOG_SAMPLE_MAX      16      // header byte and three varints
+
+#define LOG_HEAT_ON         0x10
+#define LOG_SET_CHANGED     0x20
+#define LOG_TIME_GAP        0x40
+#define LOG_BOOT            0x80
+#define LOG_TEMP_MASK       0x0F
+#define LOG_TEMP_ESCAPE     0x08
+
+#define LOG_VERSION_XOR_CRC 1       // header and payload CRCs XORed; still read
+
+// Last sample, the base the next one is encoded against
+typedef struct {
+    uint32_t time;          // uptime, seconds
+    int16_t  temperature;   // 1/16 degC
+    int8_t   setPoint;      // whole degC
+} LogState;
+
+static uint8_t segment[LOG_SEGMENT_SIZE];   // segment being filled
+static uint16_t used;                       // bytes of it in use, header included
+static uint16_t segmentBoot;                // boot of the segment's first sample
+static LogState base;                       // state before the segment's first sample
+static LogState last;
+static bool haveSample;
+static bool dirty;                          // samples not yet on flash
+static uint32_t lastFlush;
+static HistLogStats stats;
+
+// Export state; exportBuf doubles as scratch space for histLogInit()
+static uint8_t exportBuf[LOG_SEGMENT_SIZE];
+static struct {
+    bool     active;
+    uint32_t next;          // sequence of the next segment to load
+    uint16_t pos;           // read position in exportBuf
+    uint16_t len;           // end of the loaded payload
+    uint16_t boot;
+    LogState state;
+    uint32_t lines;
+} exporter;
+
+/*
+ *  ======== Encoding ========
+ */
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static size_t putVarint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns false if the varint runs past end
+static bool getVarint(const uint8_t *p, uint16_t *pos, uint16_t end, uint32_t *v)
+{
+    uint8_t shift = 0;
+
+    *v = 0;
+    while (*pos < end && shift < 32) {
+        uint8_t b = p[(*pos)++];
+
+        *v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// A boot sample carries the uptime itself instead of the seconds since prev
+static size_t encodeSample(uint8_t *out, const LogState *prev, const LogState *now, bool heatOn,
+                           bool boot)
+{
+    int32_t dTemp = now->temperature - prev->temperature;
+    int32_t dSet = now->setPoint - prev->setPoint;
+    uint32_t dt = boot ? now->time : now->time - prev->time;
+    size_t n = 1;
+
+    out[0] = heatOn ? LOG_HEAT_ON : 0;
+    if (boot) {
+        out[0] |= LOG_BOOT | LOG_TIME_GAP;
+        n += putVarint(&out[n], dt);
+    } else if (dt != LOG_INTERVAL_S) {
+        out[0] |= LOG_TIME_GAP;
+        n += putVarint(&out[n], dt);
+    }
+    if (dTemp >= -7 && dTemp <= 7) {
+        out[0] |= (uint8_t)dTemp & LOG_TEMP_MASK;
+    } else {
+        out[0] |= LOG_TEMP_ESCAPE;
+        n += putVarint(&out[n], zigzag(dTemp));
+    }
+    if (dSet != 0) {
+        out[0] |= LOG_SET_CHANGED;
+        n += putVarint(&out[n], zigzag(dSet));
+    }
+    return n;
+}
+
+// Decodes the sample at *pos into state and boot; returns false if it is cut short
+static bool decodeSample(const uint8_t *p, uint16_t *pos, uint16_t end,
+                         LogState *state, uint16_t *boot, bool *heatOn)
+{
+    uint8_t head;
+    uint32_t v;
+
+    if (*pos >= end) {
+        return false;
+    }
+    head = p[(*pos)++];
+    *heatOn = (head & LOG_HEAT_ON) != 0;
+
+    v = LOG_INTERVAL_S;
+    if ((head & LOG_TIME_GAP) && !getVarint(p, pos, end, &v)) {
+        return false;
+    }
+    if (head & LOG_BOOT) {
+        state->time = v;
+        ++*boot;
+    } else {
+        state->time += v;
+    }
+
+    if ((head & LOG_TEMP_MASK) == LOG_TEMP_ESCAPE) {
+        if (!getVarint(p, pos, end, &v)) {
+            return false;
+        }
+        state->temperature = (int16_t)(state->temperature + unzigzag(v));
+    } else {
+        // Sign-extend the 4-bit change
+        state->temperature = (int16_t)(state->temperature + (int8_t)((head & LOG_TEMP_MASK) << 4) / 16);
+    }
+
+    if (head & LOG_SET_CHANGED) {
+        if (!getVarint(p, pos, end, &v)) {
+            return false;
+        }
+        state->setPoint = (int8_t)(state->setPoint + unzigzag(v));
+    }
+    return true;
+}
+
+/*
+ *  ======== Segments ========
+ */
+static void segmentName(uint32_t sequence, char *name, size_t size)
+{
+    snprintf(name, size, "thermostat/log%u", (unsigned)(sequence % LOG_SEGMENTS));
+}
+
+// Header of the RAM segment, CRC included
+static void sealSegment(void)
+{
+    uint16_t len = (uint16_t)(used - LOG_HEADER_SIZE);
+    uint16_t crc;
+
+    put16(&segment[0], LOG_MAGIC);
+    segment[2] = LOG_VERSION;
+    segment[3] = (uint8_t)base.setPoint;
+    put32(&segment[4], stats.sequence);
+    put16(&segment[8], segmentBoot);
+    put32(&segment[10], base.time);
+    put16(&segment[14], (uint16_t)base.temperature);
+    put16(&segment[16], len);
+
+    // One CRC over the header up to itself, then the payload
+    crc = tlmCrc16(segment, LOG_HEADER_SIZE - 2);
+    crc = tlmCrc16Update(crc, &segment[LOG_HEADER_SIZE], len);
+    put16(&segment[18], crc);
+}
+
+// Checks a segment image; returns its payload length or -1
+static int checkSegment(const uint8_t *p, size_t size)
+{
+    uint16_t len, crc;
+
+    if (size < LOG_HEADER_SIZE || get16(&p[0]) != LOG_MAGIC ||
+        p[2] < LOG_VERSION_XOR_CRC || p[2] > LOG_VERSION) {
+        return -1;
+    }
+    len = get16(&p[16]);
+    if (len > size - LOG_HEADER_SIZE) {
+        return -1;
+    }
+    crc = tlmCrc16(p, LOG_HEADER_SIZE - 2);
+    if (p[2] == LOG_VERSION_XOR_CRC) {
+        // Written before the CRC ran on through the payload
+        crc ^= tlmCrc16(&p[LOG_HEADER_SIZE], len);
+    } else {
+        crc = tlmCrc16Update(crc, &p[LOG_HEADER_SIZE], len);
+    }
+    return crc == get16(&p[18]) ? len : -1;
+}
+
+static void startSegment(const LogState *from)
+{
+    base = *from;
+    segmentBoot = stats.boot;
+    used = LOG_HEADER_SIZE;
+}
+
+// Picks up the segment image in segment[] where it left off: its last
+// sample into last and its last boot into stats.boot. Returns false if
+// it is cut short or has no room for another sample.
+static bool reopenSegment(void)
+{
+    uint16_t pos = LOG_HEADER_SIZE;
+    bool heatOn;
+
+    segmentBoot = stats.boot = get16(&segment[8]);
+    base.setPoint = (int8_t)segment[3];
+    base.time = get32(&segment[10]);
+    base.temperature = (int16_t)get16(&segment[14]);
+    last = base;
+    while (pos < used) {
+        if (!decodeSample(segment, &pos, used, &last, &stats.boot, &heatOn)) {
+            return false;
+        }
+    }
+    return used + LOG_SAMPLE_MAX <= LOG_SEGMENT_SIZE;
+}
+
+// Reads a segment file into buf; returns the bytes read or -1
+static int32_t readSegment(uint32_t sequence, uint8_t *buf)
+{
+    char name[24];
+    int32_t fd, n;
+
+    segmentName(sequence, name, sizeof(name));
+    fd = sl_FsOpen((const _u8 *)name, SL_FS_READ, NULL);
+    if (fd < 0) {
+        return -1;
+    }
+    n = sl_FsRead(fd, 0, buf, LOG_SEGMENT_SIZE);
+    sl_FsClose(fd, NULL, NULL, 0);
+    return n;
+}
+
+static bool writeSegment(void)
+{
+    char name[24];
+    int32_t fd, n;
+
+    sealSegment();
+    segmentName(stats.sequence, name, sizeof(name));
+    fd = sl_FsOpen((const _u8 *)name,
+                   SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_FAILSAFE |
+                   SL_FS_CREATE_MAX_SIZE(LOG_SEGMENT_SIZE), NULL);
+    if (fd < 0) {
+        return false;
+    }
+    n = sl_FsWrite(fd, 0, segment, used);
+    if (sl_FsClose(fd, NULL, NULL, 0) < 0 || n != used) {
+        return false;
+    }
+    return true;
+}
+
+/*
+ *  ======== histLogInit ========
+ */
+void histLogInit(void)
+{
+    uint32_t i, sequence;
+    bool found = false, reopened = false;
+    int32_t n;
+    int len;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&exporter, 0, sizeof(exporter));
+    haveSample = dirty = false;
+
+    // The newest valid segment on flash is the one this boot appends to
+    if (nwpAcquire()) {
+        for (i = 0; i < LOG_SEGMENTS; ++i) {
+            n = readSegment(i, exportBuf);
+            if (n < 0) {
+                continue;
+            }
+            len = checkSegment(exportBuf, (size_t)n);
+            if (len < 0) {
+                stats.badSegments++;
+                continue;
+            }
+            sequence = get32(&exportBuf[4]);
+            if (!found || (int32_t)(sequence - stats.sequence) > 0) {
+                stats.sequence = sequence;
+                used = (uint16_t)(LOG_HEADER_SIZE + len);
+                memcpy(segment, exportBuf, used);
+                found = true;
+            }
+        }
+        nwpRelease();
+    }
+    if (found) {
+        reopened = reopenSegment();
+        stats.boot++;
+        if (!reopened) {
+            stats.sequence++;
+        }
+    }
+    if (!reopened) {
+        memset(&last, 0, sizeof(last));
+        startSegment(&last);
+    }
+}
+
+void histLogFlush(void)
+{
+    if (!dirty) {
+        return;
+    }
+    if (nwpAcquire()) {
+        if (writeSegment()) {
+            stats.segmentWrites++;
+            dirty = false;
+        } else {
+            stats.writeErrors++;
+        }
+        nwpRelease();
+    } else {
+        stats.writeErrors++;
+    }
+    lastFlush = last.time;
+}
+
+void histLogSample(uint32_t uptime, tempq7_t temperature, int setPoint, bool heatOn)
+{
+    uint8_t sample[LOG_SAMPLE_MAX];
+    LogState now;
+    size_t n;
+    bool boot;
+
+    if (haveSample && uptime - last.time < LOG_INTERVAL_S) {
+        return;
+    }
+    now.time = uptime;
+    now.temperature = (int16_t)((temperature + (1 << (LOG_TEMP_SHIFT - 1))) >> LOG_TEMP_SHIFT);
+    now.setPoint = (int8_t)setPoint;
+    boot = !haveSample && used > LOG_HEADER_SIZE;
+    if (!haveSample) {
+        // First sample of the boot: in a new segment it is the base,
+        // encoded as no change; a reopened one has room for it
+        if (!boot) {
+            startSegment(&now);
+            last = now;
+        }
+        lastFlush = uptime;
+        haveSample = true;
+    }
+
+    n = encodeSample(sample, &last, &now, heatOn, boot);
+    if (used + n > LOG_SEGMENT_SIZE) {
+        // Full: write it out, the next segment starts from the last sample
+        histLogFlush();
+        stats.sequence++;
+        startSegment(&last);
+    }
+    memcpy(&segment[used], sample, n);
+    used = (uint16_t)(used + n);
+    last = now;
+    dirty = true;
+    stats.samples++;
+
+    if (uptime - lastFlush >= LOG_FLUSH_S) {
+        histLogFlush();
+    }
+}
+
+/*
+ *  ======== Export ========
+ */
+
+// Loads the next segment into exportBuf; false when there is nothing more
+static bool exportLoad(void)
+{
+    int32_t n;
+    int len;
+
+    while ((int32_t)(exporter.next - stats.sequence) <= 0) {
+        uint32_t sequence = exporter.next++;
+
+        if (sequence == stats.sequence) {
+            // The segment still in RAM
+            sealSegment();
+            memcpy(exportBuf, segment, used);
+            n = used;
+        } else {
+            n = readSegment(sequence, exportBuf);
+            if (n < 0) {
+                continue;   // never written, or lost
+            }
+        }
+        len = checkSegment(exportBuf, (size_t)n);
+        if (len < 0 || get32(&exportBuf[4]) != sequence) {
+            if (len < 0) {
+                stats.badSegments++;
+            }
+            continue;       // corrupt, or an older lap of the ring
+        }
+        exporter.boot = get16(&exportBuf[8]);
+        exporter.state.setPoint = (int8_t)exportBuf[3];
+        exporter.state.time = get32(&exportBuf[10]);
+        exporter.state.temperature = (int16_t)get16(&exportBuf[14]);
+        exporter.pos = LOG_HEADER_SIZE;
+        exporter.len = (uint16_t)(LOG_HEADER_SIZE + len);
+        return true;
+    }
+    return false;
+}
+
+void histLogExportStart(void)
+{
+    exporter.next = stats.sequence >= LOG_SEGMENTS - 1 ? stats.sequence - (LOG_SEGMENTS - 1) : 0;
+    exporter.pos = exporter.len = 0;
+    exporter.lines = 0;
+    exporter.active = nwpAcquire();
+    if (exporter.active) {
+        txQueuePrintf("# log: boot,uptime_s,temperature_c,set_point_c,heat_on\n\r");
+    } else {
+        txQueuePrintf("# log: flash unavailable\n\r");
+    }
+}
+
+bool histLogExportStep(void)
+{
+    bool heatOn;
+    int16_t t;
+
+    while (exporter.active && txQueuePending() + TXQUEUE_LINE_MAX <= TXQUEUE_SIZE) {
+        if (exporter.pos >= exporter.len && !exportLoad()) {
+            txQueuePrintf("# log: %lu samples\n\r", (unsigned long)exporter.lines);
+            exporter.active = false;
+            nwpRelease();
+            break;
+        }
+        if (!decodeSample(exportBuf, &exporter.pos, exporter.len, &exporter.state, &exporter.boot,
+                          &heatOn)) {
+            exporter.pos = exporter.len;    // cut short, skip the rest
+            continue;
+        }
+        t = exporter.state.temperature;
+        txQueuePrintf("L,%u,%lu,%s%d.%04d,%d,%d\n\r", exporter.boot,
+                      (unsigned long)exporter.state.time, t < 0 ? "-" : "",
+                      (t < 0 ? -t : t) >> 4, ((t < 0 ? -t : t) & 15) * 625,
+                      exporter.state.setPoint, heatOn);
+        exporter.lines++;
+    }
+    return exporter.active;
+}
+
+bool histLogExporting(void)
+{
+    return exporter.active;
+}
+
+void histLogGetStats(HistLogStats *out)
+{
+    *out = stats;
+}
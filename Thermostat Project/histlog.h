@@ -0,0 +1,95 @@
+/*
+ *  ======== histlog.h ========
+ *  Temperature history kept in the SimpleLink serial-flash file system.
+ *
+ *  The log is a ring of LOG_SEGMENTS files ("thermostat/log0" ...). Samples
+ *  are appended to a segment held in RAM, which is written to its file
+ *  when it fills and every LOG_FLUSH_S in between, so the flash sees one
+ *  write per segment-hour instead of one per sample. A boot reopens the
+ *  newest segment and appends to it; only a full one starts a new
+ *  segment, which takes the slot of the oldest, so resets do not wear
+ *  the ring through. Files are created fail-safe: a write cut short
+ *  by power loss leaves the previous copy, and the CRC in the segment
+ *  header rejects anything else.
+ *
+ *  Segment file, little-endian:
+ *
+ *      offset  size  field
+ *      0       2     magic LOG_MAGIC
+ *      2       1     format version, LOG_VERSION
+ *      3       1     set point before the first sample, whole degC
+ *      4       4     segment sequence number, counts up forever
+ *      8       2     boot number of the first sample
+ *      10      4     uptime before the first sample, seconds
+ *      14      2     temperature before the first sample, 1/16 degC
+ *      16      2     payload length
+ *      18      2     CRC-16 of bytes 0..17 then the payload, as one run;
+ *                    version 1 XORed the CRCs of the two, and is still read
+ *      20      ...   payload: samples
+ *
+ *  Each sample starts with one byte and is often nothing else:
+ *
+ *      bits 0-3  temperature change, -7..+7 in 1/16 degC; -8 means a
+ *                zigzag varint with the change follows
+ *      bit 4     heat on
+ *      bit 5     set point changed: a zigzag varint with the change follows
+ *      bit 6     not LOG_INTERVAL_S after the previous sample: a varint
+ *                with the seconds since it follows
+ *      bit 7     first sample of a boot appended to the segment: the boot
+ *                number goes up by one, and bit 6 is set with the time
+ *                varint holding the uptime instead of the seconds since
+ *
+ *  Trailing fields come in the order time, temperature, set point. Steady
+ *  temperatures cost one byte a minute, so a segment holds most of a day.
+ *
+ *  There is no real-time clock: time is uptime within a boot, and the boot
+ *  number tells boots apart.
+ */
+#ifndef HISTLOG_H_
+#define HISTLOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+
+#define LOG_SEGMENTS        6
+#define LOG_SEGMENT_SIZE    1024    // bytes per file, header included
+#define LOG_INTERVAL_S      60      // seconds between samples
+#define LOG_FLUSH_S         3600    // longest a sample waits in RAM
+
+#define LOG_MAGIC           0x4C54  // "TL"
+#define LOG_VERSION         2
+#define LOG_HEADER_SIZE     20
+#define LOG_TEMP_SHIFT      3       // Q7 to 1/16 degC
+
+typedef struct {
+    uint32_t samples;       // appended since boot
+    uint32_t segmentWrites; // file writes, the flash wear figure
+    uint32_t writeErrors;
+    uint32_t badSegments;   // failed the CRC or header check when read
+    uint16_t boot;
+    uint32_t sequence;      // of the segment in RAM
+} HistLogStats;
+
+/* Reopens the newest segment on flash, or starts one after it if it is full */
+extern void histLogInit(void);
+
+/* Call once a second or so; samples every LOG_INTERVAL_S of uptime */
+extern void histLogSample(uint32_t uptime, tempq7_t temperature, int setPoint, bool heatOn);
+
+/* Write the RAM segment now, e.g. before a planned power-down */
+extern void histLogFlush(void);
+
+/*
+ * Export: histLogExportStart() begins streaming the whole log as text,
+ * oldest sample first; each histLogExportStep() call queues as many lines
+ * as the UART queue has room for. Returns false once the export is done.
+ */
+extern void histLogExportStart(void);
+extern bool histLogExportStep(void);
+extern bool histLogExporting(void);
+
+extern void histLogGetStats(HistLogStats *out);
+
+#endif /* HISTLOG_H_ */
@@ -0,0 +1,156 @@
+/*
+ *  ======== bench_temp.c ========
+ *  Compares the old floating-point readTemp conversion with the Q7 path.
+ *
+ *  Every one of the 65536 register codes is converted by both; the run
+ *  reports how often the whole-degree results agree, where the old
+ *  sign-extension went wrong, and the host time per conversion. Code
+ *  size is printed by `make bench` from the symbol table.
+ *
+ *  The TMP006 object temperature is checked the same way against its
+ *  datasheet formula in double: sensor voltages for objects from 40 degC
+ *  below to 60 degC above dies from -20 to 60 degC, converted by both.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "tempq7.h"
+
+#define ROUNDS 200
+
+extern int16_t legacyConvert(uint8_t msb, uint8_t lsb);
+extern tempq7_t q7Convert(uint8_t msb, uint8_t lsb);
+extern double floatTmp006(int16_t voltage, int16_t die);
+extern tempq7_t q7Tmp006(int16_t voltage, int16_t die);
+
+#define TMP006_CASES 4096
+static int16_t tmp006Voltage[TMP006_CASES], tmp006Die[TMP006_CASES];
+static unsigned tmp006Cases;
+
+static volatile int32_t sink;
+
+static double nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double timeLegacy(void)
+{
+    double start = nowNs();
+    int32_t sum = 0;
+    unsigned round, code;
+
+    for (round = 0; round < ROUNDS; ++round) {
+        for (code = 0; code < 65536; ++code) {
+            sum += legacyConvert((uint8_t)(code >> 8), (uint8_t)code);
+        }
+    }
+    sink = sum;
+    return (nowNs() - start) / (ROUNDS * 65536.0);
+}
+
+static double timeQ7(void)
+{
+    double start = nowNs();
+    int32_t sum = 0;
+    unsigned round, code;
+
+    for (round = 0; round < ROUNDS; ++round) {
+        for (code = 0; code < 65536; ++code) {
+            sum += q7Convert((uint8_t)(code >> 8), (uint8_t)code);
+        }
+    }
+    sink = sum;
+    return (nowNs() - start) / (ROUNDS * 65536.0);
+}
+
+// Sensor voltage register the datasheet model gives for an object and die
+static int16_t tmp006Register(double objectC, double dieC)
+{
+    double dt = dieC - 25.0, tdie = dieC + 273.15, tobj = objectC + 273.15;
+    double s = 6.4e-14 * (1.0 + 1.75e-3 * dt - 1.678e-5 * dt * dt);
+    double vos = -2.94e-5 - 5.7e-7 * dt + 4.63e-9 * dt * dt;
+    double f = s * (pow(tobj, 4) - pow(tdie, 4));
+    double d = (-1.0 + sqrt(1.0 + 4.0 * 13.4 * f)) / (2.0 * 13.4);
+
+    return (int16_t)lround((vos + d) / 156.25e-9);
+}
+
+static void checkTmp006(void)
+{
+    double worst = 0.0, sumErr = 0.0, start;
+    int die, obj, worstDie = 0, worstVoltage = 0;
+    unsigned i, round, n = 0;
+    float fsum = 0;
+    int32_t sum = 0;
+
+    for (die = -20; die <= 60; die += 5) {
+        for (obj = die - 40; obj <= die + 60; obj += 1) {
+            int16_t dieReg = (int16_t)(die * 128);
+            int16_t voltage = tmp006Register(obj + 0.3, die);
+            double err = fabs(q7Tmp006(voltage, dieReg) / 128.0 - floatTmp006(voltage, dieReg));
+
+            if (tmp006Cases < TMP006_CASES) {
+                tmp006Voltage[tmp006Cases] = voltage;
+                tmp006Die[tmp006Cases++] = dieReg;
+            }
+            sumErr += err;
+            ++n;
+            if (err > worst) {
+                worst = err;
+                worstDie = die;
+                worstVoltage = voltage;
+            }
+        }
+    }
+    printf("tmp006 check     : %u cases, q7 against double: mean %.4f C, worst %.4f C"
+           " (die %d C, voltage %d)\n", n, sumErr / n, worst, worstDie, worstVoltage);
+
+    start = nowNs();
+    for (round = 0; round < ROUNDS; ++round) {
+        for (i = 0; i < tmp006Cases; ++i) {
+            fsum += (float)floatTmp006(tmp006Voltage[i], tmp006Die[i]);
+        }
+    }
+    printf("tmp006 ns/reading: double %.2f, ", (nowNs() - start) / (ROUNDS * tmp006Cases));
+    start = nowNs();
+    for (round = 0; round < ROUNDS; ++round) {
+        for (i = 0; i < tmp006Cases; ++i) {
+            sum += q7Tmp006(tmp006Voltage[i], tmp006Die[i]);
+        }
+    }
+    printf("q7 %.2f\n", (nowNs() - start) / (ROUNDS * tmp006Cases));
+    sink = sum + (int32_t)fsum;
+}
+
+int main(void)
+{
+    unsigned code, agree = 0, wrong = 0, shown = 0;
+
+    for (code = 0; code < 65536; ++code) {
+        uint8_t msb = (uint8_t)(code >> 8), lsb = (uint8_t)code;
+        tempq7_t exact = q7Convert(msb, lsb);
+        int16_t legacy = legacyConvert(msb, lsb);
+
+        if (legacy == tempWholeDegrees(exact)) {
+            ++agree;
+            continue;
+        }
+        ++wrong;
+        if (shown < 4) {
+            printf("  code 0x%04X = %+9.4f C: legacy %d, q7 %d (whole degrees)\n",
+                   code, exact / (double)TEMP_Q7_ONE, legacy, tempWholeDegrees(exact));
+            ++shown;
+        }
+    }
+    printf("exhaustive check : %u of 65536 codes agree in whole degrees, %u differ\n", agree, wrong);
+    printf("resolution       : legacy 1 C, q7 %g C\n", 1.0 / TEMP_Q7_ONE);
+    printf("host ns/reading  : legacy %.2f, q7 %.2f\n", timeLegacy(), timeQ7());
+    checkTmp006();
+    return 0;
+}
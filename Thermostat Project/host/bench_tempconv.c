@@ -0,0 +1,49 @@
+/*
+ *  ======== bench_tempconv.c ========
+ *  The conversions compared by bench_temp.c, in their own translation
+ *  unit so none is inlined into the timing loop and so the file can also
+ *  be compiled for the Cortex-M4 (make bench-m4).
+ */
+#include <math.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+#include "tmpsensor.h"
+
+/* readTemp before the fixed-point change, byte for byte */
+int16_t legacyConvert(uint8_t msb, uint8_t lsb)
+{
+    int16_t temperature;
+
+    temperature = (msb << 8) | (lsb);
+    temperature *= 0.0078125;
+
+    if (msb & 0x80) {
+        temperature |= 0xF000;
+    }
+    return temperature;
+}
+
+/* readTemp now: the register already is Q7 */
+tempq7_t q7Convert(uint8_t msb, uint8_t lsb)
+{
+    return tempFromTmp11x(msb, lsb);
+}
+
+/* TMP006 object temperature the usual way, in double with pow() */
+double floatTmp006(int16_t voltage, int16_t die)
+{
+    double tdie = die / 128.0 + 273.15, dt = tdie - 298.15;
+    double vobj = voltage * 156.25e-9;
+    double s = 6.4e-14 * (1.0 + 1.75e-3 * dt - 1.678e-5 * dt * dt);
+    double vos = -2.94e-5 - 5.7e-7 * dt + 4.63e-9 * dt * dt;
+    double f = (vobj - vos) + 13.4 * (vobj - vos) * (vobj - vos);
+
+    return pow(pow(tdie, 4) + f / s, 0.25) - 273.15;
+}
+
+/* ... and in integers, as tmpsensor.c does it */
+tempq7_t q7Tmp006(int16_t voltage, int16_t die)
+{
+    return tempFromTmp006(voltage, die);
+}
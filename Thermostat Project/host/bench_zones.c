@@ -0,0 +1,137 @@
+/*
+ *  ======== bench_zones.c ========
+ *  Control sweep cost as the zone count grows.
+ *
+ *  Times zonesControl() (zones.c, built here with ZONES_MAX 32) over 1 to
+ *  32 zones, against the same controller updates made the way the
+ *  single-zone code kept its state, one structure per zone. Readings
+ *  change every sweep and straddle the set points, and the clock moves on
+ *  500 ms a sweep, so each update does the work it does on the board.
+ *  For scale, the report also gives the I2C bus time the sweep's readings
+ *  take at 400 kHz.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "heatctl.h"
+#include "tempq7.h"
+#include "zones.h"
+
+#define SWEEPS      2000000UL   // per zone count
+#define PATTERNS    256         // distinct reading sets, a power of two
+#define SWEEP_MS    500         // HEAT_TASK period
+#define I2C_BITS_PER_READ ((1 + 1 + 1 + 1 + 2) * 9)     // START, address, pointer, restart, address, 2 bytes
+
+/* One zone as a structure, like the single-zone globals gathered up */
+typedef struct {
+    uint8_t         address;
+    uint8_t         resultReg;
+    uint_least8_t   output;
+    int8_t          setPoint;
+    tempq7_t        temperature;
+    bool            heatOn;
+    HeatCtl         control;
+} Zone;
+
+static tempq7_t readings[PATTERNS][ZONES_MAX];
+static volatile uint32_t sink;
+static volatile uint32_t allFresh = UINT32_MAX;    // not a constant the compiler can fold in
+
+static double nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+__attribute__((noinline))
+static void structControl(Zone *zones, uint8_t count, const tempq7_t reading[], uint32_t fresh,
+                          uint32_t nowMs)
+{
+    uint8_t z;
+
+    for (z = 0; z < count; ++z) {
+        if (fresh & ZONE_BIT(z)) {
+            zones[z].temperature = reading[z];
+        }
+        zones[z].heatOn = heatCtlUpdate(&zones[z].control, zones[z].temperature,
+                                        TEMP_Q7(zones[z].setPoint), nowMs);
+    }
+}
+
+static double timeArrays(uint8_t count)
+{
+    ZoneSet zones;
+    uint32_t heat = 0, fresh;
+    unsigned long sweep;
+    uint8_t z;
+    double start;
+
+    zonesInit(&zones);
+    for (z = 0; z < count; ++z) {
+        zonesAdd(&zones, 0x48 + z, 0, z, 20);
+    }
+    fresh = allFresh;
+    start = nowNs();
+    for (sweep = 0; sweep < SWEEPS; ++sweep) {
+        zonesControl(&zones, readings[sweep & (PATTERNS - 1)], fresh, (uint32_t)(sweep * SWEEP_MS));
+        heat += zones.heatMask;
+    }
+    sink = heat;
+    return (nowNs() - start) / SWEEPS;
+}
+
+static double timeStructs(uint8_t count)
+{
+    Zone zones[ZONES_MAX] = {{0}};
+    uint32_t heat = 0, fresh;
+    unsigned long sweep;
+    uint8_t z;
+    double start;
+
+    for (z = 0; z < count; ++z) {
+        zones[z].address = 0x48 + z;
+        zones[z].output = z;
+        zones[z].setPoint = 20;
+        heatCtlInit(&zones[z].control);
+    }
+    fresh = allFresh;
+    start = nowNs();
+    for (sweep = 0; sweep < SWEEPS; ++sweep) {
+        structControl(zones, count, readings[sweep & (PATTERNS - 1)], fresh,
+                      (uint32_t)(sweep * SWEEP_MS));
+        heat += zones[0].heatOn;
+    }
+    sink = heat;
+    return (nowNs() - start) / SWEEPS;
+}
+
+int main(void)
+{
+    unsigned p, z, count;
+
+    // Readings within half a degree either side of the 20 degC set point
+    srand(1);
+    for (p = 0; p < PATTERNS; ++p) {
+        for (z = 0; z < ZONES_MAX; ++z) {
+            readings[p][z] = (tempq7_t)(TEMP_Q7(20) - TEMP_Q7_ONE / 2 + rand() % TEMP_Q7_ONE);
+        }
+    }
+
+    printf("state bytes/zone : arrays %.2f, structs %u\n",
+           sizeof(tempq7_t) + sizeof(int8_t) + 2 * sizeof(uint8_t) + sizeof(uint_least8_t) +
+           sizeof(HeatCtl) + 2.0 / 8,
+           (unsigned)sizeof(Zone));
+    printf("zones  arrays ns/sweep  ns/zone  structs ns/sweep  ns/zone  i2c us/sweep\n");
+    for (count = 1; count <= ZONES_MAX; count *= 2) {
+        double arrays = timeArrays((uint8_t)count), structs = timeStructs((uint8_t)count);
+
+        printf("%5u  %16.2f  %7.2f  %17.2f  %7.2f  %12.0f\n", count, arrays, arrays / count,
+               structs, structs / count, count * I2C_BITS_PER_READ * 1e6 / 400000);
+    }
+    return 0;
+}
@@ -0,0 +1,419 @@
+/*
+ *  ======== fleet.c ========
+ *  Monte-Carlo fleet simulation: the control loop against simulated rooms,
+ *  swept over set points and control periods.
+ *
+ *      fleet [-n rooms] [-d days] [-j threads] [-t SET,...] [-p MS,...]
+ *            [-N celsius] [-S seed] [-f] [-c]
+ *
+ *  Every configuration, one set point and one control period, runs the
+ *  same fleet of rooms. A room is a first-order thermal model, a heat
+ *  capacity losing heat through one resistance to the outdoors, with its
+ *  size, insulation, heater and climate drawn at random: time constants of
+ *  2 to 10 h, a heater that holds 25 to 40 degC over the outdoor
+ *  temperature, outdoor means of -5 to 12 degC swinging 2 to 8 degC over
+ *  the day, occupancy gains morning and evening, a window opened about
+ *  once a day, and sensor noise up to -N. Rooms and their disturbances
+ *  depend on the seed and the room number only, so configurations are
+ *  compared on identical weather and the result does not depend on -j.
+ *
+ *  The controller is the firmware's: zonesControl() (zones.c) makes the
+ *  decision adjustHeat does, from the reading the sensor task last
+ *  finished, on the same millisecond clock. The two tasks are released the way TASK_SET does it, HEAT_TASK
+ *  at phase 0 and SENSOR_TASK one tick ahead with the same period,
+ *  alternately starting a conversion and reading it, so a fresh reading
+ *  arrives every second period at the most. As in the firmware,
+ *  samplerate.c decides which conversion cycles the room sits out; -f
+ *  reads every cycle instead. Like the scheduler's wakeup, a room only
+ *  steps from one release to the next; in between the model advances in
+ *  closed form with the heater and the disturbances held.
+ *
+ *  For each configuration the report gives the heater energy, the RMS
+ *  error against the set point, the time spent more than 1 degC below it
+ *  (the room cannot keep up), and heat switches per day with their 95th
+ *  percentile across the fleet, and the sensor readings per day. -c
+ *  prints CSV instead.
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "samplerate.h"
+#include "tempq7.h"
+#include "zones.h"
+
+#define TIMER_PERIOD    100         // ms per tick, as in gpiointerrupt.c
+#define CONFIGS_MAX     64
+#define LIST_MAX        16
+#define MINUTES_PER_DAY 1440
+#define GAUSS_TABLE     4096        // standard normal samples, a power of two
+#define JOB_CHUNK       8           // rooms a worker takes at a time
+#define UNMET_K         1.0         // below the set point by more than this is unmet
+
+typedef struct {
+    int8_t      setPoint;       // degC
+    uint32_t    periodMs;       // control period, HEAT_TASK and SENSOR_TASK
+} Config;
+
+typedef struct {
+    double      resistance;     // K/W to the outdoors
+    double      tau;            // s, resistance times heat capacity
+    double      power;          // W, the heater when on
+    double      outdoorMean;    // degC
+    double      outdoorSwing;   // degC, half the daily range
+    double      occupancyGain;  // W while occupied
+    double      windowLoss;     // W while a window is open
+    double      noise;          // degC RMS of a reading
+} Room;
+
+typedef struct {
+    float       kwhPerDay;
+    float       switchesPerDay;
+    float       readsPerDay;
+    double      squareError;    // K^2 s
+    double      unmetS;
+} Result;
+
+static Config configs[CONFIGS_MAX];
+static unsigned numConfigs;
+static uint32_t numRooms = 1000, days = 2;
+static double noiseMax = 0.05;
+static bool fixedRate = false;          // -f: read every conversion cycle
+static uint64_t seed = 1;
+static Result *results;                 // [config][room]
+static uint32_t nextJob;                // first room of the next chunk, over every config
+
+static float outdoorShape[MINUTES_PER_DAY];     // -1..1, coldest at 03:00
+static uint8_t occupied[MINUTES_PER_DAY];
+static float gauss[GAUSS_TABLE];
+
+static double nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* splitmix64: seeds the per-room streams from the seed and the room number */
+static uint64_t mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* xorshift64* */
+static uint64_t next(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static double uniform(uint64_t *state, double lo, double hi)
+{
+    return lo + (hi - lo) * (next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void tablesInit(void)
+{
+    uint64_t state = mix(0);
+    unsigned m, i;
+
+    for (m = 0; m < MINUTES_PER_DAY; ++m) {
+        outdoorShape[m] = (float)sin(2 * M_PI * ((double)m / MINUTES_PER_DAY - 0.375));
+        occupied[m] = (m >= 390 && m < 510) || (m >= 1020 && m < 1380);    // 06:30-08:30, 17:00-23:00
+    }
+    // Box-Muller once, so a reading costs a table lookup
+    for (i = 0; i < GAUSS_TABLE; i += 2) {
+        double r = sqrt(-2 * log(uniform(&state, 1e-12, 1))), a = uniform(&state, 0, 2 * M_PI);
+
+        gauss[i] = (float)(r * cos(a));
+        gauss[i + 1] = (float)(r * sin(a));
+    }
+}
+
+static void roomInit(Room *room, uint64_t *state)
+{
+    room->resistance = 1.0 / uniform(state, 50, 250);     // 50-250 W/K
+    room->tau = 3600 * uniform(state, 2, 10);
+    room->power = uniform(state, 25, 40) / room->resistance;
+    room->outdoorMean = uniform(state, -5, 12);
+    room->outdoorSwing = uniform(state, 2, 8);
+    room->occupancyGain = uniform(state, 100, 800);
+    room->windowLoss = uniform(state, 500, 2500);
+    room->noise = uniform(state, 0, noiseMax);
+}
+
+/* One room through one configuration */
+static void runRoom(const Config *config, uint32_t roomIndex, Result *result)
+{
+    uint64_t plant = mix(seed ^ mix(roomIndex)), sensor = mix(plant);
+    uint32_t periodTicks = config->periodMs / TIMER_PERIOD;
+    uint64_t ticks = (uint64_t)days * 86400 * (1000 / TIMER_PERIOD), tick;
+    uint64_t windowStart, windowEnd = 0;
+    double temperature, alphaWait, alphaAhead, energyJ = 0, seconds;
+    double waitS = (periodTicks - 1) * TIMER_PERIOD / 1000.0, aheadS = TIMER_PERIOD / 1000.0;
+    unsigned long switches = 0, reads = 0;
+    uint32_t lastHeat = 0, fresh = 0;
+    bool converting = true;             // the boot reading's conversion
+    tempq7_t reading[1];
+    SampleRate rate;
+    ZoneSet zones;
+    Room room;
+
+    roomInit(&room, &plant);
+    windowStart = (uint64_t)(uniform(&plant, 0, 1) * 864000);
+    alphaWait = exp(-waitS / room.tau);
+    alphaAhead = exp(-aheadS / room.tau);
+    temperature = config->setPoint;
+    memset(result, 0, sizeof(*result));
+
+    zonesInit(&zones);
+    zonesAdd(&zones, 0, 0, 0, config->setPoint);
+    sampleRateInit(&rate, 2 * config->periodMs);
+
+    // The room holds its heat input over each stretch between two releases
+#define ADVANCE(alpha, s) do { \
+        unsigned minute = (unsigned)((tick / 600) % MINUTES_PER_DAY); \
+        double outdoor = room.outdoorMean + room.outdoorSwing * outdoorShape[minute]; \
+        double input = (lastHeat ? room.power : 0) + (occupied[minute] ? room.occupancyGain : 0) - \
+                       (tick >= windowStart && tick < windowEnd ? room.windowLoss : 0); \
+        double steady = outdoor + room.resistance * input; \
+        double error = temperature - config->setPoint; \
+        result->squareError += error * error * (s); \
+        result->unmetS += error < -UNMET_K ? (s) : 0; \
+        energyJ += lastHeat ? room.power * (s) : 0; \
+        temperature = steady + (temperature - steady) * (alpha); \
+    } while (0)
+
+    for (tick = 0; tick < ticks; tick += periodTicks) {
+        // HEAT_TASK, phase 0: decide on the last reading
+        zonesControl(&zones, reading, fresh, (uint32_t)(tick * TIMER_PERIOD));
+        sampleRateUpdate(&rate, &zones, fresh, (uint32_t)(tick * TIMER_PERIOD));
+        fresh = 0;
+        switches += (zones.heatMask ^ lastHeat) & 1;
+        lastHeat = zones.heatMask;
+
+        if (tick >= windowEnd) {
+            // The next window: about once a day, open 5 to 30 minutes
+            if (windowEnd != 0) {
+                windowStart = windowEnd + (uint64_t)(-log(uniform(&plant, 1e-9, 1)) * 864000);
+            }
+            windowEnd = windowStart + (uint64_t)uniform(&plant, 3000, 18000);
+        }
+        if (periodTicks > 1) {
+            ADVANCE(alphaWait, waitS);
+        }
+
+        // SENSOR_TASK, one tick ahead: read the conversion, or start one if due
+        if (converting) {
+            double sample = temperature + room.noise * gauss[next(&sensor) & (GAUSS_TABLE - 1)];
+
+            reading[0] = (tempq7_t)lrint(sample * TEMP_Q7_ONE);
+            fresh = 1;
+            ++reads;
+            converting = false;
+        } else {
+            converting = fixedRate || sampleRateDue(&rate, 1, (uint32_t)((tick + periodTicks - 1) * TIMER_PERIOD));
+        }
+        ADVANCE(alphaAhead, aheadS);
+    }
+#undef ADVANCE
+
+    seconds = ticks * TIMER_PERIOD / 1000.0;
+    result->kwhPerDay = (float)(energyJ / 3.6e6 / days);
+    result->switchesPerDay = (float)(switches * 86400.0 / seconds);
+    result->readsPerDay = (float)(reads * 86400.0 / seconds);
+}
+
+static void *worker(void *arg)
+{
+    uint32_t total = numConfigs * numRooms, job, end;
+
+    (void)arg;
+    while ((job = __atomic_fetch_add(&nextJob, JOB_CHUNK, __ATOMIC_RELAXED)) < total) {
+        end = job + JOB_CHUNK < total ? job + JOB_CHUNK : total;
+        for (; job < end; ++job) {
+            runRoom(&configs[job / numRooms], job % numRooms, &results[job]);
+        }
+    }
+    return NULL;
+}
+
+static int compareFloats(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Comma-separated integers into list; returns the count, or 0 on a bad list */
+static unsigned parseList(const char *text, long list[], long min, long max, long step)
+{
+    unsigned n = 0;
+    char *end;
+
+    do {
+        if (n == LIST_MAX) {
+            return 0;
+        }
+        list[n] = strtol(text, &end, 10);
+        if (end == text || list[n] < min || list[n] > max || list[n] % step != 0) {
+            return 0;
+        }
+        ++n;
+        text = end + 1;
+    } while (*end == ',');
+    return *end == '\0' ? n : 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n rooms] [-d days] [-j threads] [-t SET,...] [-p MS,...] [-N celsius] [-S seed] [-f] [-c]\n"
+            "  -n rooms    rooms in the fleet (default 1000)\n"
+            "  -d days     simulated days per room and configuration (default 2)\n"
+            "  -j threads  worker threads (default: one per online CPU)\n"
+            "  -t SET,...  set points to sweep, degC within %d..%d (default 10,15,20,25,30,35,40)\n"
+            "  -p MS,...   control periods to sweep, multiples of %d ms up to 60000\n"
+            "              (default 100,500,1000,5000,30000)\n"
+            "  -N celsius  largest RMS sensor noise of a room (default 0.05)\n"
+            "  -S seed     fleet seed (default 1)\n"
+            "  -f          fixed sampling: read every conversion cycle\n"
+            "  -c          CSV output\n",
+            prog, ZONE_SET_POINT_MIN, ZONE_SET_POINT_MAX, TIMER_PERIOD);
+}
+
+int main(int argc, char *argv[])
+{
+    long setPoints[LIST_MAX] = {10, 15, 20, 25, 30, 35, 40};
+    long periods[LIST_MAX] = {100, 500, 1000, 5000, 30000};
+    unsigned numSetPoints = 7, numPeriods = 5, s, p, c, i;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool csv = false;
+    pthread_t *workers;
+    float *sorted;
+    double start, wallS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:j:t:p:N:S:fch")) != -1) {
+        switch (opt) {
+        case 'n':
+            numRooms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            days = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            threads = strtol(optarg, NULL, 0);
+            break;
+        case 't':
+            numSetPoints = parseList(optarg, setPoints, ZONE_SET_POINT_MIN, ZONE_SET_POINT_MAX, 1);
+            if (numSetPoints == 0) {
+                fprintf(stderr, "bad set point list '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'p':
+            numPeriods = parseList(optarg, periods, TIMER_PERIOD, 60000, TIMER_PERIOD);
+            if (numPeriods == 0) {
+                fprintf(stderr, "bad period list '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'N':
+            noiseMax = strtod(optarg, NULL);
+            break;
+        case 'S':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'f':
+            fixedRate = true;
+            break;
+        case 'c':
+            csv = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (numRooms == 0 || days == 0 || threads < 1 || numSetPoints * numPeriods > CONFIGS_MAX ||
+        (uint64_t)numSetPoints * numPeriods * numRooms > UINT32_MAX - JOB_CHUNK) {
+        usage(argv[0]);
+        return 2;
+    }
+    for (p = 0; p < numPeriods; ++p) {
+        for (s = 0; s < numSetPoints; ++s) {
+            configs[numConfigs].setPoint = (int8_t)setPoints[s];
+            configs[numConfigs].periodMs = (uint32_t)periods[p];
+            ++numConfigs;
+        }
+    }
+    results = calloc((size_t)numConfigs * numRooms, sizeof(*results));
+    sorted = malloc(numRooms * sizeof(*sorted));
+    workers = malloc(threads * sizeof(*workers));
+    if (results == NULL || sorted == NULL || workers == NULL) {
+        perror("fleet");
+        return 1;
+    }
+    tablesInit();
+
+    start = nowNs();
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&workers[i], NULL, worker, NULL) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    wallS = (nowNs() - start) / 1e9;
+
+    if (csv) {
+        printf("period_ms,set_point_c,kwh_per_day,rms_error_c,unmet_pct,switches_per_day,switches_p95,reads_per_day\n");
+    } else {
+        printf("fleet: %lu rooms x %lu days, %u configurations, %ld threads, seed %llu\n",
+               (unsigned long)numRooms, (unsigned long)days, numConfigs, threads,
+               (unsigned long long)seed);
+        printf("period ms  set degC  kWh/day  rms degC  unmet %%  switches/day  p95  reads/day\n");
+    }
+    for (c = 0; c < numConfigs; ++c) {
+        const Result *r = &results[(size_t)c * numRooms];
+        double kwh = 0, squareError = 0, unmetS = 0, switches = 0, reads = 0;
+        double roomS = (double)days * 86400 * numRooms;
+
+        for (i = 0; i < numRooms; ++i) {
+            kwh += r[i].kwhPerDay;
+            squareError += r[i].squareError;
+            unmetS += r[i].unmetS;
+            switches += r[i].switchesPerDay;
+            reads += r[i].readsPerDay;
+            sorted[i] = r[i].switchesPerDay;
+        }
+        qsort(sorted, numRooms, sizeof(*sorted), compareFloats);
+        printf(csv ? "%lu,%d,%.3f,%.3f,%.2f,%.1f,%.1f,%.0f\n" :
+                     "%9lu  %8d  %7.2f  %8.3f  %7.2f  %12.1f  %6.1f  %9.0f\n",
+               (unsigned long)configs[c].periodMs, configs[c].setPoint, kwh / numRooms,
+               sqrt(squareError / roomS), 100 * unmetS / roomS, switches / numRooms,
+               (double)sorted[(numRooms * 95 - 1) / 100], reads / numRooms);
+    }
+    fprintf(stderr, "simulated %.0f room-days in %.1f s, %.0f room-days/s\n",
+            (double)numConfigs * numRooms * days, wallS, numConfigs * numRooms * days / wallS);
+
+    free(workers);
+    free(sorted);
+    free(results);
+    return 0;
+}
@@ -0,0 +1,1951 @@
+/*
+ *  ======== hal_sim.c ========
+ *  Linux HAL stand-in for GPIO, I2C, Timer, UART2 and the SimpleLink file
+ *  system, WLAN and sockets.
+ *
+ *  The firmware runs on the process main thread exactly as it would after
+ *  NoRTOS_start(). A second thread plays the part of the hardware timer
+ *  interrupt: it sleeps on CLOCK_MONOTONIC, applies any scripted stimulus
+ *  for the tick and then calls the registered timer callback.
+ *
+ *  Built with THERMOSTAT_RTOS the firmware's task threads and the SimpleLink
+ *  spawn thread are plain host threads. SemaphoreP below stands in for the
+ *  kernel's; the host ignores the priorities, and with a core per thread
+ *  a higher-priority task is never held up by a lower one, as preemption
+ *  would have it.
+ *
+ *  Interrupt context is modelled by irqLock: callbacks only run while it is
+ *  held, HwiP_disable() takes it, and Power_idleFunc() waits on it for the
+ *  next callback the way WFI waits for the next interrupt.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/Timer.h>
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+#include <ti/drivers/net/wifi/simplelink.h>
+
+#include "ti_drivers_config.h"
+#include "hal_sim.h"
+
+/* Definitions */
+#define NUM_PINS        32
+#define MAX_EVENTS      256
+#define NUM_REGS        256
+#define BUTTON_BOUNCE_EDGES 3   // falling edges per simulated press
+#define UART_RX_RING    32      // UART2 driver receive ring, bytes
+
+/*
+ * ======== Simulated Sensors ========
+ */
+typedef struct {
+    HalSimSensor    part;
+    uint8_t         address;
+    uint8_t         pointer;                // register pointer set by the last write
+    uint16_t        regs[NUM_REGS];
+    int32_t         milliC;                 // temperature the part sees
+    uint64_t        cycleUs;                // converting continuously: start of the current cycle
+    uint64_t        doneUs;                 // one-shot: end of the conversion in progress, 0 = none
+    unsigned long   conversions;
+    uint64_t        activeUs;               // time spent converting
+} SimSensor;
+
+typedef struct {
+    unsigned long   tick;
+    unsigned int    order;          // keeps same-tick events in script order
+    HalSimEventType type;
+    int             zone;           // HAL_SIM_EVENT_TEMPERATURE: -1 = every zone
+    int32_t         value;
+    char           *text;
+} SimEvent;
+
+/*
+ * ======== Driver Objects ========
+ */
+struct Timer_Config_ {
+    Timer_Params    params;
+    bool            open;
+    bool            running;
+};
+
+struct I2C_Config_ {
+    I2C_Params      params;
+    bool            open;
+    pthread_t       thread;         // callback mode: runs the queued transfers
+    bool            threadStarted;  // ... kept across a close and reopen
+    I2C_Transaction *queueHead;     // callback mode queue, linked by nextPtr
+    I2C_Transaction *queueTail;
+    bool            cancel;
+    unsigned long   generation;     // opens, so a close drops the transfer in flight
+};
+
+struct UART2_Config_ {
+    UART2_Params    params;
+    bool            open;
+    pthread_t       txThread;       // callback mode: completes writes
+    const void     *txBuf;          // write in flight, NULL when idle
+    size_t          txSize;
+    uint8_t         rxRing[UART_RX_RING];
+    size_t          rxHead;         // bytes received
+    size_t          rxTail;         // bytes read
+    void           *rxBuf;          // callback mode read pending, NULL when none
+    size_t          rxSize;
+};
+
+static struct Timer_Config_ timerObject;
+static struct I2C_Config_ i2cObject;
+static struct UART2_Config_ uartObject;
+
+/*
+ * ======== Simulation State ========
+ */
+static HalSimConfig config;
+static SimSensor sensors[HAL_SIM_ZONES_MAX];   // one per zone
+static SimEvent events[MAX_EVENTS];
+static unsigned int numEvents;
+static unsigned int nextEvent;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timerCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t uartCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t uartRxCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t i2cCond;         // timed waits, on CLOCK_MONOTONIC
+static uint64_t i2cStallUs;             // added to the next transfer
+static unsigned int i2cFailCount;       // transfers left that fail
+static unsigned int i2cWedgeClocks;     // SCL clocks until SDA is released, 0 = bus free
+static uint64_t gpioBusyUs;             // added to the next GPIO write
+static uint64_t fsSlowUs;               // the next flash commit takes this, 0 = FS_WRITE_US
+static bool wifiUp = true;              // the access point answers
+static bool collectorReads = true;      // the collector takes what is sent
+static struct {                         // the simulated network processor
+    bool        running;
+    bool        autoConnect;    // SL_WLAN_POLICY_CONNECTION auto bit, kept across starts
+    bool        joined;         // connect and IP events delivered
+    uint64_t    startUs;
+} nwp;
+static pthread_t firmwareThread;
+static pthread_t timerThread;
+static bool timerThreadStarted;
+
+static struct timespec startTime;
+
+// Interrupts
+static pthread_mutex_t irqLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t irqCond = PTHREAD_COND_INITIALIZER;
+static pthread_t irqOwner;
+static bool irqMasked;
+static unsigned long irqCount;
+static bool powerPolicy;
+
+// GPIO
+static unsigned int pinValue[NUM_PINS];
+static GPIO_CallbackFxn pinCallback[NUM_PINS];
+static bool pinIntEnabled[NUM_PINS];
+static unsigned long pinReleaseTick[NUM_PINS];  // pressed button goes high again, 0 = not held
+#define BUS_SCL_PIN     10      // CONFIG_I2C_0 lines as GPIOs, pulled up on the board;
+#define BUS_SDA_PIN     11      // the firmware drives them to recover the bus
+static const uint_least8_t heatPins[HAL_SIM_ZONES_MAX] = {     // each zone's heat output
+    CONFIG_GPIO_LED_0, CONFIG_GPIO_HEAT_1, CONFIG_GPIO_HEAT_2, CONFIG_GPIO_HEAT_3
+};
+
+// Statistics
+static struct {
+    unsigned long   ticks;
+    uint64_t        latenessMinNs;
+    uint64_t        latenessMaxNs;
+    uint64_t        latenessSumNs;
+    unsigned long   heatOnTicks;
+    unsigned long   heatSwitches;
+    unsigned long   gpioWrites;
+    unsigned long   buttonPresses;
+    unsigned long   buttonEdges;    // falling edges, counting bounce
+    unsigned long   buttonEdgesMasked;
+    unsigned long   i2cTransfers;
+    unsigned long   i2cErrors;
+    unsigned long   i2cReads;       // result register reads
+    unsigned long   i2cWedges;      // times a sensor held SDA low
+    unsigned long   i2cUnwedges;    // ... and let go after enough SCL clocks
+    unsigned long   i2cRecoveryClocks; // SCL pulses driven as a GPIO
+    unsigned long   uartWrites;
+    unsigned long   uartBytes;
+    unsigned long   uartRxBytes;
+    unsigned long   uartRxOverruns; // bytes lost to a full receive ring
+    uint64_t        uartBlockedUs;
+    unsigned long   wakeups;
+    uint64_t        sleepNs;
+    unsigned long   nwpStarts;
+    uint64_t        nwpOnUs;        // simulated time the NWP ran
+    unsigned long   wifiJoins;
+    uint64_t        sockBytes;
+    unsigned long   fsCommits;      // files written and closed
+    uint64_t        fsReadBytes;
+    uint64_t        fsWriteBytes;
+} stats;
+
+/*
+ * ======== Helpers ========
+ */
+static uint64_t timespecToNs(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static void nsToTimespec(uint64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = (time_t)(ns / 1000000000ULL);
+    ts->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+static uint64_t monotonicNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespecToNs(&now);
+}
+
+// Sleep for a span of simulated time, scaled down by the speed factor
+static void simulatedDelayUs(uint64_t us)
+{
+    struct timespec ts;
+
+    nsToTimespec((uint64_t)((double)us * 1000.0 / config.speed), &ts);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+static uint32_t periodUs(const Timer_Params *params)
+{
+    switch (params->periodUnits) {
+    case Timer_PERIOD_HZ:
+        return params->period ? 1000000U / params->period : 0;
+    case Timer_PERIOD_COUNTS:
+        return params->period / 80;     // 80 MHz timer clock on the CC3220S
+    default:
+        return params->period;
+    }
+}
+
+/*
+ * ======== Interrupts ========
+ */
+
+// Driver callbacks run between interruptEnter() and interruptExit()
+static void interruptEnter(void)
+{
+    pthread_mutex_lock(&irqLock);
+}
+
+// Leaving the handler wakes a core idling in Power_idleFunc()
+static void interruptExit(void)
+{
+    ++irqCount;
+    pthread_cond_broadcast(&irqCond);
+    pthread_mutex_unlock(&irqLock);
+}
+
+/*
+ * ======== Sensor Register Files ========
+ *  A result is latched when a conversion ends: the temperature plus, with
+ *  -N, one noisy sample per average. A TMP006 faces a room at the same
+ *  temperature as its die, and its sensor voltage follows the datasheet's
+ *  thermopile model. A TMP11x converts once per cycle of
+ *  its configuration (continuous) or once per write that asks for it
+ *  (one-shot), and shuts down in between; a TMP006 converts back to back.
+ */
+#define TMP11X_CONFIG_WRITABLE 0x0FFC   // bits 15..12 are status
+
+static const uint8_t tmp11xAverages[] = { 1, 8, 32, 64 };
+
+static bool isTmp11x(const SimSensor *sensor)
+{
+    return sensor->part == HAL_SIM_SENSOR_TMP11X || sensor->part == HAL_SIM_SENSOR_TMP116;
+}
+
+static uint8_t resultReg(const SimSensor *sensor)
+{
+    return isTmp11x(sensor) ? 0x00 : 0x01;
+}
+
+static uint8_t configReg(const SimSensor *sensor)
+{
+    return isTmp11x(sensor) ? 0x01 : 0x02;
+}
+
+// Time one result takes; *cycleUs is the time between results converting continuously
+static uint64_t sensorConversionUs(const SimSensor *sensor, uint64_t *cycleUs)
+{
+    static const uint32_t tmp11xCycleMs[] = { 0, 125, 250, 500, 1000, 4000, 8000, 16000 };
+    uint16_t cfg = sensor->regs[configReg(sensor)];
+    uint64_t conversionUs;
+
+    if (isTmp11x(sensor)) {
+        conversionUs = tmp11xAverages[(cfg >> 5) & 3] * 15500ULL;
+        *cycleUs = tmp11xCycleMs[(cfg >> 7) & 7] * 1000ULL;
+        if (*cycleUs < conversionUs) {
+            *cycleUs = conversionUs;
+        }
+    } else {
+        conversionUs = (250000ULL << ((cfg >> 9) & 7));
+        *cycleUs = conversionUs;
+    }
+    return conversionUs;
+}
+
+static unsigned sensorAverages(const SimSensor *sensor)
+{
+    uint16_t cfg = sensor->regs[configReg(sensor)];
+
+    return isTmp11x(sensor) ? tmp11xAverages[(cfg >> 5) & 3] : 1u << ((cfg >> 9) & 7);
+}
+
+// One sample of the sensor noise, in milli-degrees (sum of uniforms, near enough Gaussian)
+static double noiseSample(void)
+{
+    static unsigned int seed = 1;
+    double sum = 0.0;
+    int i;
+
+    for (i = 0; i < 12; ++i) {
+        sum += (double)rand_r(&seed) / RAND_MAX;
+    }
+    return (sum - 6.0) * config.noiseMilliC;
+}
+
+static int32_t roundToInt(double x)
+{
+    return (int32_t)(x + (x < 0 ? -0.5 : 0.5));
+}
+
+// TMP006 sensor voltage register for an object seen from a die, in degC
+static int16_t tmp006Voltage(double objectC, double dieC)
+{
+    double dt = dieC - 25.0, tdie = dieC + 273.15, tobj = objectC + 273.15;
+    double s = 6.4e-14 * (1.0 + 1.75e-3 * dt - 1.678e-5 * dt * dt);
+    double vos = -2.94e-5 - 5.7e-7 * dt + 4.63e-9 * dt * dt;
+    double f = s * (tobj * tobj * tobj * tobj - tdie * tdie * tdie * tdie);
+
+    // f = d + 13.4 d^2 solved for d to first order, d being tiny
+    return (int16_t)roundToInt((vos + f - 13.4 * f * f) / 156.25e-9);
+}
+
+// Latch a result into the result register
+static void sensorLatch(SimSensor *sensor, unsigned averages)
+{
+    double milliC = sensor->milliC;
+    int32_t lsb;
+    unsigned i;
+
+    if (config.noiseMilliC > 0) {
+        double noise = 0.0;
+
+        for (i = 0; i < averages; ++i) {
+            noise += noiseSample();
+        }
+        milliC += noise / averages;
+    }
+    if (isTmp11x(sensor)) {
+        // Result register: 1 LSB = 1/128 C, two's complement
+        lsb = roundToInt(milliC * 128 / 1000);
+        sensor->regs[0x00] = (uint16_t)(int16_t)lsb;
+        sensor->regs[0x01] |= 0x2000;   // data ready
+    } else {
+        // Die temperature register: 14 bits left-justified, 1 LSB = 1/32 C;
+        // the noise is in what the thermopile sees
+        lsb = roundToInt(sensor->milliC * 32.0 / 1000);
+        sensor->regs[0x01] = (uint16_t)(int16_t)(lsb * 4);
+        sensor->regs[0x00] = (uint16_t)tmp006Voltage(milliC / 1000, lsb / 32.0);
+    }
+}
+
+static void sensorConvert(SimSensor *sensor, uint64_t conversionUs)
+{
+    sensorLatch(sensor, sensorAverages(sensor));
+    sensor->conversions++;
+    sensor->activeUs += conversionUs;
+}
+
+// Run the conversions that have ended by nowUs. Called with lock held.
+static void sensorUpdate(SimSensor *sensor, uint64_t nowUs)
+{
+    uint64_t conversionUs, cycleUs;
+    uint16_t *cfg;
+
+    if (sensor->part == HAL_SIM_SENSOR_NONE) {
+        return;
+    }
+    cfg = &sensor->regs[configReg(sensor)];
+    conversionUs = sensorConversionUs(sensor, &cycleUs);
+    if (isTmp11x(sensor) && (*cfg & 0x0C00) == 0x0C00) {
+        if (sensor->doneUs != 0 && nowUs >= sensor->doneUs) {
+            sensorConvert(sensor, conversionUs);
+            sensor->doneUs = 0;
+            *cfg = (uint16_t)((*cfg & ~0x0C00) | 0x0400);  // back to shutdown
+        }
+    } else if (isTmp11x(sensor) ? (*cfg & 0x0C00) != 0x0400 : (*cfg & 0x7000) != 0) {
+        while (sensor->cycleUs + conversionUs <= nowUs) {
+            sensorConvert(sensor, conversionUs);
+            sensor->cycleUs += cycleUs;
+        }
+    }
+}
+
+// A register write from the bus. Called with lock held.
+static void sensorWrite(SimSensor *sensor, uint8_t reg, uint16_t value, uint64_t nowUs)
+{
+    uint64_t cycleUs;
+
+    sensorUpdate(sensor, nowUs);
+    if (reg != configReg(sensor)) {
+        sensor->regs[reg] = value;
+        return;
+    }
+    if (isTmp11x(sensor)) {
+        value = (uint16_t)((sensor->regs[reg] & ~TMP11X_CONFIG_WRITABLE) | (value & TMP11X_CONFIG_WRITABLE));
+    }
+    sensor->regs[reg] = value;
+    sensor->cycleUs = nowUs;    // a new mode starts a new cycle
+    sensor->doneUs = 0;
+    if (isTmp11x(sensor) && (value & 0x0C00) == 0x0C00) {
+        sensor->doneUs = nowUs + sensorConversionUs(sensor, &cycleUs);
+    }
+}
+
+static void sensorSetTemperature(SimSensor *sensor, int32_t milliC)
+{
+    sensorUpdate(sensor, hal_sim_nowUs());     // conversions already done saw the old one
+    sensor->milliC = milliC;
+}
+
+// Zone n's sensor sits n addresses above the part's first one
+static void sensorReset(SimSensor *sensor, HalSimSensor part, int zone)
+{
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->part = part;
+
+    switch (part) {
+    case HAL_SIM_SENSOR_TMP11X:
+    case HAL_SIM_SENSOR_TMP116:
+        sensor->address = (uint8_t)(((part == HAL_SIM_SENSOR_TMP11X) ? 0x48 : 0x49) + zone);
+        sensor->regs[0x01] = 0x0220;        // configuration: continuous, 8 averages
+        sensor->regs[0x02] = 0x6000;        // high limit
+        sensor->regs[0x03] = 0x8000;        // low limit
+        sensor->regs[0x0F] = 0x1116;        // device ID
+        break;
+    case HAL_SIM_SENSOR_TMP006:
+        sensor->address = (uint8_t)(0x41 + zone);
+        sensor->regs[0x02] = 0x7400;        // configuration: continuous, 4 averages
+        sensor->regs[0xFE] = 0x5449;        // manufacturer ID
+        sensor->regs[0xFF] = 0x0067;        // device ID
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * ======== Timer Interrupt Thread ========
+ */
+static void applyEvents(unsigned long tick)
+{
+    unsigned int pin;
+
+    pthread_mutex_lock(&lock);
+    for (pin = 0; pin < NUM_PINS; ++pin) {
+        if (pinReleaseTick[pin] != 0 && pinReleaseTick[pin] <= tick) {
+            pinReleaseTick[pin] = 0;
+            pinValue[pin] = 1;  // pulled back up
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    while (nextEvent < numEvents && events[nextEvent].tick <= tick) {
+        const SimEvent *event = &events[nextEvent++];
+
+        switch (event->type) {
+        case HAL_SIM_EVENT_BUTTON_UP:
+            hal_sim_pressButton(CONFIG_GPIO_BUTTON_0, (unsigned long)event->value);
+            break;
+        case HAL_SIM_EVENT_BUTTON_DOWN:
+            hal_sim_pressButton(CONFIG_GPIO_BUTTON_1, (unsigned long)event->value);
+            break;
+        case HAL_SIM_EVENT_TEMPERATURE:
+            hal_sim_setTemperature(event->zone, event->value);
+            break;
+        case HAL_SIM_EVENT_I2C_STALL:
+            pthread_mutex_lock(&lock);
+            i2cStallUs = (uint64_t)event->value * 1000;
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_BUSY:
+            pthread_mutex_lock(&lock);
+            gpioBusyUs = (uint64_t)event->value * 1000;
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_UART_RX:
+            hal_sim_uartReceive(event->text, strlen(event->text));
+            break;
+        case HAL_SIM_EVENT_WIFI:
+            pthread_mutex_lock(&lock);
+            wifiUp = event->value != 0;
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_I2C_FAIL:
+            pthread_mutex_lock(&lock);
+            i2cFailCount = (unsigned int)event->value;
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_I2C_WEDGE:
+            pthread_mutex_lock(&lock);
+            if (i2cWedgeClocks == 0 && event->value > 0) {
+                stats.i2cWedges++;
+            }
+            i2cWedgeClocks = (unsigned int)(event->value > 0 ? event->value : 0);
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_FLASH:
+            pthread_mutex_lock(&lock);
+            fsSlowUs = (uint64_t)event->value * 1000;
+            pthread_mutex_unlock(&lock);
+            break;
+        case HAL_SIM_EVENT_COLLECTOR:
+            pthread_mutex_lock(&lock);
+            collectorReads = event->value != 0;
+            pthread_mutex_unlock(&lock);
+            break;
+        }
+    }
+}
+
+static void finish(void)
+{
+    fflush(stdout);
+    hal_sim_report(stderr);
+    exit(0);
+}
+
+static void *timerThreadFxn(void *arg)
+{
+    uint64_t deadline = 0;
+    bool wasRunning = false;
+
+    (void)arg;
+    for (;;) {
+        Timer_CallBackFxn callback;
+        uint64_t now, lateness;
+        int zone;
+
+        pthread_mutex_lock(&lock);
+        while (!timerObject.running) {
+            wasRunning = false;
+            pthread_cond_wait(&timerCond, &lock);
+        }
+        if (!wasRunning) {
+            deadline = monotonicNs();
+            wasRunning = true;
+        }
+        deadline += (uint64_t)((double)periodUs(&timerObject.params) * 1000.0 / config.speed);
+        pthread_mutex_unlock(&lock);
+
+        {
+            struct timespec ts;
+
+            nsToTimespec(deadline, &ts);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+
+        now = monotonicNs();
+        lateness = now > deadline ? now - deadline : 0;
+
+        pthread_mutex_lock(&lock);
+        callback = timerObject.running ? timerObject.params.timerCallback : NULL;
+        stats.ticks++;
+        if (stats.ticks == 1 || lateness < stats.latenessMinNs) {
+            stats.latenessMinNs = lateness;
+        }
+        if (lateness > stats.latenessMaxNs) {
+            stats.latenessMaxNs = lateness;
+        }
+        stats.latenessSumNs += lateness;
+        for (zone = 0; zone < config.zones; ++zone) {
+            if (pinValue[heatPins[zone]] == CONFIG_GPIO_LED_ON) {
+                stats.heatOnTicks++;
+            }
+        }
+        pthread_mutex_unlock(&lock);
+
+        applyEvents(stats.ticks);
+        if (callback) {
+            interruptEnter();
+            callback(&timerObject, 0);
+            interruptExit();
+        }
+        if (config.maxTicks && stats.ticks >= config.maxTicks) {
+            finish();
+        }
+    }
+    return NULL;
+}
+
+/*
+ * ======== Simulation Controls ========
+ */
+void hal_sim_init(const HalSimConfig *cfg)
+{
+    pthread_condattr_t attr;
+    int zone;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&i2cCond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    config = *cfg;
+    if (config.speed <= 0.0) {
+        config.speed = 1.0;
+    }
+    if (config.zones < 1) {
+        config.zones = 1;
+    }
+    for (zone = 0; zone < config.zones; ++zone) {
+        sensorReset(&sensors[zone], config.sensor, zone);
+        sensors[zone].milliC = config.tempMilliC;
+        if (config.sensor != HAL_SIM_SENSOR_NONE) {
+            sensorLatch(&sensors[zone], 1);    // the conversion made out of reset
+        }
+    }
+    firmwareThread = pthread_self();
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+}
+
+static int compareEvents(const void *a, const void *b)
+{
+    const SimEvent *x = a, *y = b;
+
+    if (x->tick != y->tick) {
+        return (x->tick > y->tick) - (x->tick < y->tick);
+    }
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+static int addEvent(unsigned long tick, HalSimEventType type, int zone, int32_t value, char *text)
+{
+    if (numEvents == MAX_EVENTS) {
+        return -1;
+    }
+    events[numEvents].tick = tick;
+    events[numEvents].order = numEvents;
+    events[numEvents].type = type;
+    events[numEvents].zone = zone;
+    events[numEvents].value = value;
+    events[numEvents].text = text;
+    ++numEvents;
+    qsort(events, numEvents, sizeof(events[0]), compareEvents);
+    return 0;
+}
+
+int hal_sim_addEvent(unsigned long tick, HalSimEventType type, int32_t value)
+{
+    return addEvent(tick, type, -1, value, NULL);
+}
+
+int hal_sim_addTemperatureEvent(unsigned long tick, int zone, int32_t milliC)
+{
+    return addEvent(tick, HAL_SIM_EVENT_TEMPERATURE, zone, milliC, NULL);
+}
+
+int hal_sim_addRxEvent(unsigned long tick, const char *text)
+{
+    char *copy = strdup(text);
+
+    if (copy == NULL || addEvent(tick, HAL_SIM_EVENT_UART_RX, -1, 0, copy) != 0) {
+        free(copy);
+        return -1;
+    }
+    return 0;
+}
+
+void hal_sim_setTemperature(int zone, int32_t milliC)
+{
+    int z;
+
+    pthread_mutex_lock(&lock);
+    for (z = 0; z < config.zones; ++z) {
+        if (zone < 0 || zone == z) {
+            sensorSetTemperature(&sensors[z], milliC);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void hal_sim_pressButton(uint_least8_t index, unsigned long holdTicks)
+{
+    GPIO_CallbackFxn callback;
+    int edge;
+
+    pthread_mutex_lock(&lock);
+    stats.buttonPresses++;
+    pinValue[index] = 0;    // buttons are active low
+    pinReleaseTick[index] = stats.ticks + (holdTicks ? holdTicks : 1);
+    pthread_mutex_unlock(&lock);
+
+    // Contacts bounce: each press makes a few falling edges, each of which
+    // interrupts only if the firmware still has the pin enabled
+    for (edge = 0; edge < BUTTON_BOUNCE_EDGES; ++edge) {
+        pthread_mutex_lock(&lock);
+        callback = pinIntEnabled[index] ? pinCallback[index] : NULL;
+        stats.buttonEdges++;
+        if (!callback) {
+            stats.buttonEdgesMasked++;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (callback) {
+            interruptEnter();
+            callback(index);
+            interruptExit();
+        }
+    }
+}
+
+uint64_t hal_sim_nowUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)((double)(timespecToNs(&now) - timespecToNs(&startTime)) * config.speed / 1000.0);
+}
+
+void hal_sim_report(FILE *out)
+{
+    static const char *partNames[] = { "none", "TMP11x", "TMP116", "TMP006" };
+    struct timespec now, cpu;
+    clockid_t cpuClock;
+    double wallS, cpuS, simS, nwpOnS;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wallS = (double)(timespecToNs(&now) - timespecToNs(&startTime)) / 1e9;
+    cpuS = 0.0;
+    if (pthread_getcpuclockid(firmwareThread, &cpuClock) == 0 && clock_gettime(cpuClock, &cpu) == 0) {
+        cpuS = (double)timespecToNs(&cpu) / 1e9;
+    }
+    simS = (double)stats.ticks * periodUs(&timerObject.params) / 1e6;
+
+    pthread_mutex_lock(&lock);
+    nwpOnS = (double)(stats.nwpOnUs + (nwp.running ? hal_sim_nowUs() - nwp.startUs : 0)) / 1e6;
+    fprintf(out, "--- thermostat_sim report ---\n");
+    fprintf(out, "sensor             : %s @0x%02x", partNames[config.sensor], sensors[0].address);
+    if (config.zones > 1) {
+        fprintf(out, "..0x%02x, %d zones", sensors[config.zones - 1].address, config.zones);
+    }
+    fputc('\n', out);
+    fprintf(out, "ticks              : %lu (%.3f s simulated, %.3f s wall, speed %gx)\n",
+            stats.ticks, simS, wallS, config.speed);
+    fprintf(out, "timer lateness us  : min %.1f avg %.1f max %.1f\n",
+            stats.latenessMinNs / 1e3,
+            stats.ticks ? (double)stats.latenessSumNs / stats.ticks / 1e3 : 0.0,
+            stats.latenessMaxNs / 1e3);
+    fprintf(out, "firmware cpu       : %.3f s (%.1f%% of wall)\n", cpuS, wallS > 0 ? 100.0 * cpuS / wallS : 0.0);
+    fprintf(out, "idle wakeups       : %lu (%.0f per simulated hour, asleep %.1f%% of wall)\n",
+            stats.wakeups, simS > 0 ? stats.wakeups * 3600.0 / simS : 0.0,
+            wallS > 0 ? 100.0 * stats.sleepNs / 1e9 / wallS : 0.0);
+    fprintf(out, "i2c transfers      : %lu (%lu failed), %lu result reads\n",
+            stats.i2cTransfers, stats.i2cErrors, stats.i2cReads);
+    if (stats.i2cWedges) {
+        fprintf(out, "i2c bus wedged     : %lu times, %lu freed by %lu SCL clocks, %s now\n",
+                stats.i2cWedges, stats.i2cUnwedges, stats.i2cRecoveryClocks,
+                i2cWedgeClocks ? "held" : "free");
+    }
+    if (config.sensor != HAL_SIM_SENSOR_NONE) {
+        unsigned long conversions = 0;
+        uint64_t activeUs = 0;
+        int zone;
+
+        for (zone = 0; zone < config.zones; ++zone) {
+            sensorUpdate(&sensors[zone], hal_sim_nowUs());
+            conversions += sensors[zone].conversions;
+            activeUs += sensors[zone].activeUs;
+        }
+        fprintf(out, "sensor conversions : %lu of %u samples, converting %.1f%% of the time\n",
+                conversions, sensorAverages(&sensors[0]),
+                simS > 0 ? 100.0 * activeUs / 1e6 / simS / config.zones : 0.0);
+    }
+    fprintf(out, "uart writes        : %lu (%lu bytes, %.1f ms blocked simulated)\n",
+            stats.uartWrites, stats.uartBytes, stats.uartBlockedUs / 1e3);
+    fprintf(out, "uart received      : %lu bytes (%lu lost to overruns)\n",
+            stats.uartRxBytes, stats.uartRxOverruns);
+    fprintf(out, "button presses     : %lu (%lu edges, %lu while the interrupt was off)\n",
+            stats.buttonPresses, stats.buttonEdges, stats.buttonEdgesMasked);
+    fprintf(out, "gpio writes        : %lu (heat switched %lu times, on %.1f%% of ticks)\n",
+            stats.gpioWrites, stats.heatSwitches,
+            stats.ticks ? 100.0 * stats.heatOnTicks / stats.ticks / config.zones : 0.0);
+    fprintf(out, "network processor  : %lu starts, on %.1f%% of the time, %lu wifi joins, %llu bytes sent\n",
+            stats.nwpStarts, simS > 0 ? 100.0 * nwpOnS / simS : 0.0,
+            stats.wifiJoins, (unsigned long long)stats.sockBytes);
+    if (config.flashDir) {
+        fprintf(out, "flash              : %s, %lu files written (%llu bytes), %llu bytes read\n",
+                config.flashDir, stats.fsCommits,
+                (unsigned long long)stats.fsWriteBytes, (unsigned long long)stats.fsReadBytes);
+    } else {
+        fprintf(out, "flash              : none (-f DIR keeps one)\n");
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * ======== Board ========
+ */
+void Board_init(void)
+{
+}
+
+/*
+ * ======== HwiP ========
+ */
+uintptr_t HwiP_disable(void)
+{
+    if (irqMasked && pthread_equal(irqOwner, pthread_self())) {
+        return 1;   // already masked by this thread
+    }
+    pthread_mutex_lock(&irqLock);
+    irqOwner = pthread_self();
+    irqMasked = true;
+    return 0;
+}
+
+void HwiP_restore(uintptr_t key)
+{
+    if (key == 0) {
+        irqMasked = false;
+        pthread_mutex_unlock(&irqLock);
+    }
+}
+
+/*
+ * ======== SemaphoreP ========
+ *  Binary semaphores: a post on a semaphore that is already available
+ *  leaves it available once.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;           // on CLOCK_MONOTONIC, for timed pends
+    unsigned int    count;
+} SimSemaphore;
+
+SemaphoreP_Handle SemaphoreP_createBinary(unsigned int count)
+{
+    SimSemaphore *sem = malloc(sizeof(*sem));
+    pthread_condattr_t attr;
+
+    if (sem == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    sem->count = count != 0;
+    return sem;
+}
+
+void SemaphoreP_delete(SemaphoreP_Handle handle)
+{
+    SimSemaphore *sem = handle;
+
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->mutex);
+    free(sem);
+}
+
+SemaphoreP_Status SemaphoreP_pend(SemaphoreP_Handle handle, uint32_t timeout)
+{
+    SimSemaphore *sem = handle;
+    struct timespec deadline;
+    SemaphoreP_Status status = SemaphoreP_OK;
+
+    nsToTimespec(monotonicNs() + (uint64_t)((double)timeout * 1e6 / config.speed), &deadline);
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count == 0 && status == SemaphoreP_OK) {
+        if (timeout == (uint32_t)SemaphoreP_WAIT_FOREVER) {
+            pthread_cond_wait(&sem->cond, &sem->mutex);
+        } else if (timeout == SemaphoreP_NO_WAIT ||
+                   pthread_cond_timedwait(&sem->cond, &sem->mutex, &deadline) == ETIMEDOUT) {
+            status = SemaphoreP_TIMEOUT;
+        }
+    }
+    if (sem->count != 0) {
+        sem->count = 0;
+        status = SemaphoreP_OK;
+    }
+    pthread_mutex_unlock(&sem->mutex);
+    return status;
+}
+
+void SemaphoreP_post(SemaphoreP_Handle handle)
+{
+    SimSemaphore *sem = handle;
+
+    pthread_mutex_lock(&sem->mutex);
+    sem->count = 1;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+/*
+ * ======== Power ========
+ */
+void Power_enablePolicy(void)
+{
+    powerPolicy = true;
+}
+
+void Power_disablePolicy(void)
+{
+    powerPolicy = false;
+}
+
+void Power_idleFunc(void)
+{
+    bool masked = irqMasked && pthread_equal(irqOwner, pthread_self());
+    unsigned long seen;
+    uint64_t start;
+
+    if (!powerPolicy) {
+        return;
+    }
+    if (!masked) {
+        pthread_mutex_lock(&irqLock);
+    }
+
+    // Like WFI: an interrupt raised while masked still ends the sleep
+    start = monotonicNs();
+    seen = irqCount;
+    while (irqCount == seen) {
+        pthread_cond_wait(&irqCond, &irqLock);
+    }
+    stats.wakeups++;
+    stats.sleepNs += monotonicNs() - start;
+
+    if (!masked) {
+        pthread_mutex_unlock(&irqLock);
+    }
+}
+
+/*
+ * ======== GPIO ========
+ */
+void GPIO_init(void)
+{
+}
+
+int_fast16_t GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig)
+{
+    if (index >= NUM_PINS) {
+        return GPIO_STATUS_ERROR;
+    }
+    pthread_mutex_lock(&lock);
+    if (pinConfig & GPIO_CFG_OUT_STD) {
+        pinValue[index] = (pinConfig & GPIO_CFG_OUT_HIGH) ? 1 : 0;
+    } else {
+        pinValue[index] = (pinConfig & GPIO_CFG_IN_PU) || index == BUS_SCL_PIN || index == BUS_SDA_PIN;
+    }
+    pthread_mutex_unlock(&lock);
+    return GPIO_STATUS_SUCCESS;
+}
+
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback)
+{
+    pthread_mutex_lock(&lock);
+    pinCallback[index] = callback;
+    pthread_mutex_unlock(&lock);
+}
+
+void GPIO_clearInt(uint_least8_t index)
+{
+    (void)index;    // edges are never latched while disabled here
+}
+
+void GPIO_enableInt(uint_least8_t index)
+{
+    pthread_mutex_lock(&lock);
+    pinIntEnabled[index] = true;
+    pthread_mutex_unlock(&lock);
+}
+
+void GPIO_disableInt(uint_least8_t index)
+{
+    pthread_mutex_lock(&lock);
+    pinIntEnabled[index] = false;
+    pthread_mutex_unlock(&lock);
+}
+
+uint_fast8_t GPIO_read(uint_least8_t index)
+{
+    uint_fast8_t value;
+
+    pthread_mutex_lock(&lock);
+    value = (uint_fast8_t)pinValue[index];
+    if (index == BUS_SDA_PIN && i2cWedgeClocks) {
+        value = 0;      // a sensor holds it low
+    }
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+void GPIO_write(uint_least8_t index, unsigned int value)
+{
+    uint64_t busyUs;
+    int zone;
+
+    pthread_mutex_lock(&lock);
+    busyUs = gpioBusyUs;
+    gpioBusyUs = 0;
+    value = value ? 1 : 0;
+    stats.gpioWrites++;
+    for (zone = 0; zone < config.zones; ++zone) {
+        if (index == heatPins[zone] && pinValue[index] != value) {
+            stats.heatSwitches++;
+        }
+    }
+    if (index == BUS_SCL_PIN && !i2cObject.open && value && !pinValue[index]) {
+        // A clock on the idle bus: the sensor holding SDA shifts out one more bit
+        stats.i2cRecoveryClocks++;
+        if (i2cWedgeClocks && --i2cWedgeClocks == 0) {
+            stats.i2cUnwedges++;
+        }
+    }
+    pinValue[index] = value;
+    pthread_mutex_unlock(&lock);
+
+    if (busyUs) {
+        simulatedDelayUs(busyUs);
+    }
+}
+
+void GPIO_toggle(uint_least8_t index)
+{
+    GPIO_write(index, !GPIO_read(index));
+}
+
+/*
+ * ======== I2C ========
+ */
+static void *i2cThreadFxn(void *arg);
+
+void I2C_init(void)
+{
+}
+
+void I2C_Params_init(I2C_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->transferMode = I2C_MODE_BLOCKING;
+    params->bitRate = I2C_100kHz;
+}
+
+I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params)
+{
+    if (index != CONFIG_I2C_0 || i2cObject.open) {
+        return NULL;
+    }
+    if (params->transferMode == I2C_MODE_CALLBACK &&
+        (params->transferCallbackFxn == NULL ||
+         (!i2cObject.threadStarted &&
+          pthread_create(&i2cObject.thread, NULL, i2cThreadFxn, &i2cObject) != 0))) {
+        return NULL;
+    }
+    pthread_mutex_lock(&lock);
+    i2cObject.threadStarted |= params->transferMode == I2C_MODE_CALLBACK;
+    i2cObject.params = *params;
+    i2cObject.open = true;
+    pthread_mutex_unlock(&lock);
+    return &i2cObject;
+}
+
+// Drops anything still queued, without callbacks, like a controller reset
+void I2C_close(I2C_Handle handle)
+{
+    pthread_mutex_lock(&lock);
+    handle->open = false;
+    handle->generation++;
+    handle->queueHead = NULL;
+    handle->queueTail = NULL;
+    handle->cancel = false;
+    pthread_cond_broadcast(&i2cCond);
+    pthread_mutex_unlock(&lock);
+}
+
+// Bus time of a transfer: START + address + data bytes at 9 clocks each,
+// plus a repeated START and address for the read phase
+static uint64_t i2cBusTimeUs(I2C_Handle handle, const I2C_Transaction *transaction, bool ack)
+{
+    static const uint32_t bitRates[] = { 100000, 400000, 1000000, 3400000 };
+    size_t bytes = 1 + (ack ? transaction->writeCount + transaction->readCount : 0);
+
+    if (ack && transaction->readCount) {
+        bytes += 1;
+    }
+    return bytes * 9 * 1000000ULL / bitRates[handle->params.bitRate & 3];
+}
+
+// The simulated sensor the transaction addresses, NULL if none answers. Called with lock held.
+static SimSensor *i2cTarget(I2C_Handle handle, const I2C_Transaction *transaction)
+{
+    int zone;
+
+    for (zone = 0; handle->open && zone < config.zones; ++zone) {
+        if (sensors[zone].part != HAL_SIM_SENSOR_NONE && transaction->targetAddress == sensors[zone].address) {
+            return &sensors[zone];
+        }
+    }
+    return NULL;
+}
+
+// Perform the register accesses of a transaction
+static bool i2cExecute(I2C_Handle handle, I2C_Transaction *transaction)
+{
+    const uint8_t *tx = transaction->writeBuf;
+    uint8_t *rx = transaction->readBuf;
+    SimSensor *sensor;
+    size_t i;
+    bool ok;
+
+    pthread_mutex_lock(&lock);
+    stats.i2cTransfers++;
+    sensor = i2cTarget(handle, transaction);
+    ok = sensor != NULL && i2cWedgeClocks == 0 && i2cFailCount == 0;
+    if (i2cFailCount) {
+        i2cFailCount--;
+    }
+    if (ok) {
+        sensorUpdate(sensor, hal_sim_nowUs());
+        if (transaction->writeCount >= 1) {
+            sensor->pointer = tx[0];
+        }
+        if (transaction->writeCount >= 3) {
+            sensorWrite(sensor, sensor->pointer, (uint16_t)((tx[1] << 8) | tx[2]), hal_sim_nowUs());
+        }
+        for (i = 0; i < transaction->readCount; ++i) {
+            uint16_t reg = sensor->regs[sensor->pointer];
+            rx[i] = (i & 1) ? (uint8_t)(reg & 0xFF) : (uint8_t)(reg >> 8);
+        }
+        if (transaction->readCount && sensor->pointer == resultReg(sensor)) {
+            stats.i2cReads++;
+        }
+        if (transaction->readCount && isTmp11x(sensor) && sensor->pointer == configReg(sensor)) {
+            sensor->regs[sensor->pointer] &= (uint16_t)~0x2000;    // reading clears data ready
+        }
+        transaction->status = I2C_STATUS_SUCCESS;
+    } else {
+        stats.i2cErrors++;
+        transaction->status = i2cWedgeClocks ? I2C_STATUS_BUS_BUSY : I2C_STATUS_ADDR_NACK;
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+// Callback mode: the I2C controller working through the queue
+static void *i2cThreadFxn(void *arg)
+{
+    I2C_Handle handle = arg;
+
+    for (;;) {
+        I2C_Transaction *transaction;
+        struct timespec deadline;
+        unsigned long generation;
+        uint64_t busUs;
+        bool ok;
+
+        pthread_mutex_lock(&lock);
+        while (handle->queueHead == NULL) {
+            pthread_cond_wait(&i2cCond, &lock);
+        }
+        transaction = handle->queueHead;
+        generation = handle->generation;
+        busUs = i2cBusTimeUs(handle, transaction, i2cTarget(handle, transaction) != NULL) + i2cStallUs;
+        i2cStallUs = 0;
+
+        // Hold the bus for the transfer time unless I2C_cancel() comes first
+        nsToTimespec(monotonicNs() + (uint64_t)((double)busUs * 1000.0 / config.speed), &deadline);
+        while (!handle->cancel && handle->generation == generation &&
+               pthread_cond_timedwait(&i2cCond, &lock, &deadline) != ETIMEDOUT) {}
+        pthread_mutex_unlock(&lock);
+        if (handle->generation != generation) {
+            continue;   // closed under it
+        }
+
+        if (handle->cancel) {
+            pthread_mutex_lock(&lock);
+            stats.i2cTransfers++;
+            stats.i2cErrors++;
+            pthread_mutex_unlock(&lock);
+            transaction->status = I2C_STATUS_CANCEL;
+            ok = false;
+        } else {
+            ok = i2cExecute(handle, transaction);
+        }
+
+        interruptEnter();
+        pthread_mutex_lock(&lock);
+        if (handle->generation != generation) {
+            pthread_mutex_unlock(&lock);
+            interruptExit();
+            continue;
+        }
+        handle->queueHead = transaction->nextPtr;
+        if (handle->queueHead == NULL) {
+            handle->queueTail = NULL;
+            handle->cancel = false;
+        }
+        pthread_mutex_unlock(&lock);
+        if (handle->params.transferCallbackFxn) {
+            handle->params.transferCallbackFxn(handle, transaction, ok);
+        }
+        interruptExit();
+    }
+    return NULL;
+}
+
+bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction)
+{
+    bool ok;
+
+    if (handle->params.transferMode == I2C_MODE_CALLBACK) {
+        pthread_mutex_lock(&lock);
+        transaction->nextPtr = NULL;
+        transaction->status = I2C_STATUS_QUEUED;
+        if (handle->queueTail) {
+            handle->queueTail->nextPtr = transaction;
+        } else {
+            handle->queueHead = transaction;
+        }
+        handle->queueTail = transaction;
+        pthread_cond_broadcast(&i2cCond);
+        pthread_mutex_unlock(&lock);
+        return true;
+    }
+
+    ok = i2cExecute(handle, transaction);
+    simulatedDelayUs(i2cBusTimeUs(handle, transaction, ok));
+    return ok;
+}
+
+void I2C_cancel(I2C_Handle handle)
+{
+    pthread_mutex_lock(&lock);
+    if (handle->queueHead) {
+        handle->cancel = true;
+        pthread_cond_broadcast(&i2cCond);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * ======== Timer ========
+ */
+void Timer_init(void)
+{
+}
+
+void Timer_Params_init(Timer_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->timerMode = Timer_ONESHOT_BLOCKING;
+    params->periodUnits = Timer_PERIOD_COUNTS;
+    params->period = (uint32_t)~0;
+}
+
+Timer_Handle Timer_open(uint_least8_t index, Timer_Params *params)
+{
+    if (index != CONFIG_TIMER_0 || timerObject.open || params->timerMode != Timer_CONTINUOUS_CALLBACK) {
+        return NULL;
+    }
+    timerObject.params = *params;
+    timerObject.open = true;
+    return &timerObject;
+}
+
+int32_t Timer_start(Timer_Handle handle)
+{
+    pthread_mutex_lock(&lock);
+    if (!handle->open || periodUs(&handle->params) == 0) {
+        pthread_mutex_unlock(&lock);
+        return Timer_STATUS_ERROR;
+    }
+    handle->running = true;
+    if (!timerThreadStarted) {
+        if (pthread_create(&timerThread, NULL, timerThreadFxn, NULL) != 0) {
+            handle->running = false;
+            pthread_mutex_unlock(&lock);
+            return Timer_STATUS_ERROR;
+        }
+        timerThreadStarted = true;
+    }
+    pthread_cond_signal(&timerCond);
+    pthread_mutex_unlock(&lock);
+    return Timer_STATUS_SUCCESS;
+}
+
+void Timer_stop(Timer_Handle handle)
+{
+    pthread_mutex_lock(&lock);
+    handle->running = false;
+    pthread_mutex_unlock(&lock);
+}
+
+void Timer_close(Timer_Handle handle)
+{
+    Timer_stop(handle);
+    handle->open = false;
+}
+
+uint32_t Timer_getCount(Timer_Handle handle)
+{
+    (void)handle;
+    return (uint32_t)(hal_sim_nowUs() * 80);
+}
+
+int32_t Timer_setPeriod(Timer_Handle handle, Timer_PeriodUnits periodUnits, uint32_t period)
+{
+    pthread_mutex_lock(&lock);
+    handle->params.periodUnits = periodUnits;
+    handle->params.period = period;
+    pthread_mutex_unlock(&lock);
+    return Timer_STATUS_SUCCESS;
+}
+
+/*
+ * ======== UART2 ========
+ */
+void UART2_Params_init(UART2_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->readMode = UART2_Mode_BLOCKING;
+    params->writeMode = UART2_Mode_BLOCKING;
+    params->baudRate = 115200;
+    params->dataLength = UART2_DataLen_8;
+    params->stopBits = UART2_StopBits_1;
+}
+
+// Put bytes on the "wire" and return how long that takes at the baud rate
+static uint64_t uartTransmit(UART2_Handle handle, const void *buffer, size_t size)
+{
+    if (!config.quiet) {
+        fwrite(buffer, 1, size, stdout);
+        fflush(stdout);
+    }
+
+    pthread_mutex_lock(&lock);
+    stats.uartWrites++;
+    stats.uartBytes += size;
+    pthread_mutex_unlock(&lock);
+
+    // 8N1 framing: 10 bit times per byte
+    return (uint64_t)size * 10 * 1000000ULL / handle->params.baudRate;
+}
+
+// Callback mode: the DMA transfer and the completion interrupt
+static void *uartTxThreadFxn(void *arg)
+{
+    UART2_Handle handle = arg;
+
+    for (;;) {
+        const void *buf;
+        size_t size;
+
+        pthread_mutex_lock(&lock);
+        while (handle->txBuf == NULL) {
+            pthread_cond_wait(&uartCond, &lock);
+        }
+        buf = handle->txBuf;
+        size = handle->txSize;
+        pthread_mutex_unlock(&lock);
+
+        simulatedDelayUs(uartTransmit(handle, buf, size));
+
+        interruptEnter();
+        pthread_mutex_lock(&lock);
+        handle->txBuf = NULL;
+        pthread_mutex_unlock(&lock);
+        if (handle->params.writeCallback) {
+            handle->params.writeCallback(handle, (void *)buf, size, handle->params.userArg,
+                                         UART2_STATUS_SUCCESS);
+        }
+        interruptExit();
+    }
+    return NULL;
+}
+
+/*
+ * Hand buffered receive bytes to a pending callback-mode read. The callback
+ * usually starts the next read, so keep going while both remain.
+ */
+static void uartDeliver(UART2_Handle handle)
+{
+    for (;;) {
+        void *buf;
+        size_t count = 0;
+
+        pthread_mutex_lock(&lock);
+        buf = handle->rxBuf;
+        if (buf == NULL || handle->rxHead == handle->rxTail) {
+            pthread_mutex_unlock(&lock);
+            return;
+        }
+        while (count < handle->rxSize && handle->rxHead != handle->rxTail) {
+            ((uint8_t *)buf)[count++] = handle->rxRing[handle->rxTail++ % UART_RX_RING];
+        }
+        handle->rxBuf = NULL;
+        pthread_mutex_unlock(&lock);
+
+        interruptEnter();
+        handle->params.readCallback(handle, buf, count, handle->params.userArg,
+                                    UART2_STATUS_SUCCESS);
+        interruptExit();
+    }
+}
+
+void hal_sim_uartReceive(const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    size_t i;
+
+    if (!uartObject.open) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    for (i = 0; i < len; ++i) {
+        if (uartObject.rxHead - uartObject.rxTail == UART_RX_RING) {
+            stats.uartRxOverruns++;
+            continue;
+        }
+        uartObject.rxRing[uartObject.rxHead++ % UART_RX_RING] = bytes[i];
+        stats.uartRxBytes++;
+    }
+    pthread_cond_broadcast(&uartRxCond);
+    pthread_mutex_unlock(&lock);
+
+    if (uartObject.params.readMode == UART2_Mode_CALLBACK) {
+        uartDeliver(&uartObject);
+    }
+}
+
+// -i: stdin is the terminal on the other end of the UART
+static void *uartStdinThreadFxn(void *arg)
+{
+    uint8_t buf[64];
+    ssize_t n;
+
+    (void)arg;
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+        hal_sim_uartReceive(buf, (size_t)n);
+    }
+    return NULL;
+}
+
+UART2_Handle UART2_open(uint_least8_t index, UART2_Params *params)
+{
+    pthread_t stdinThread;
+
+    if (index != CONFIG_UART2_0 || uartObject.open || params->baudRate == 0) {
+        return NULL;
+    }
+    if ((params->writeMode == UART2_Mode_CALLBACK && params->writeCallback == NULL) ||
+        (params->readMode == UART2_Mode_CALLBACK && params->readCallback == NULL)) {
+        return NULL;
+    }
+    uartObject.params = *params;
+    uartObject.txBuf = NULL;
+    uartObject.rxBuf = NULL;
+    uartObject.rxHead = uartObject.rxTail = 0;
+    if (params->writeMode == UART2_Mode_CALLBACK &&
+        pthread_create(&uartObject.txThread, NULL, uartTxThreadFxn, &uartObject) != 0) {
+        return NULL;
+    }
+    uartObject.open = true;
+    if (config.interactive &&
+        pthread_create(&stdinThread, NULL, uartStdinThreadFxn, NULL) == 0) {
+        pthread_detach(stdinThread);
+    }
+    return &uartObject;
+}
+
+void UART2_close(UART2_Handle handle)
+{
+    handle->open = false;
+}
+
+int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead)
+{
+    size_t count = 0;
+
+    pthread_mutex_lock(&lock);
+    if (handle->params.readMode == UART2_Mode_CALLBACK) {
+        if (handle->rxBuf != NULL) {
+            pthread_mutex_unlock(&lock);
+            return UART2_STATUS_EINUSE;
+        }
+        // Completes when bytes arrive; ones already buffered go out with them
+        handle->rxBuf = buffer;
+        handle->rxSize = size;
+        pthread_mutex_unlock(&lock);
+        return UART2_STATUS_SUCCESS;
+    }
+
+    // Blocking: wait for the first byte, then take what is there
+    while (handle->rxHead == handle->rxTail) {
+        pthread_cond_wait(&uartRxCond, &lock);
+    }
+    while (count < size && handle->rxHead != handle->rxTail) {
+        ((uint8_t *)buffer)[count++] = handle->rxRing[handle->rxTail++ % UART_RX_RING];
+    }
+    pthread_mutex_unlock(&lock);
+    if (bytesRead) {
+        *bytesRead = count;
+    }
+    return UART2_STATUS_SUCCESS;
+}
+
+int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten)
+{
+    uint64_t wireUs;
+
+    if (handle->params.writeMode == UART2_Mode_CALLBACK) {
+        pthread_mutex_lock(&lock);
+        if (handle->txBuf != NULL) {
+            pthread_mutex_unlock(&lock);
+            return UART2_STATUS_EINUSE;
+        }
+        handle->txBuf = buffer;
+        handle->txSize = size;
+        pthread_cond_signal(&uartCond);
+        pthread_mutex_unlock(&lock);
+        return UART2_STATUS_SUCCESS;
+    }
+
+    wireUs = uartTransmit(handle, buffer, size);
+
+    pthread_mutex_lock(&lock);
+    stats.uartBlockedUs += wireUs;
+    pthread_mutex_unlock(&lock);
+
+    simulatedDelayUs(wireUs);
+    if (bytesWritten) {
+        *bytesWritten = size;
+    }
+    return UART2_STATUS_SUCCESS;
+}
+
+/*
+ * ======== SimpleLink Device, File System, WLAN and Sockets ========
+ */
+#define NWP_START_US    35000   // network processor boot in sl_Start()
+#define NWP_STOP_US     2000
+#define FS_WRITE_US     20000   // fail-safe commit: erase and program a block
+#define FS_FILES        4       // open at once
+#define WIFI_JOIN_US    1500000 // scan, associate and DHCP after sl_Start()
+#define SOCKETS         4
+
+static int sockets[SOCKETS] = {-1, -1, -1, -1};   // host descriptors
+
+static struct {
+    FILE       *fp;
+    bool        writing;
+    uint32_t    maxSize;
+    char        path[PATH_MAX];
+    char        tmpPath[PATH_MAX];
+} fsFiles[FS_FILES];
+
+// "thermostat/log0" is DIR/thermostat_log0: one flat directory
+static bool fsPath(const _u8 *name, char *path, size_t size)
+{
+    int n;
+    char *p;
+
+    if (config.flashDir == NULL) {
+        return false;
+    }
+    n = snprintf(path, size, "%s/%s", config.flashDir, (const char *)name);
+    if (n < 0 || (size_t)n >= size) {
+        return false;
+    }
+    for (p = path + strlen(config.flashDir) + 1; *p; ++p) {
+        if (*p == '/') {
+            *p = '_';
+        }
+    }
+    return true;
+}
+
+static void sockCloseAll(void);
+
+_i16 sl_Start(const void *pIfHdl, _i8 *pDevName, const P_INIT_CALLBACK pInitCallBack)
+{
+    (void)pIfHdl;
+    (void)pDevName;
+    (void)pInitCallBack;
+    if (nwp.running) {
+        return SL_ERROR_DEVICE_NOT_STARTED;     // already started: an application bug
+    }
+    simulatedDelayUs(NWP_START_US);
+    pthread_mutex_lock(&lock);
+    stats.nwpStarts++;
+    nwp.running = true;
+    nwp.joined = false;
+    nwp.startUs = hal_sim_nowUs();
+    pthread_mutex_unlock(&lock);
+    return 0;   // ROLE_STA
+}
+
+_i16 sl_Stop(const _u16 timeout)
+{
+    (void)timeout;
+    if (!nwp.running) {
+        return 0;
+    }
+    sockCloseAll();
+    simulatedDelayUs(NWP_STOP_US);
+    pthread_mutex_lock(&lock);
+    nwp.running = false;
+    nwp.joined = false;
+    stats.nwpOnUs += hal_sim_nowUs() - nwp.startUs;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+_i32 sl_FsOpen(const _u8 *pFileName, const _u32 AccessModeAndMaxSize, _u32 *pToken)
+{
+    bool writing = (AccessModeAndMaxSize >> SL_FS_OPEN_MODE_BIT) != 0;
+    _i32 fd;
+
+    (void)pToken;
+    for (fd = 0; fd < FS_FILES && fsFiles[fd].fp != NULL; ++fd) {}
+    if (fd == FS_FILES) {
+        return SL_ERROR_FS_NO_AVAILABLE_BLOCKS;
+    }
+    if (!fsPath(pFileName, fsFiles[fd].path, sizeof(fsFiles[fd].path))) {
+        return SL_ERROR_FS_FILE_NOT_EXISTS;
+    }
+    if (writing) {
+        size_t len = strlen(fsFiles[fd].path);
+
+        if (len + sizeof(".tmp") > sizeof(fsFiles[fd].tmpPath)) {
+            return SL_ERROR_FS_FILE_NOT_EXISTS;
+        }
+        memcpy(fsFiles[fd].tmpPath, fsFiles[fd].path, len);
+        memcpy(fsFiles[fd].tmpPath + len, ".tmp", sizeof(".tmp"));
+        fsFiles[fd].fp = fopen(fsFiles[fd].tmpPath, "wb");
+        fsFiles[fd].maxSize = (AccessModeAndMaxSize & SL_FS_OPEN_MAXSIZE_BIT_MASK) * 256;
+    } else {
+        fsFiles[fd].fp = fopen(fsFiles[fd].path, "rb");
+    }
+    if (fsFiles[fd].fp == NULL) {
+        return writing ? SL_ERROR_FS_NO_AVAILABLE_BLOCKS : SL_ERROR_FS_FILE_NOT_EXISTS;
+    }
+    fsFiles[fd].writing = writing;
+    return fd;
+}
+
+_i16 sl_FsClose(const _i32 FileHdl, const _u8 *pCeritificateFileName,
+                const _u8 *pSignature, const _u32 SignatureLen)
+{
+    uint64_t commitUs;
+    int failed;
+
+    (void)pCeritificateFileName;
+    if (FileHdl < 0 || FileHdl >= FS_FILES || fsFiles[FileHdl].fp == NULL) {
+        return SL_ERROR_FS_INVALID_HANDLE;
+    }
+    failed = fclose(fsFiles[FileHdl].fp) != 0;
+    fsFiles[FileHdl].fp = NULL;
+    if (!fsFiles[FileHdl].writing) {
+        return 0;
+    }
+
+    // Signature "A" aborts the write and keeps the old copy
+    if (failed || (pSignature && SignatureLen == 1 && pSignature[0] == 'A') ||
+        rename(fsFiles[FileHdl].tmpPath, fsFiles[FileHdl].path) != 0) {
+        remove(fsFiles[FileHdl].tmpPath);
+        return failed ? SL_ERROR_FS_NO_AVAILABLE_BLOCKS : 0;
+    }
+    pthread_mutex_lock(&lock);
+    stats.fsCommits++;
+    commitUs = fsSlowUs != 0 ? fsSlowUs : FS_WRITE_US;
+    fsSlowUs = 0;
+    pthread_mutex_unlock(&lock);
+    simulatedDelayUs(commitUs);
+    return 0;
+}
+
+_i32 sl_FsRead(const _i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len)
+{
+    size_t n;
+
+    if (FileHdl < 0 || FileHdl >= FS_FILES || fsFiles[FileHdl].fp == NULL || fsFiles[FileHdl].writing) {
+        return SL_ERROR_FS_INVALID_HANDLE;
+    }
+    if (fseek(fsFiles[FileHdl].fp, (long)Offset, SEEK_SET) != 0) {
+        return SL_ERROR_FS_INVALID_HANDLE;
+    }
+    n = fread(pData, 1, Len, fsFiles[FileHdl].fp);
+    pthread_mutex_lock(&lock);
+    stats.fsReadBytes += n;
+    pthread_mutex_unlock(&lock);
+    return (_i32)n;
+}
+
+_i32 sl_FsWrite(const _i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len)
+{
+    size_t n;
+
+    if (FileHdl < 0 || FileHdl >= FS_FILES || fsFiles[FileHdl].fp == NULL || !fsFiles[FileHdl].writing) {
+        return SL_ERROR_FS_INVALID_HANDLE;
+    }
+    if (Offset + Len > fsFiles[FileHdl].maxSize) {
+        return SL_ERROR_FS_FILE_MAX_SIZE_EXCEEDED;
+    }
+    if (fseek(fsFiles[FileHdl].fp, (long)Offset, SEEK_SET) != 0) {
+        return SL_ERROR_FS_INVALID_HANDLE;
+    }
+    n = fwrite(pData, 1, Len, fsFiles[FileHdl].fp);
+    pthread_mutex_lock(&lock);
+    stats.fsWriteBytes += n;
+    pthread_mutex_unlock(&lock);
+    return (_i32)n;
+}
+
+_i16 sl_FsDel(const _u8 *pFileName, const _u32 Token)
+{
+    char path[PATH_MAX];
+
+    (void)Token;
+    if (!fsPath(pFileName, path, sizeof(path)) || remove(path) != 0) {
+        return SL_ERROR_FS_FILE_NOT_EXISTS;
+    }
+    return 0;
+}
+
+// Join or leave as the access point comes and goes, and tell the firmware
+static void wlanEvents(void)
+{
+    SlWlanEvent_t wlan;
+    SlNetAppEvent_t netApp;
+    bool join, leave;
+
+    pthread_mutex_lock(&lock);
+    join = nwp.running && nwp.autoConnect && wifiUp && !nwp.joined &&
+           hal_sim_nowUs() - nwp.startUs >= WIFI_JOIN_US;
+    leave = nwp.joined && !wifiUp;
+    if (join) {
+        nwp.joined = true;
+        stats.wifiJoins++;
+    } else if (leave) {
+        nwp.joined = false;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (join) {
+        wlan.Id = SL_WLAN_EVENT_CONNECT;
+        SimpleLinkWlanEventHandler(&wlan);
+        netApp.Id = SL_NETAPP_EVENT_IPV4_ACQUIRED;
+        SimpleLinkNetAppEventHandler(&netApp);
+    } else if (leave) {
+        sockCloseAll();
+        wlan.Id = SL_WLAN_EVENT_DISCONNECT;
+        SimpleLinkWlanEventHandler(&wlan);
+    }
+}
+
+#if defined(THERMOSTAT_RTOS)
+#define SPAWN_POLL_US   10000   // the spawn thread looks for events this often
+
+// The spawn thread: never returns
+void *sl_Task(void *pEntry)
+{
+    (void)pEntry;
+    for (;;) {
+        wlanEvents();
+        simulatedDelayUs(SPAWN_POLL_US);
+    }
+    return NULL;
+}
+#else
+void *sl_Task(void *pEntry)
+{
+    (void)pEntry;
+    wlanEvents();
+    return NULL;
+}
+#endif
+
+_i16 sl_WlanPolicySet(const _u8 Type, const _u8 Policy, _u8 *pVal, const _u8 ValLen)
+{
+    (void)pVal;
+    (void)ValLen;
+    if (Type == SL_WLAN_POLICY_CONNECTION) {
+        nwp.autoConnect = (Policy & SL_WLAN_CONNECTION_POLICY(1, 0, 0, 0)) != 0;
+    }
+    return 0;
+}
+
+static void sockCloseAll(void)
+{
+    int i;
+
+    for (i = 0; i < SOCKETS; ++i) {
+        if (sockets[i] >= 0) {
+            close(sockets[i]);
+            sockets[i] = -1;
+        }
+    }
+}
+
+static int sockFd(_i16 sd)
+{
+    return (sd >= 0 && sd < SOCKETS) ? sockets[sd] : -1;
+}
+
+_i16 sl_Socket(_i16 Domain, _i16 Type, _i16 Protocol)
+{
+    _i16 sd;
+
+    if (!nwp.running) {
+        return SL_ERROR_DEVICE_NOT_STARTED;
+    }
+    if (Domain != SL_AF_INET || Type != SL_SOCK_STREAM || Protocol != SL_IPPROTO_TCP) {
+        return SL_ERROR_BSD_ENSOCK;
+    }
+    for (sd = 0; sd < SOCKETS && sockets[sd] >= 0; ++sd) {}
+    if (sd == SOCKETS || (sockets[sd] = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return SL_ERROR_BSD_ENSOCK;
+    }
+    return sd;
+}
+
+_i16 sl_SetSockOpt(_i16 sd, _i16 level, _i16 optname, const void *optval, SlSocklen_t optlen)
+{
+    int fd = sockFd(sd), flags;
+
+    if (fd < 0) {
+        return SL_ERROR_BSD_EBADF;
+    }
+    if (level == SL_SOL_SOCKET && optname == SL_SO_NONBLOCKING && optlen == sizeof(SlSockNonblocking_t)) {
+        flags = fcntl(fd, F_GETFL);
+        if (((const SlSockNonblocking_t *)optval)->NonBlockingEnabled) {
+            flags |= O_NONBLOCK;
+        } else {
+            flags &= ~O_NONBLOCK;
+        }
+        fcntl(fd, F_SETFL, flags);
+    }
+    return 0;
+}
+
+// Every connection goes to the -u collector, like a NAT on the way out
+_i16 sl_Connect(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen)
+{
+    struct addrinfo hints, *result;
+    char host[256], *port;
+    int fd = sockFd(sd), rc;
+
+    (void)addr;
+    (void)addrlen;
+    if (fd < 0) {
+        return SL_ERROR_BSD_EBADF;
+    }
+    if (!nwp.joined) {
+        return SL_ERROR_BSD_ENETUNREACH;
+    }
+    if (config.collector == NULL) {
+        return SL_ERROR_BSD_ECONNREFUSED;
+    }
+    snprintf(host, sizeof(host), "%s", config.collector);
+    port = strrchr(host, ':');
+    if (port == NULL) {
+        return SL_ERROR_BSD_ECONNREFUSED;
+    }
+    *port++ = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &result) != 0) {
+        return SL_ERROR_BSD_ECONNREFUSED;
+    }
+    rc = connect(fd, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc == 0 || errno == EISCONN) {
+        return 0;
+    }
+    if (errno == EINPROGRESS || errno == EALREADY) {
+        return SL_ERROR_BSD_EALREADY;
+    }
+    return SL_ERROR_BSD_ECONNREFUSED;
+}
+
+_i16 sl_Send(_i16 sd, const void *pBuf, _i16 Len, _i16 flags)
+{
+    int fd = sockFd(sd);
+    bool reads;
+    ssize_t n;
+
+    (void)flags;
+    if (fd < 0) {
+        return SL_ERROR_BSD_EBADF;
+    }
+    // A collector that accepted and stopped reading: the socket buffers
+    // are full, whatever the host's would hold
+    pthread_mutex_lock(&lock);
+    reads = collectorReads;
+    pthread_mutex_unlock(&lock);
+    if (!reads) {
+        return SL_ERROR_BSD_EAGAIN;
+    }
+    n = send(fd, pBuf, (size_t)Len, MSG_NOSIGNAL);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? SL_ERROR_BSD_EAGAIN : SL_ERROR_BSD_ENOTCONN;
+    }
+    pthread_mutex_lock(&lock);
+    stats.sockBytes += (uint64_t)n;
+    pthread_mutex_unlock(&lock);
+    return (_i16)n;
+}
+
+_i16 sl_Close(_i16 sd)
+{
+    int fd = sockFd(sd);
+
+    if (fd < 0) {
+        return SL_ERROR_BSD_EBADF;
+    }
+    close(fd);
+    sockets[sd] = -1;
+    return 0;
+}
+
+_u16 sl_Htons(_u16 val)
+{
+    return htons(val);
+}
+
+_u32 sl_Htonl(_u32 val)
+{
+    return htonl(val);
+}
@@ -0,0 +1,75 @@
+/*
+ *  ======== hal_sim.h ========
+ *  Linux stand-in for the TI-Drivers used by the thermostat.
+ *
+ *  hal_sim.c implements GPIO, I2C, Timer, UART2 and the SimpleLink file
+ *  system, WLAN and sockets on top of POSIX so that the unmodified firmware
+ *  (gpiointerrupt.c) can run on a development box.
+ *  The functions below are the simulation controls: they select the sensor
+ *  that answers on the bus, move the simulated temperature, inject button
+ *  presses and print the run statistics.
+ */
+#ifndef HAL_SIM_H_
+#define HAL_SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Sensor parts the simulated I2C bus can carry (see sensors[] in gpiointerrupt.c) */
+typedef enum {
+    HAL_SIM_SENSOR_NONE,
+    HAL_SIM_SENSOR_TMP11X,      // 0x48, zone n at 0x48 + n
+    HAL_SIM_SENSOR_TMP116,      // 0x49, zone n at 0x49 + n
+    HAL_SIM_SENSOR_TMP006       // 0x41, zone n at 0x41 + n
+} HalSimSensor;
+
+/* Zones: one sensor of the part and one heat output each */
+#define HAL_SIM_ZONES_MAX 4
+
+/* Scripted stimulus applied at a given timer tick */
+typedef enum {
+    HAL_SIM_EVENT_BUTTON_UP,    // press CONFIG_GPIO_BUTTON_0, value = ticks held (0 = 1)
+    HAL_SIM_EVENT_BUTTON_DOWN,  // press CONFIG_GPIO_BUTTON_1, value = ticks held (0 = 1)
+    HAL_SIM_EVENT_TEMPERATURE,  // value = new sensor temperature in milli-degrees C (hal_sim_addTemperatureEvent)
+    HAL_SIM_EVENT_I2C_STALL,    // value = ms the next I2C transfer holds the bus
+    HAL_SIM_EVENT_UART_RX,      // text arrives on the UART (hal_sim_addRxEvent)
+    HAL_SIM_EVENT_BUSY,         // value = ms the firmware's next GPIO write takes, a task running long
+    HAL_SIM_EVENT_WIFI,         // value = 0 takes the access point down, 1 brings it back
+    HAL_SIM_EVENT_I2C_FAIL,     // value = I2C transfers in a row that fail, a flaky bus
+    HAL_SIM_EVENT_I2C_WEDGE,    // value = SCL clocks until a sensor stops holding SDA low
+    HAL_SIM_EVENT_FLASH,        // value = ms the next serial flash commit takes, a slow erase
+    HAL_SIM_EVENT_COLLECTOR     // value = 0: the collector stops reading, its buffers fill; 1: reads again
+} HalSimEventType;
+
+typedef struct {
+    HalSimSensor    sensor;     // part that answers on the bus
+    int             zones;      // sensors of that part, 1..HAL_SIM_ZONES_MAX
+    int32_t         tempMilliC; // initial sensor temperature
+    double          noiseMilliC; // RMS noise of one sensor sample, 0 = exact readings
+    double          speed;      // simulated seconds per wall-clock second
+    unsigned long   maxTicks;   // stop after this many timer ticks, 0 = run forever
+    int             quiet;      // discard UART output (it is still counted)
+    int             interactive; // stdin is sent to the UART receiver
+    const char     *flashDir;   // serial flash files live here, NULL = no flash
+    const char     *collector;  // HOST:PORT every TCP connection goes to, NULL = refused
+} HalSimConfig;
+
+extern void hal_sim_init(const HalSimConfig *config);
+extern int hal_sim_addEvent(unsigned long tick, HalSimEventType type, int32_t value);
+extern int hal_sim_addRxEvent(unsigned long tick, const char *text);
+/* zone -1 moves every zone's sensor */
+extern int hal_sim_addTemperatureEvent(unsigned long tick, int zone, int32_t milliC);
+
+extern void hal_sim_setTemperature(int zone, int32_t milliC);
+
+/* Bytes arriving on the UART RX line, from any thread */
+extern void hal_sim_uartReceive(const void *data, size_t len);
+/* Pulls the pin low, with contact bounce, and releases it after holdTicks */
+extern void hal_sim_pressButton(uint_least8_t index, unsigned long holdTicks);
+
+/* Simulated time since hal_sim_init(), in microseconds */
+extern uint64_t hal_sim_nowUs(void);
+
+extern void hal_sim_report(FILE *out);
+
+#endif /* HAL_SIM_H_ */
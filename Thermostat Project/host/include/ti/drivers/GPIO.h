@@ -0,0 +1,51 @@
+/*
+ *  ======== GPIO.h ========
+ *  Host stand-in for <ti/drivers/GPIO.h>.
+ *
+ *  Only the subset of the TI-Drivers GPIO API used by the thermostat is
+ *  declared here. Pins are simulated by hal_sim.c; button presses are
+ *  injected with hal_sim_pressButton().
+ */
+#ifndef ti_drivers_GPIO__include
+#define ti_drivers_GPIO__include
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t GPIO_PinConfig;
+
+typedef void (*GPIO_CallbackFxn)(uint_least8_t index);
+
+#define GPIO_STATUS_SUCCESS         (0)
+#define GPIO_STATUS_ERROR           (-1)
+
+#define GPIO_CFG_OUT_STD            (0x00000001U)
+#define GPIO_CFG_OUT_LOW            (0x00000000U)
+#define GPIO_CFG_OUT_HIGH           (0x00000002U)
+#define GPIO_CFG_OUT_OD_NOPULL      (0x00000005U)   // open drain, an output here like OUT_STD
+#define GPIO_CFG_IN_NOPULL          (0x00000000U)
+#define GPIO_CFG_IN_PU              (0x00000010U)
+#define GPIO_CFG_IN_PD              (0x00000020U)
+#define GPIO_CFG_IN_INT_NONE        (0x00000000U)
+#define GPIO_CFG_IN_INT_FALLING     (0x00000100U)
+#define GPIO_CFG_IN_INT_RISING      (0x00000200U)
+#define GPIO_CFG_IN_INT_BOTH_EDGES  (0x00000300U)
+
+extern void GPIO_init(void);
+extern int_fast16_t GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig);
+extern void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback);
+extern void GPIO_clearInt(uint_least8_t index);
+extern void GPIO_enableInt(uint_least8_t index);
+extern void GPIO_disableInt(uint_least8_t index);
+extern uint_fast8_t GPIO_read(uint_least8_t index);
+extern void GPIO_write(uint_least8_t index, unsigned int value);
+extern void GPIO_toggle(uint_least8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_drivers_GPIO__include */
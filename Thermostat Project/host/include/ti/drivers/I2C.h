@@ -0,0 +1,81 @@
+/*
+ *  ======== I2C.h ========
+ *  Host stand-in for <ti/drivers/I2C.h>.
+ *
+ *  Transfers are served by the simulated sensor register files in
+ *  hal_sim.c. In callback mode a controller thread works through the
+ *  queue and calls the transfer callback as the interrupt would.
+ */
+#ifndef ti_drivers_I2C__include
+#define ti_drivers_I2C__include
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_STATUS_QUEUED           (1)
+#define I2C_STATUS_SUCCESS          (0)
+#define I2C_STATUS_ERROR            (-1)
+#define I2C_STATUS_UNDEFINEDCMD     (-2)
+#define I2C_STATUS_TIMEOUT          (-3)
+#define I2C_STATUS_CLOCK_TIMEOUT    (-4)
+#define I2C_STATUS_ADDR_NACK        (-5)
+#define I2C_STATUS_DATA_NACK        (-6)
+#define I2C_STATUS_ARB_LOST         (-7)
+#define I2C_STATUS_INCOMPLETE       (-8)
+#define I2C_STATUS_BUS_BUSY         (-9)
+#define I2C_STATUS_CANCEL           (-10)
+
+#define I2C_WAIT_FOREVER            (~(0U))
+
+typedef struct I2C_Config_ *I2C_Handle;
+
+typedef struct {
+    void                   *writeBuf;
+    size_t                  writeCount;
+    void                   *readBuf;
+    size_t                  readCount;
+    void                   *arg;
+    volatile int_fast16_t   status;
+    uint_least8_t           targetAddress;
+    void                   *nextPtr;
+} I2C_Transaction;
+
+typedef enum {
+    I2C_MODE_BLOCKING,
+    I2C_MODE_CALLBACK
+} I2C_TransferMode;
+
+typedef void (*I2C_CallbackFxn)(I2C_Handle handle, I2C_Transaction *msg, bool transferStatus);
+
+typedef enum {
+    I2C_100kHz  = 0,
+    I2C_400kHz  = 1,
+    I2C_1000kHz = 2,
+    I2C_3330kHz = 3,
+    I2C_3400kHz = 3
+} I2C_BitRate;
+
+typedef struct {
+    I2C_TransferMode    transferMode;
+    I2C_CallbackFxn     transferCallbackFxn;
+    I2C_BitRate         bitRate;
+    void               *custom;
+} I2C_Params;
+
+extern void I2C_init(void);
+extern void I2C_Params_init(I2C_Params *params);
+extern I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params);
+extern void I2C_close(I2C_Handle handle);
+extern bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction);
+extern void I2C_cancel(I2C_Handle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_drivers_I2C__include */
@@ -0,0 +1,29 @@
+/*
+ *  ======== Power.h ========
+ *  Host stand-in for <ti/drivers/Power.h>.
+ *
+ *  Power_idleFunc() blocks the calling thread until the next simulated
+ *  interrupt, the way the sleep policy leaves the core in WFI. hal_sim.c
+ *  counts the wakeups and the time spent asleep.
+ */
+#ifndef ti_drivers_Power__include
+#define ti_drivers_Power__include
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define Power_SOK                   (0)
+#define Power_EFAIL                 (-1)
+
+extern void Power_enablePolicy(void);
+extern void Power_disablePolicy(void);
+extern void Power_idleFunc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_drivers_Power__include */
@@ -0,0 +1,82 @@
+/*
+ *  ======== UART2.h ========
+ *  Host stand-in for <ti/drivers/UART2.h>.
+ *
+ *  Writes go to stdout and take the time the bytes would need on the wire
+ *  at the configured baud rate. Blocking and callback write modes are
+ *  modelled. Received bytes come from scripted events or stdin and wait in
+ *  a driver ring buffer until a read takes them.
+ */
+#ifndef ti_drivers_UART2__include
+#define ti_drivers_UART2__include
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART2_STATUS_SUCCESS        (0)
+#define UART2_STATUS_EINUSE         (-6)
+#define UART2_STATUS_ETIMEOUT       (-9)
+#define UART2_STATUS_ECANCELLED     (-10)
+
+typedef struct UART2_Config_ *UART2_Handle;
+
+typedef enum {
+    UART2_Mode_BLOCKING,
+    UART2_Mode_CALLBACK,
+    UART2_Mode_NONBLOCKING
+} UART2_Mode;
+
+typedef enum {
+    UART2_ReadReturnMode_FULL,
+    UART2_ReadReturnMode_PARTIAL
+} UART2_ReadReturnMode;
+
+typedef enum {
+    UART2_DataLen_5 = 0,
+    UART2_DataLen_6 = 1,
+    UART2_DataLen_7 = 2,
+    UART2_DataLen_8 = 3
+} UART2_DataLen;
+
+typedef enum {
+    UART2_StopBits_1 = 0,
+    UART2_StopBits_2 = 1
+} UART2_StopBits;
+
+typedef enum {
+    UART2_Parity_NONE = 0
+} UART2_Parity;
+
+typedef void (*UART2_Callback)(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+typedef void (*UART2_EventCallback)(UART2_Handle handle, uint32_t event, uint32_t data, void *userArg);
+
+typedef struct {
+    UART2_Mode              readMode;
+    UART2_Mode              writeMode;
+    UART2_Callback          readCallback;
+    UART2_Callback          writeCallback;
+    UART2_EventCallback     eventCallback;
+    uint32_t                eventMask;
+    UART2_ReadReturnMode    readReturnMode;
+    uint32_t                baudRate;
+    UART2_DataLen           dataLength;
+    UART2_StopBits          stopBits;
+    UART2_Parity            parityType;
+    void                   *userArg;
+} UART2_Params;
+
+extern void UART2_Params_init(UART2_Params *params);
+extern UART2_Handle UART2_open(uint_least8_t index, UART2_Params *params);
+extern void UART2_close(UART2_Handle handle);
+extern int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead);
+extern int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_drivers_UART2__include */
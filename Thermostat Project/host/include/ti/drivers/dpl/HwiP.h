@@ -0,0 +1,24 @@
+/*
+ *  ======== HwiP.h ========
+ *  Host stand-in for <ti/drivers/dpl/HwiP.h>.
+ *
+ *  Masking interrupts holds off the simulated timer and GPIO callbacks
+ *  until the matching HwiP_restore().
+ */
+#ifndef ti_dpl_HwiP__include
+#define ti_dpl_HwiP__include
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uintptr_t HwiP_disable(void);
+extern void HwiP_restore(uintptr_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_dpl_HwiP__include */
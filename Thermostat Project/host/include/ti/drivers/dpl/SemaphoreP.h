@@ -0,0 +1,38 @@
+/*
+ *  ======== SemaphoreP.h ========
+ *  Host stand-in for <ti/drivers/dpl/SemaphoreP.h>, for the
+ *  THERMOSTAT_RTOS build.
+ *
+ *  A counting semaphore on a mutex and a condition variable. Posting is
+ *  safe from the simulated interrupts; timeouts are in milliseconds, the
+ *  kernel tick of the target's FreeRTOS configuration.
+ */
+#ifndef ti_dpl_SemaphoreP__include
+#define ti_dpl_SemaphoreP__include
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SemaphoreP_WAIT_FOREVER ~(0)
+#define SemaphoreP_NO_WAIT      (0)
+
+typedef enum {
+    SemaphoreP_OK = 0,
+    SemaphoreP_TIMEOUT = -1
+} SemaphoreP_Status;
+
+typedef void *SemaphoreP_Handle;
+
+extern SemaphoreP_Handle SemaphoreP_createBinary(unsigned int count);
+extern void SemaphoreP_delete(SemaphoreP_Handle handle);
+extern SemaphoreP_Status SemaphoreP_pend(SemaphoreP_Handle handle, uint32_t timeout);
+extern void SemaphoreP_post(SemaphoreP_Handle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_dpl_SemaphoreP__include */
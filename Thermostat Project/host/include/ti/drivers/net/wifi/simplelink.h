@@ -0,0 +1,152 @@
+/*
+ *  ======== simplelink.h ========
+ *  Host stand-in for <ti/drivers/net/wifi/simplelink.h>: device, file
+ *  system, WLAN connection policy and TCP sockets.
+ *
+ *  sl_Start() and sl_Stop() power the simulated network processor up and
+ *  down and take the time its boot would. The serial-flash file system is
+ *  a directory on the host (thermostat_sim -f DIR), so files survive from
+ *  one run to the next the way they survive a power cycle. A file opened
+ *  for writing is built in a temporary file and replaces the old one on
+ *  sl_FsClose(), which is what SL_FS_CREATE_FAILSAFE promises.
+ *
+ *  With the auto-connect policy set, the simulated access point (up unless
+ *  a script takes it down) is joined a while after sl_Start(); the connect
+ *  and IP events reach the application's handlers from sl_Task(), as in a
+ *  NoRTOS build. TCP sockets are real host sockets, and every connection
+ *  goes to the collector given with thermostat_sim -u HOST:PORT whatever
+ *  address the firmware asks for, the way a NAT would send it.
+ */
+#ifndef ti_drivers_net_wifi_simplelink__include
+#define ti_drivers_net_wifi_simplelink__include
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t     _u8;
+typedef int8_t      _i8;
+typedef uint16_t    _u16;
+typedef int16_t     _i16;
+typedef uint32_t    _u32;
+typedef int32_t     _i32;
+
+typedef void (*P_INIT_CALLBACK)(_u32 status, void *pDevInfo);
+
+#define SL_RET_CODE_OK                      (0)
+#define SL_ERROR_FS_FILE_NOT_EXISTS         (-10341)
+#define SL_ERROR_FS_FILE_MAX_SIZE_EXCEEDED  (-10260)
+#define SL_ERROR_FS_NO_AVAILABLE_BLOCKS     (-10265)
+#define SL_ERROR_FS_INVALID_HANDLE          (-10270)
+#define SL_ERROR_DEVICE_NOT_STARTED         (-2018)
+#define SL_ERROR_BSD_EAGAIN                 (-11)
+#define SL_ERROR_BSD_ENETUNREACH            (-101)
+#define SL_ERROR_BSD_ENOTCONN               (-107)
+#define SL_ERROR_BSD_ECONNREFUSED           (-111)
+#define SL_ERROR_BSD_EALREADY               (-114)
+#define SL_ERROR_BSD_EBADF                  (-9)
+#define SL_ERROR_BSD_ENSOCK                 (-10)
+
+#define SL_FS_OPEN_MODE_BIT                 29
+#define SL_FS_OPEN_FLAGS_BIT                16
+#define SL_FS_OPEN_MAXSIZE_BIT_MASK         0xFFFF
+
+#define SL_FS_READ                          ((_u32)0x0 << SL_FS_OPEN_MODE_BIT)
+#define SL_FS_WRITE                         ((_u32)0x1 << SL_FS_OPEN_MODE_BIT)
+#define SL_FS_CREATE                        ((_u32)0x2 << SL_FS_OPEN_MODE_BIT)
+#define SL_FS_OVERWRITE                     ((_u32)0x3 << SL_FS_OPEN_MODE_BIT)
+#define SL_FS_CREATE_FAILSAFE               ((_u32)0x1 << SL_FS_OPEN_FLAGS_BIT)
+#define SL_FS_CREATE_MAX_SIZE(size)         ((((_u32)(size) + 255) / 256) & SL_FS_OPEN_MAXSIZE_BIT_MASK)
+
+/* WLAN */
+#define SL_WLAN_POLICY_CONNECTION           (16)
+#define SL_WLAN_CONNECTION_POLICY(Auto, Fast, anyP2P, autoProvisioning) \
+    (((Auto) << 1) | ((Fast) << 2) | ((anyP2P) << 5) | ((autoProvisioning) << 6))
+
+#define SL_WLAN_EVENT_CONNECT               (1)
+#define SL_WLAN_EVENT_DISCONNECT            (2)
+#define SL_NETAPP_EVENT_IPV4_ACQUIRED       (1)
+
+typedef struct { _u32 Id; } SlWlanEvent_t;
+typedef struct { _u32 Id; } SlNetAppEvent_t;
+typedef struct { _u32 Id; } SlDeviceEvent_t;
+typedef struct { _u32 Event; } SlSockEvent_t;
+typedef struct { _u32 Id; } SlDeviceFatal_t;
+typedef struct { _u32 Event; } SlNetAppHttpServerEvent_t;
+typedef struct { _u32 Response; } SlNetAppHttpServerResponse_t;
+typedef struct { _u8 AppId; } SlNetAppRequest_t;
+typedef struct { _u16 Status; } SlNetAppResponse_t;
+
+/* Sockets */
+#define SL_AF_INET                          (2)
+#define SL_SOCK_STREAM                      (1)
+#define SL_IPPROTO_TCP                      (6)
+#define SL_SOL_SOCKET                       (1)
+#define SL_SO_NONBLOCKING                   (24)
+
+#define SL_IPV4_VAL(add_3, add_2, add_1, add_0) \
+    ((((_u32)(add_3) << 24) & 0xFF000000) | (((_u32)(add_2) << 16) & 0xFF0000) | \
+     (((_u32)(add_1) << 8) & 0xFF00) | ((_u32)(add_0) & 0xFF))
+
+typedef _u16 SlSocklen_t;
+
+typedef struct {
+    _u16 sa_family;
+    _u8  sa_data[14];
+} SlSockAddr_t;
+
+typedef struct {
+    _u32 s_addr;
+} SlInAddr_t;
+
+typedef struct {
+    _u16       sin_family;
+    _u16       sin_port;
+    SlInAddr_t sin_addr;
+    _i8        sin_zero[8];
+} SlSockAddrIn_t;
+
+typedef struct {
+    _u32 NonBlockingEnabled;
+} SlSockNonblocking_t;
+
+extern _i16 sl_Start(const void *pIfHdl, _i8 *pDevName, const P_INIT_CALLBACK pInitCallBack);
+extern _i16 sl_Stop(const _u16 timeout);
+
+extern _i32 sl_FsOpen(const _u8 *pFileName, const _u32 AccessModeAndMaxSize, _u32 *pToken);
+extern _i16 sl_FsClose(const _i32 FileHdl, const _u8 *pCeritificateFileName,
+                       const _u8 *pSignature, const _u32 SignatureLen);
+extern _i32 sl_FsRead(const _i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len);
+extern _i32 sl_FsWrite(const _i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len);
+extern _i16 sl_FsDel(const _u8 *pFileName, const _u32 Token);
+
+extern void *sl_Task(void *pEntry);
+extern _i16 sl_WlanPolicySet(const _u8 Type, const _u8 Policy, _u8 *pVal, const _u8 ValLen);
+
+extern _i16 sl_Socket(_i16 Domain, _i16 Type, _i16 Protocol);
+extern _i16 sl_SetSockOpt(_i16 sd, _i16 level, _i16 optname, const void *optval, SlSocklen_t optlen);
+extern _i16 sl_Connect(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen);
+extern _i16 sl_Send(_i16 sd, const void *pBuf, _i16 Len, _i16 flags);
+extern _i16 sl_Close(_i16 sd);
+extern _u16 sl_Htons(_u16 val);
+extern _u32 sl_Htonl(_u32 val);
+
+/* Event handlers the application provides */
+extern void SimpleLinkWlanEventHandler(SlWlanEvent_t *pWlanEvent);
+extern void SimpleLinkNetAppEventHandler(SlNetAppEvent_t *pNetAppEvent);
+extern void SimpleLinkGeneralEventHandler(SlDeviceEvent_t *pDevEvent);
+extern void SimpleLinkSockEventHandler(SlSockEvent_t *pSock);
+extern void SimpleLinkFatalErrorEventHandler(SlDeviceFatal_t *slFatalErrorEvent);
+extern void SimpleLinkHttpServerEventHandler(SlNetAppHttpServerEvent_t *pHttpEvent,
+                                             SlNetAppHttpServerResponse_t *pHttpResponse);
+extern void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
+                                                SlNetAppResponse_t *pNetAppResponse);
+extern void SimpleLinkNetAppRequestMemFreeEventHandler(_u8 *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ti_drivers_net_wifi_simplelink__include */
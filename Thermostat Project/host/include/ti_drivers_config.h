@@ -0,0 +1,59 @@
+/*
+ *  ======== ti_drivers_config.h ========
+ *  Host stand-in for the SysConfig-generated board configuration.
+ *
+ *  Pin and instance numbers match the CC3220S_LAUNCHXL values in
+ *  MCU+Image/syscfg/ti_drivers_config.h so that log output reads the same
+ *  on both targets.
+ */
+#ifndef ti_drivers_config_h
+#define ti_drivers_config_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *  ======== GPIO ========
+ */
+#define CONFIG_GPIO_BUTTON_0 13
+#define CONFIG_GPIO_BUTTON_1 22
+#define CONFIG_GPIO_LED_0 9
+#define CONFIG_GPIO_HEAT_1 28
+#define CONFIG_GPIO_HEAT_2 30
+#define CONFIG_GPIO_HEAT_3 3
+
+/* LEDs are active high */
+#define CONFIG_GPIO_LED_ON  (1)
+#define CONFIG_GPIO_LED_OFF (0)
+
+#define CONFIG_LED_ON  (CONFIG_GPIO_LED_ON)
+#define CONFIG_LED_OFF (CONFIG_GPIO_LED_OFF)
+
+/*
+ *  ======== I2C ========
+ */
+#define CONFIG_I2C_0                    0
+#define CONFIG_TI_DRIVERS_I2C_COUNT     1
+
+/*
+ *  ======== Timer ========
+ */
+#define CONFIG_TIMER_0                      0
+#define CONFIG_TI_DRIVERS_TIMER_COUNT       1
+
+/*
+ *  ======== UART2 ========
+ */
+#define CONFIG_UART2_0                      0
+#define CONFIG_TI_DRIVERS_UART2_COUNT       1
+
+extern void Board_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* include guard */
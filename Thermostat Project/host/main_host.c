@@ -0,0 +1,296 @@
+/*
+ *  ======== main_host.c ========
+ *  Entry point of the host simulation build. Takes the place of
+ *  main_nortos.c, or of main_freertos.c in the THERMOSTAT_RTOS build:
+ *  configure the simulated board, then hand control to the same
+ *  mainThread() that runs on the LaunchPad.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <ti/drivers/Power.h>
+
+#include "ti_drivers_config.h"
+#include "hal_sim.h"
+#include "buttonqueue.h"
+#include "cmdline.h"
+#include "histlog.h"
+#include "sensorfault.h"
+#include "sensorhealth.h"
+#include "thermostat.h"
+#include "txqueue.h"
+#include "uplink.h"
+
+// Firmware-side counters, printed after the HAL report when the run ends
+static void reportFirmware(void)
+{
+    TxQueueStats tx;
+    ButtonQueueStats buttons;
+    HistLogStats log;
+    CmdLineStats commands;
+    UplinkStats uplink;
+    SensorFaultStats faults;
+    SensorHealthStats health;
+
+    txQueueGetStats(&tx);
+    buttonQueueGetStats(&buttons);
+    histLogGetStats(&log);
+    cmdLineGetStats(&commands);
+    uplinkGetStats(&uplink);
+    sensorFaultGetStats(&faults);
+    sensorHealthGetStats(&health);
+    fprintf(stderr, "uart tx queue      : %lu queued, %lu sent, %lu dropped in %lu messages, high water %u/%u\n",
+            (unsigned long)tx.queuedBytes, (unsigned long)tx.sentBytes,
+            (unsigned long)tx.droppedBytes, (unsigned long)tx.droppedMessages,
+            (unsigned)tx.highWater, (unsigned)TXQUEUE_SIZE);
+    fprintf(stderr, "button events      : %lu presses, %lu repeats, %lu dropped\n",
+            (unsigned long)buttons.presses, (unsigned long)buttons.repeats,
+            (unsigned long)buttons.dropped);
+    fprintf(stderr, "history log        : boot %u, segment %lu, %lu samples, %lu writes (%lu failed), %lu bad segments\n",
+            (unsigned)log.boot, (unsigned long)log.sequence, (unsigned long)log.samples,
+            (unsigned long)log.segmentWrites, (unsigned long)log.writeErrors,
+            (unsigned long)log.badSegments);
+    fprintf(stderr, "command lines      : %lu received, %lu dropped, %lu rejected\n",
+            (unsigned long)commands.lines, (unsigned long)commands.dropped,
+            (unsigned long)commands.errors);
+    fprintf(stderr, "sensor faults      : %lu failed transfers, %lu timeouts, %lu bus recoveries, %lu fail-safes, failing %lx, heat off %lx\n",
+            (unsigned long)faults.failedTransfers, (unsigned long)faults.timeouts,
+            (unsigned long)faults.recoveries, (unsigned long)faults.failSafes,
+            (unsigned long)faults.failing, (unsigned long)faults.heatOff);
+    fprintf(stderr, "sensor readings    : %lu spikes, %lu jumps, %lu out of range, %lu stuck, suspect %lx, heat off %lx\n",
+            (unsigned long)health.spikes, (unsigned long)health.jumps,
+            (unsigned long)health.outOfRange, (unsigned long)health.stuck,
+            (unsigned long)health.suspect, (unsigned long)health.heatOff);
+    fprintf(stderr, "uplink             : %lu queued, %lu delivered, %u pending, %lu dropped, %lu sessions (%lu failed), %lu bytes\n",
+            (unsigned long)uplink.queued, (unsigned long)uplink.delivered, (unsigned)uplink.pending,
+            (unsigned long)uplink.dropped, (unsigned long)uplink.sessions,
+            (unsigned long)uplink.failures, (unsigned long)uplink.bytes);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n ticks] [-s speed] [-t celsius] [-N celsius] [-p part] [-z zones] [-e event]... [-f dir] [-u host:port] [-c deadband] [-b] [-i] [-q]\n"
+            "  -n ticks    stop after this many 100 ms timer ticks (default: run forever)\n"
+            "  -s speed    simulated seconds per wall-clock second (default 1)\n"
+            "  -t celsius  initial sensor temperature (default 22.0)\n"
+            "  -N celsius  RMS noise of one sensor sample; the part averages\n"
+            "              it down (default 0, exact readings)\n"
+            "  -p part     sensor on the bus: 11x, 116, 006 or none (default 11x)\n"
+            "  -z zones    sensors of that part, one per heating zone, at\n"
+            "              consecutive addresses (default 1, at most 4, 3 for 116)\n"
+            "  -e event    scripted stimulus TICK:up[=HELD], TICK:down[=HELD] (button\n"
+            "              held for HELD ticks, default 1), TICK:temp=CELSIUS (every\n"
+            "              zone), TICK:tempZONE=CELSIUS (one zone),\n"
+            "              TICK:i2cstall=MS (next I2C transfer holds the bus),\n"
+            "              TICK:i2cfail=N (next N I2C transfers fail),\n"
+            "              TICK:i2cwedge=CLOCKS (a sensor holds SDA low until\n"
+            "              that many SCL clocks),\n"
+            "              TICK:busy=MS (next GPIO write takes MS, a long task),\n"
+            "              TICK:flash=MS (next flash commit takes MS),\n"
+            "              TICK:wifi=0|1 (access point down or back up),\n"
+            "              TICK:collector=0|1 (the collector stops reading or\n"
+            "              reads again) or\n"
+            "              TICK:rx=TEXT (TEXT arrives on the UART, \\n and \\r escapes)\n"
+            "  -f dir      keep the serial flash files in dir, so the history log\n"
+            "              survives from one run to the next (default: no flash)\n"
+            "  -u host:port collector every uplink connection goes to (default:\n"
+            "              connections are refused)\n"
+            "  -c deadband report on change: only when the temperature moves more\n"
+            "              than deadband degC, the set point or heat changes, or\n"
+            "              after 60 s of silence (default: report every second)\n"
+            "  -b          binary telemetry frames instead of ASCII reports\n"
+            "  -i          send stdin to the UART receiver (type help and Enter)\n"
+            "  -q          discard UART output, only count it\n",
+            prog);
+}
+
+static int32_t parseMilliC(const char *text)
+{
+    return (int32_t)(strtod(text, NULL) * 1000.0);
+}
+
+// rx=TEXT: \n and \r escapes stand for the line endings a terminal sends
+static int parseRxEvent(unsigned long tick, const char *text)
+{
+    char line[128];
+    size_t n = 0;
+
+    while (*text && n < sizeof(line) - 1) {
+        if (text[0] == '\\' && text[1] == 'n') {
+            line[n++] = '\n';
+            text += 2;
+        } else if (text[0] == '\\' && text[1] == 'r') {
+            line[n++] = '\r';
+            text += 2;
+        } else {
+            line[n++] = *text++;
+        }
+    }
+    line[n] = '\0';
+    return hal_sim_addRxEvent(tick, line);
+}
+
+static int parseEvent(const char *text)
+{
+    char *rest;
+    unsigned long tick = strtoul(text, &rest, 10);
+
+    if (*rest != ':') {
+        return -1;
+    }
+    ++rest;
+    if (strcmp(rest, "up") == 0 || strncmp(rest, "up=", 3) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_BUTTON_UP, rest[2] ? atoi(rest + 3) : 0);
+    }
+    if (strcmp(rest, "down") == 0 || strncmp(rest, "down=", 5) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_BUTTON_DOWN, rest[4] ? atoi(rest + 5) : 0);
+    }
+    if (strncmp(rest, "temp", 4) == 0) {
+        char *value;
+        long zone = strtol(rest + 4, &value, 10);
+
+        if (*value != '=' || zone < 0 || zone >= HAL_SIM_ZONES_MAX) {
+            return -1;
+        }
+        return hal_sim_addTemperatureEvent(tick, value == rest + 4 ? -1 : (int)zone, parseMilliC(value + 1));
+    }
+    if (strncmp(rest, "i2cstall=", 9) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_I2C_STALL, atoi(rest + 9));
+    }
+    if (strncmp(rest, "i2cfail=", 8) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_I2C_FAIL, atoi(rest + 8));
+    }
+    if (strncmp(rest, "i2cwedge=", 9) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_I2C_WEDGE, atoi(rest + 9));
+    }
+    if (strncmp(rest, "busy=", 5) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_BUSY, atoi(rest + 5));
+    }
+    if (strncmp(rest, "flash=", 6) == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_FLASH, atoi(rest + 6));
+    }
+    if (strcmp(rest, "wifi=0") == 0 || strcmp(rest, "wifi=1") == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_WIFI, rest[5] - '0');
+    }
+    if (strcmp(rest, "collector=0") == 0 || strcmp(rest, "collector=1") == 0) {
+        return hal_sim_addEvent(tick, HAL_SIM_EVENT_COLLECTOR, rest[10] - '0');
+    }
+    if (strncmp(rest, "rx=", 3) == 0) {
+        return parseRxEvent(tick, rest + 3);
+    }
+    return -1;
+}
+
+/*
+ *  ======== main ========
+ */
+int main(int argc, char *argv[])
+{
+    HalSimConfig config = {
+        .sensor = HAL_SIM_SENSOR_TMP11X,
+        .zones = 1,
+        .tempMilliC = 22000,
+        .speed = 1.0,
+        .maxTicks = 0,
+        .quiet = 0,
+        .interactive = 0
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:t:N:p:z:e:f:u:c:biqh")) != -1) {
+        switch (opt) {
+        case 'n':
+            config.maxTicks = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            config.speed = strtod(optarg, NULL);
+            break;
+        case 't':
+            config.tempMilliC = parseMilliC(optarg);
+            break;
+        case 'N':
+            config.noiseMilliC = strtod(optarg, NULL) * 1000.0;
+            break;
+        case 'p':
+            if (strcmp(optarg, "11x") == 0) {
+                config.sensor = HAL_SIM_SENSOR_TMP11X;
+            } else if (strcmp(optarg, "116") == 0) {
+                config.sensor = HAL_SIM_SENSOR_TMP116;
+            } else if (strcmp(optarg, "006") == 0) {
+                config.sensor = HAL_SIM_SENSOR_TMP006;
+            } else if (strcmp(optarg, "none") == 0) {
+                config.sensor = HAL_SIM_SENSOR_NONE;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'z':
+            config.zones = atoi(optarg);
+            break;
+        case 'e':
+            if (parseEvent(optarg) != 0) {
+                fprintf(stderr, "bad event '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'f':
+            if (mkdir(optarg, 0777) != 0 && errno != EEXIST) {
+                perror(optarg);
+                return 2;
+            }
+            config.flashDir = optarg;
+            break;
+        case 'u':
+            if (strchr(optarg, ':') == NULL) {
+                usage(argv[0]);
+                return 2;
+            }
+            config.collector = optarg;
+            break;
+        case 'c':
+            telemetryMode = TELEMETRY_ON_CHANGE;
+            telemetryDeadband = (tempq7_t)(strtod(optarg, NULL) * TEMP_Q7_ONE);
+            break;
+        case 'b':
+            telemetryFormat = TELEMETRY_BINARY;
+            break;
+        case 'i':
+            config.interactive = 1;
+            break;
+        case 'q':
+            config.quiet = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (config.zones < 1 || config.zones > HAL_SIM_ZONES_MAX ||
+        (config.sensor == HAL_SIM_SENSOR_TMP116 && config.zones > HAL_SIM_ZONES_MAX - 1)) {
+        usage(argv[0]);
+        return 2;
+    }
+    hal_sim_init(&config);
+    atexit(reportFirmware);
+    Board_init();
+
+    /* Call mainThread function */
+    mainThread(NULL);
+
+#if defined(THERMOSTAT_RTOS)
+    // The task threads run on; this is the kernel's idle task
+    for (;;) {
+        Power_idleFunc();
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,444 @@
+/*
+ *  ======== replay.c ========
+ *  Replays recorded telemetry through the control logic, faster than real
+ *  time.
+ *
+ *      replay [-e SECONDS:up|down[:ZONE]]... [-x] [-v] [trace...]
+ *      thermostat_sim -b -s 500 -n 36000 -q | tlm2csv > hour.csv; replay hour.csv
+ *
+ *  A trace is what a thermostat reported in the field, in any form the
+ *  host tools keep it: the ASCII reports of UART2Output captured from the
+ *  UART, tlm2csv output, or the history log export (L lines). Other lines
+ *  are skipped, so a terminal capture with boot messages works as it is.
+ *  Files are replayed one after the other as one corpus, stdin if none are
+ *  given; a report whose uptime goes backwards starts a new boot.
+ *
+ *  Set point changes in the trace reach the zone through
+ *  zonesStepSetPoint(), the function the button task uses, and so do the
+ *  presses injected with -e (seconds into the corpus; the buttons set zone
+ *  0 on the board, but any zone can be given here). The controllers then
+ *  run the sweeps adjustHeat runs, zonesControl() every 500 ms of uptime:
+ *  the ones between two reports on the earlier report's temperatures,
+ *  which is all the firmware had then, and the one at the report on its
+ *  temperatures as fresh readings. Each boot starts them over. Where the
+ *  set point is still the recorded one, the decision at the report must be
+ *  the recorded heat state; -x fails the run on any mismatch, for use as a
+ *  regression check, and -v lists the first ones.
+ *
+ *  The controller acts on the history of its readings, not the last one
+ *  alone (heatctl.h), so a decision only reproduces from reports every
+ *  second from boot with the full reading: tlm2csv output of a periodic
+ *  one second binary stream. ASCII reports carry whole degrees, and the
+ *  log and slower streams leave gaps; those replays still show what the
+ *  controller makes of the trace, but mismatches are expected. So are
+ *  reports while a zone's heat was held off for a failing sensor
+ *  (sensorfault.h), which the trace does not mark.
+ *
+ *  The report gives the decisions per second and the time per decision of
+ *  the replay itself, and the heat duty cycle and switch count of the
+ *  recorded and the replayed outputs, weighted by the time each report
+ *  stood for.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tempq7.h"
+#include "zones.h"
+
+#define EVENTS_MAX      256
+#define MISMATCHES_SHOWN 10
+#define SWEEP_MS        500     // HEAT_TASK period
+
+typedef struct {
+    uint32_t    time;                   // seconds into the corpus
+    uint32_t    uptime;                 // seconds since its boot
+    uint8_t     count;                  // zones reported
+    uint32_t    heatMask;               // recorded heat outputs
+    tempq7_t    temperature[ZONES_MAX];
+    int8_t      setPoint[ZONES_MAX];
+} Report;
+
+typedef struct {
+    uint32_t    time;
+    uint8_t     zone;
+    int8_t      delta;                  // +1 up, -1 down
+} Press;
+
+static Report *reports;
+static size_t numReports, maxReports;
+static Press presses[EVENTS_MAX];
+static size_t numPresses;
+
+// Corpus time: uptime within a boot, plus the boots before it
+static uint32_t timeBase, lastUptime;
+
+static double nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t corpusTime(uint32_t uptime)
+{
+    if (uptime < lastUptime) {
+        timeBase += lastUptime;     // a new boot
+    }
+    lastUptime = uptime;
+    return timeBase + uptime;
+}
+
+static Report *newReport(void)
+{
+    if (numReports == maxReports) {
+        maxReports = maxReports ? 2 * maxReports : 4096;
+        reports = realloc(reports, maxReports * sizeof(*reports));
+        if (reports == NULL) {
+            perror("replay");
+            exit(1);
+        }
+    }
+    memset(&reports[numReports], 0, sizeof(reports[numReports]));
+    return &reports[numReports++];
+}
+
+// Decimal degrees to Q7, rounded to the nearest step
+static bool parseQ7(const char *text, char **end, tempq7_t *out)
+{
+    double value = strtod(text, end);
+
+    if (*end == text) {
+        return false;
+    }
+    *out = (tempq7_t)(long)(value * TEMP_Q7_ONE + (value < 0 ? -0.5 : 0.5));
+    return true;
+}
+
+// <T, S, H, [T, S, H, ...] UPTIME>: whole degrees, one triple per zone
+static bool parseAscii(const char *line)
+{
+    long fields[3 * ZONES_MAX + 1];
+    const char *p = strchr(line, '<');
+    char *end;
+    size_t n = 0, z;
+    Report *r;
+
+    if (p == NULL) {
+        return false;
+    }
+    for (++p; n < sizeof(fields) / sizeof(fields[0]); ++n) {
+        fields[n] = strtol(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+        while (*p == ' ') {
+            ++p;
+        }
+        if (*p == '>') {
+            ++n;
+            break;
+        }
+        if (*p++ != ',') {
+            return false;
+        }
+    }
+    if (n < 4 || (n - 1) % 3 != 0 || p[-1] == ',') {
+        return false;
+    }
+    r = newReport();
+    r->count = (uint8_t)((n - 1) / 3);
+    for (z = 0; z < r->count; ++z) {
+        r->temperature[z] = TEMP_Q7(fields[3 * z]);
+        r->setPoint[z] = (int8_t)fields[3 * z + 1];
+        r->heatMask |= fields[3 * z + 2] ? ZONE_BIT(z) : 0;
+    }
+    r->uptime = (uint32_t)fields[n - 1];
+    r->time = corpusTime(r->uptime);
+    return true;
+}
+
+// tlm2csv: sequence,uptime_s,temperature_c,set_point_c,heat_on,zone
+// history log: L,boot,uptime_s,temperature_c,set_point_c,heat_on
+static bool parseCsv(const char *line)
+{
+    static unsigned long lastKey = ~0UL;   // rows of one report share sequence and uptime
+    unsigned long key, uptime;
+    tempq7_t temperature, setPoint;
+    long heat, zone = 0;
+    bool log = line[0] == 'L' && line[1] == ',';
+    char *p;
+    Report *r;
+
+    key = strtoul(line + (log ? 2 : 0), &p, 10);
+    if (*p++ != ',') {
+        return false;
+    }
+    uptime = strtoul(p, &p, 10);
+    if (*p++ != ',' || !parseQ7(p, &p, &temperature) || *p++ != ',' ||
+        !parseQ7(p, &p, &setPoint) || *p++ != ',') {
+        return false;
+    }
+    heat = strtol(p, &p, 10);
+    if (!log && (*p++ != ',' || (zone = strtol(p, &p, 10)) < 0)) {
+        return false;
+    }
+    if (zone >= ZONES_MAX) {
+        return true;    // counted, not replayed
+    }
+    key = (key << 20) ^ uptime;
+    if (log || zone == 0 || numReports == 0 || key != lastKey) {
+        r = newReport();
+        r->uptime = (uint32_t)uptime;
+        r->time = corpusTime(r->uptime);
+    } else {
+        r = &reports[numReports - 1];
+    }
+    lastKey = key;
+    if (zone + 1 > r->count) {
+        r->count = (uint8_t)(zone + 1);
+    }
+    r->temperature[zone] = temperature;
+    r->setPoint[zone] = (int8_t)(setPoint / TEMP_Q7_ONE);
+    r->heatMask |= heat ? ZONE_BIT(zone) : 0;
+    return true;
+}
+
+static unsigned long load(FILE *in)
+{
+    char line[512];
+    unsigned long parsed = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        if (strchr(line, '<') ? parseAscii(line) : parseCsv(line)) {
+            ++parsed;
+        }
+    }
+    return parsed;
+}
+
+static int parsePress(const char *text)
+{
+    char *p;
+    unsigned long time = strtoul(text, &p, 10);
+    long zone = 0;
+    int delta;
+
+    if (*p++ != ':' || numPresses == EVENTS_MAX) {
+        return -1;
+    }
+    if (strncmp(p, "up", 2) == 0) {
+        delta = 1;
+        p += 2;
+    } else if (strncmp(p, "down", 4) == 0) {
+        delta = -1;
+        p += 4;
+    } else {
+        return -1;
+    }
+    if (*p == ':') {
+        zone = strtol(p + 1, &p, 10);
+    }
+    if (*p != '\0' || zone < 0 || zone >= ZONES_MAX) {
+        return -1;
+    }
+    presses[numPresses].time = (uint32_t)time;
+    presses[numPresses].zone = (uint8_t)zone;
+    presses[numPresses].delta = (int8_t)delta;
+    ++numPresses;
+    return 0;
+}
+
+static int comparePresses(const void *a, const void *b)
+{
+    const Press *x = a, *y = b;
+
+    return (x->time > y->time) - (x->time < y->time);
+}
+
+static unsigned popcount(uint32_t v)
+{
+    unsigned n = 0;
+
+    for (; v; v &= v - 1) {
+        ++n;
+    }
+    return n;
+}
+
+static void startZones(ZoneSet *zones, const int8_t setPoint[])
+{
+    uint8_t z;
+
+    zonesInit(zones);
+    for (z = 0; z < ZONES_MAX; ++z) {
+        zonesAdd(zones, 0, 0, z, setPoint[z]);
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-e SECONDS:up|down[:ZONE]]... [-x] [-v] [trace...]\n"
+            "  -e press   inject a button press this many seconds into the corpus\n"
+            "             (default zone 0)\n"
+            "  -x         exit 1 if a decision differs from the recorded one\n"
+            "  -v         list the first mismatches\n"
+            "  trace      UART capture, tlm2csv output or log export (default stdin)\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    ZoneSet zones;
+    tempq7_t reading[ZONES_MAX];
+    int8_t recordedSetPoint[ZONES_MAX], setPoint[ZONES_MAX];
+    bool strict = false, verbose = false;
+    unsigned long lines = 0, decisions = 0, compared = 0, mismatches = 0;
+    unsigned long recordedSwitches = 0, replayedSwitches = 0;
+    uint64_t recordedOnS = 0, replayedOnS = 0, zoneSeconds = 0;
+    uint32_t lastRecorded = 0, lastReplayed = 0;
+    size_t i, next = 0, files = 0;
+    double parseNs, start, replayNs;
+    int opt;
+    uint8_t z;
+
+    while ((opt = getopt(argc, argv, "e:xvh")) != -1) {
+        switch (opt) {
+        case 'e':
+            if (parsePress(optarg) != 0) {
+                fprintf(stderr, "bad press '%s'\n", optarg);
+                return 2;
+            }
+            break;
+        case 'x':
+            strict = true;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    qsort(presses, numPresses, sizeof(presses[0]), comparePresses);
+
+    start = nowNs();
+    if (optind == argc) {
+        lines = load(stdin);
+        files = 1;
+    }
+    for (; optind < argc; ++optind, ++files) {
+        FILE *in = fopen(argv[optind], "r");
+
+        if (in == NULL) {
+            perror(argv[optind]);
+            return 1;
+        }
+        lines += load(in);
+        fclose(in);
+    }
+    parseNs = nowNs() - start;
+    if (numReports == 0) {
+        fprintf(stderr, "no reports in the trace\n");
+        return 1;
+    }
+
+    // The replay proper: set points, then the sweeps up to each report
+    for (z = 0; z < ZONES_MAX; ++z) {
+        recordedSetPoint[z] = reports[0].setPoint[z];
+    }
+    startZones(&zones, recordedSetPoint);
+    start = nowNs();
+    for (i = 0; i < numReports; ++i) {
+        const Report *r = &reports[i];
+        uint32_t match = 0, fresh = 0;
+        uint64_t ms;
+
+        if (i == 0 || r->uptime < reports[i - 1].uptime) {
+            // A boot: the controllers start over, on the set points the zones had
+            if (i != 0) {
+                memcpy(setPoint, zones.setPoint, sizeof(setPoint));
+                startZones(&zones, setPoint);
+            }
+            ms = 0;
+            fresh = UINT32_MAX;
+        } else {
+            ms = (uint64_t)reports[i - 1].uptime * 1000 + SWEEP_MS;
+        }
+
+        zones.count = r->count;
+        for (z = 0; z < r->count; ++z) {
+            if (r->setPoint[z] != recordedSetPoint[z]) {
+                zonesStepSetPoint(&zones, z, r->setPoint[z] - recordedSetPoint[z]);
+                recordedSetPoint[z] = r->setPoint[z];
+            }
+            reading[z] = r->temperature[z];
+        }
+        for (; next < numPresses && presses[next].time <= r->time; ++next) {
+            zonesStepSetPoint(&zones, presses[next].zone, presses[next].delta);
+        }
+        for (; ms < (uint64_t)r->uptime * 1000; ms += SWEEP_MS) {
+            zonesControl(&zones, reading, fresh & zonesMask(&zones), (uint32_t)ms);
+            decisions += r->count;
+            fresh = 0;
+        }
+        zonesControl(&zones, reading, zonesMask(&zones), (uint32_t)ms);
+        decisions += r->count;
+
+        for (z = 0; z < r->count; ++z) {
+            match |= (uint32_t)(zones.setPoint[z] == r->setPoint[z]) << z;
+        }
+        compared += popcount(match);
+        if ((zones.heatMask ^ r->heatMask) & match) {
+            mismatches += popcount((zones.heatMask ^ r->heatMask) & match);
+            if (verbose && mismatches <= MISMATCHES_SHOWN) {
+                for (z = 0; z < r->count; ++z) {
+                    if (((zones.heatMask ^ r->heatMask) & match) & ZONE_BIT(z)) {
+                        fprintf(stderr, "mismatch at %lu s, zone %u: %.2f degC, set point %d, "
+                                "recorded heat %d, replayed %d\n",
+                                (unsigned long)r->time, z, (double)r->temperature[z] / TEMP_Q7_ONE,
+                                r->setPoint[z], (int)((r->heatMask >> z) & 1),
+                                (int)((zones.heatMask >> z) & 1));
+                    }
+                }
+            }
+        }
+
+        // Each report stands for the time until the next
+        if (i > 0) {
+            uint32_t span = r->time - reports[i - 1].time;
+
+            recordedOnS += (uint64_t)span * popcount(lastRecorded);
+            replayedOnS += (uint64_t)span * popcount(lastReplayed);
+            zoneSeconds += (uint64_t)span * reports[i - 1].count;
+            recordedSwitches += popcount(lastRecorded ^ r->heatMask);
+            replayedSwitches += popcount(lastReplayed ^ zones.heatMask);
+        }
+        lastRecorded = r->heatMask;
+        lastReplayed = zones.heatMask;
+    }
+    replayNs = nowNs() - start;
+
+    printf("corpus       : %lu files, %lu reports (%lu lines), %.1f h of trace, read in %.3f s\n",
+           (unsigned long)files, (unsigned long)numReports, lines,
+           (reports[numReports - 1].time - reports[0].time) / 3600.0, parseNs / 1e9);
+    printf("decisions    : %lu in %.4f s, %.1f M/s, %.1f ns each\n",
+           decisions, replayNs / 1e9, decisions / (replayNs / 1e9) / 1e6, replayNs / decisions);
+    printf("presses      : %lu injected, %lu applied\n",
+           (unsigned long)numPresses, (unsigned long)next);
+    printf("mismatches   : %lu of %lu decisions on the recorded set point\n", mismatches, compared);
+    printf("heat on      : recorded %.1f%%, replayed %.1f%% of zone time\n",
+           zoneSeconds ? 100.0 * recordedOnS / zoneSeconds : 0.0,
+           zoneSeconds ? 100.0 * replayedOnS / zoneSeconds : 0.0);
+    printf("heat switches: recorded %lu, replayed %lu\n", recordedSwitches, replayedSwitches);
+    free(reports);
+    return strict && mismatches ? 1 : 0;
+}
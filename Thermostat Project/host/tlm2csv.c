@@ -0,0 +1,133 @@
+/*
+ *  ======== tlm2csv.c ========
+ *  Converts a binary telemetry stream to CSV.
+ *
+ *      tlm2csv [file]          read the stream from file, /dev/ttyACM0, or stdin
+ *      thermostat_sim -b -s 100 -n 600 | tlm2csv > run.csv
+ *
+ *  One row per valid status record, and one per zone of a zones record;
+ *  the last column is the zone. Task and scheduler statistics records
+ *  are printed to stderr as they arrive, and the decoder counters at the
+ *  end of the stream.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tlmdecode.h"
+
+static void printDegrees(FILE *out, int16_t value)
+{
+    // Exact decimal for 1/128 degC steps
+    int32_t v = value;
+    const char *sign = v < 0 ? "-" : "";
+
+    if (v < 0) {
+        v = -v;
+    }
+    fprintf(out, "%s%ld.%07ld", sign, (long)(v / TLM_TEMP_SCALE),
+            (long)((v % TLM_TEMP_SCALE) * 78125));
+}
+
+static void printRow(FILE *out, uint16_t sequence, uint32_t uptime, int16_t temperature,
+                     int16_t setPoint, bool heatOn, unsigned zone)
+{
+    fprintf(out, "%u,%lu,", sequence, (unsigned long)uptime);
+    printDegrees(out, temperature);
+    fputc(',', out);
+    printDegrees(out, setPoint);
+    fprintf(out, ",%d,%u\n", heatOn ? 1 : 0, zone);
+}
+
+static void onStatus(const TlmStatus *status, void *arg)
+{
+    printRow(arg, status->sequence, status->uptime, status->temperature, status->setPoint,
+             (status->flags & TLM_FLAG_HEAT_ON) != 0, 0);
+}
+
+static void onZones(const TlmZones *zones, void *arg)
+{
+    unsigned z;
+
+    for (z = 0; z < zones->count; ++z) {
+        printRow(arg, zones->sequence, zones->uptime, zones->temperature[z], zones->setPoint[z],
+                 (zones->heatMask >> z) & 1, z);
+    }
+}
+
+static double cyclesToUs(uint32_t cycles)
+{
+    return (double)cycles / TLM_CYCLES_PER_US;
+}
+
+static void onTask(const TlmTask *task, void *arg)
+{
+    (void)arg;
+    fprintf(stderr, "task %u: %lu runs, us min %.1f avg %.1f max %.1f, jitter max %.1f us, "
+            "response max %.1f us, %u late, %u skipped, %u overruns\n",
+            task->task, (unsigned long)task->runs, cyclesToUs(task->minCycles),
+            cyclesToUs(task->avgCycles), cyclesToUs(task->maxCycles),
+            cyclesToUs(task->maxJitter), cyclesToUs(task->maxResponse),
+            task->lateReleases, task->skippedReleases, task->overruns);
+}
+
+static void onSched(const TlmSched *sched, void *arg)
+{
+    (void)arg;
+    fprintf(stderr, "scheduler: %lu passes over %lu ticks, %u overruns, wake latency us "
+            "min %.1f avg %.1f max %.1f, load %u.%u%%\n",
+            (unsigned long)sched->passes, (unsigned long)sched->ticks, sched->overruns,
+            cyclesToUs(sched->minLatency), cyclesToUs(sched->avgLatency),
+            cyclesToUs(sched->maxLatency), sched->loadPermille / 10, sched->loadPermille % 10);
+}
+
+static void onFaults(const TlmFaults *faults, void *arg)
+{
+    (void)arg;
+    fprintf(stderr, "sensor faults: %lu failed transfers, %lu timeouts, %lu bus recoveries, "
+            "%lu fail-safes, zones failing 0x%lx, heat off 0x%lx\n",
+            (unsigned long)faults->failedTransfers, (unsigned long)faults->timeouts,
+            (unsigned long)faults->recoveries, (unsigned long)faults->failSafes,
+            (unsigned long)faults->failing, (unsigned long)faults->heatOff);
+    fprintf(stderr, "sensor readings: %lu spikes, %lu jumps, %lu out of range, %lu stuck, "
+            "zones suspect 0x%lx, heat off 0x%lx\n",
+            (unsigned long)faults->spikes, (unsigned long)faults->jumps,
+            (unsigned long)faults->outOfRange, (unsigned long)faults->stuck,
+            (unsigned long)faults->suspect, (unsigned long)faults->suspectHeatOff);
+}
+
+int main(int argc, char *argv[])
+{
+    TlmDecoder decoder;
+    uint8_t buf[4096];
+    FILE *in = stdin;
+    size_t n;
+
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "-h") == 0)) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        in = fopen(argv[1], "rb");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    tlmDecoderInit(&decoder, onStatus, stdout);
+    decoder.onZones = onZones;
+    decoder.onTask = onTask;
+    decoder.onSched = onSched;
+    decoder.onFaults = onFaults;
+    printf("sequence,uptime_s,temperature_c,set_point_c,heat_on,zone\n");
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        tlmDecoderFeed(&decoder, buf, n);
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "records %lu, bad frames %lu, unknown %lu, lost %lu\n",
+            decoder.records, decoder.badFrames, decoder.unknown, decoder.lost);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ *  ======== tlmdecode.c ========
+ *  Streaming decoder for the binary telemetry frames, see tlmdecode.h.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tlmdecode.h"
+
+void tlmDecoderInit(TlmDecoder *decoder, TlmStatusFxn onStatus, void *arg)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->onStatus = onStatus;
+    decoder->arg = arg;
+}
+
+static void countSequence(TlmDecoder *decoder, uint16_t sequence)
+{
+    if (decoder->haveSequence) {
+        decoder->lost += (uint16_t)(sequence - decoder->lastSequence - 1);
+    }
+    decoder->haveSequence = true;
+    decoder->lastSequence = sequence;
+}
+
+static int decodeStatus(TlmDecoder *decoder, const uint8_t *record, size_t len)
+{
+    TlmStatus status;
+    int rc = tlmUnpackStatus(record, len, &status);
+
+    if (rc != 0) {
+        return rc;
+    }
+    countSequence(decoder, status.sequence);
+    if (decoder->onStatus) {
+        decoder->onStatus(&status, decoder->arg);
+    }
+    return 0;
+}
+
+static int decodeZones(TlmDecoder *decoder, const uint8_t *record, size_t len)
+{
+    TlmZones zones;
+    int rc = tlmUnpackZones(record, len, &zones);
+
+    if (rc != 0) {
+        return rc;
+    }
+    countSequence(decoder, zones.sequence);
+    if (decoder->onZones) {
+        decoder->onZones(&zones, decoder->arg);
+    }
+    return 0;
+}
+
+static int decodeTask(TlmDecoder *decoder, const uint8_t *record, size_t len)
+{
+    TlmTask task;
+    int rc = tlmUnpackTask(record, len, &task);
+
+    if (rc == 0 && decoder->onTask) {
+        decoder->onTask(&task, decoder->arg);
+    }
+    return rc;
+}
+
+static int decodeSched(TlmDecoder *decoder, const uint8_t *record, size_t len)
+{
+    TlmSched sched;
+    int rc = tlmUnpackSched(record, len, &sched);
+
+    if (rc == 0 && decoder->onSched) {
+        decoder->onSched(&sched, decoder->arg);
+    }
+    return rc;
+}
+
+static int decodeFaults(TlmDecoder *decoder, const uint8_t *record, size_t len)
+{
+    TlmFaults faults;
+    int rc = tlmUnpackFaults(record, len, &faults);
+
+    if (rc == 0 && decoder->onFaults) {
+        decoder->onFaults(&faults, decoder->arg);
+    }
+    return rc;
+}
+
+static void endFrame(TlmDecoder *decoder)
+{
+    uint8_t record[TLM_DECODE_MAX];
+    size_t len;
+    int rc;
+
+    if (decoder->len == 0 && !decoder->overflow) {
+        return;     // back-to-back delimiters
+    }
+    len = decoder->overflow ? 0 : tlmCobsDecode(decoder->frame, decoder->len, record);
+    decoder->len = 0;
+    decoder->overflow = false;
+
+    rc = tlmRecordType(record, len);
+    switch (rc) {
+    case TLM_TYPE_STATUS:
+        rc = decodeStatus(decoder, record, len);
+        break;
+    case TLM_TYPE_ZONES:
+        rc = decodeZones(decoder, record, len);
+        break;
+    case TLM_TYPE_TASK:
+        rc = decodeTask(decoder, record, len);
+        break;
+    case TLM_TYPE_SCHED:
+        rc = decodeSched(decoder, record, len);
+        break;
+    case TLM_TYPE_FAULTS:
+        rc = decodeFaults(decoder, record, len);
+        break;
+    default:
+        if (rc >= 0) {
+            rc = -2;
+        }
+        break;
+    }
+
+    if (rc == -1) {
+        decoder->badFrames++;
+    } else if (rc == -2) {
+        decoder->unknown++;
+    } else {
+        decoder->records++;
+    }
+}
+
+void tlmDecoderFeed(TlmDecoder *decoder, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i) {
+        if (data[i] == 0x00) {
+            endFrame(decoder);
+        } else if (decoder->len < sizeof(decoder->frame)) {
+            decoder->frame[decoder->len++] = data[i];
+        } else {
+            decoder->overflow = true;
+        }
+    }
+}
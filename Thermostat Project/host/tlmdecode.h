@@ -0,0 +1,54 @@
+/*
+ *  ======== tlmdecode.h ========
+ *  Streaming decoder for the binary telemetry frames in tlmframe.h.
+ *
+ *  Bytes are fed in any chunking; each 0x00 delimiter ends a frame, which
+ *  is COBS decoded, CRC checked and handed to the callback for its record
+ *  type. Status records are the stream; onZones, onTask, onSched and
+ *  onFaults are optional and may be set after tlmDecoderInit(). Zones records share the
+ *  status sequence numbers. Anything else
+ *  on the line (boot messages, ASCII reports) fails the checks and is
+ *  counted instead of reported.
+ */
+#ifndef TLMDECODE_H_
+#define TLMDECODE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tlmframe.h"
+
+/* Longest frame the decoder buffers before giving up on it */
+#define TLM_DECODE_MAX 256
+
+typedef void (*TlmStatusFxn)(const TlmStatus *status, void *arg);
+typedef void (*TlmZonesFxn)(const TlmZones *zones, void *arg);
+typedef void (*TlmTaskFxn)(const TlmTask *task, void *arg);
+typedef void (*TlmSchedFxn)(const TlmSched *sched, void *arg);
+typedef void (*TlmFaultsFxn)(const TlmFaults *faults, void *arg);
+
+typedef struct {
+    uint8_t         frame[TLM_DECODE_MAX];
+    size_t          len;
+    bool            overflow;       // current frame outgrew the buffer
+    bool            haveSequence;
+    uint16_t        lastSequence;
+
+    TlmStatusFxn    onStatus;
+    TlmZonesFxn     onZones;
+    TlmTaskFxn      onTask;
+    TlmSchedFxn     onSched;
+    TlmFaultsFxn    onFaults;
+    void           *arg;
+
+    unsigned long   records;        // valid records delivered
+    unsigned long   badFrames;      // framing or CRC errors
+    unsigned long   unknown;        // valid CRC, unknown version or type
+    unsigned long   lost;           // status records missing from sequence gaps
+} TlmDecoder;
+
+extern void tlmDecoderInit(TlmDecoder *decoder, TlmStatusFxn onStatus, void *arg);
+extern void tlmDecoderFeed(TlmDecoder *decoder, const uint8_t *data, size_t len);
+
+#endif /* TLMDECODE_H_ */
@@ -34,6 +34,7 @@
 /*
  *  ======== main_nortos.c ========
  */
+#if !defined(THERMOSTAT_RTOS)
 #include <stdint.h>
 #include <stddef.h>
 
@@ -58,3 +59,4 @@ int main(void)
 
     while (1) {}
 }
+#endif /* !THERMOSTAT_RTOS */
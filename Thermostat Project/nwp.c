@@ -0,0 +1,74 @@
+/*
+ *  ======== nwp.c ========
+ *  Network processor power control, see nwp.h.
+ *
+ *  With a thread per task (THERMOSTAT_RTOS) the log and uplink tasks may
+ *  acquire and release at once, so the count and the start and stop it
+ *  decides are taken under a lock.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Driver Header files */
+#include <ti/drivers/net/wifi/simplelink.h>
+#if defined(THERMOSTAT_RTOS)
+#include <ti/drivers/dpl/SemaphoreP.h>
+#endif
+
+#include "nwp.h"
+
+#define NWP_STOP_MS     200     // sl_Stop() grace period for pending work
+
+static NwpStats stats;
+
+#if defined(THERMOSTAT_RTOS)
+static SemaphoreP_Handle lock;
+
+// Created on first use, by histLogInit() before any task thread runs
+static void nwpLock(void)
+{
+    if (lock == NULL) {
+        lock = SemaphoreP_createBinary(1);
+    }
+    SemaphoreP_pend(lock, SemaphoreP_WAIT_FOREVER);
+}
+
+static void nwpUnlock(void)
+{
+    SemaphoreP_post(lock);
+}
+#else
+static void nwpLock(void) {}
+static void nwpUnlock(void) {}
+#endif
+
+bool nwpAcquire(void)
+{
+    nwpLock();
+    if (stats.users == 0) {
+        if (sl_Start(NULL, NULL, NULL) < 0) {
+            stats.startErrors++;
+            nwpUnlock();
+            return false;
+        }
+        stats.starts++;
+    }
+    stats.users++;
+    nwpUnlock();
+    return true;
+}
+
+void nwpRelease(void)
+{
+    nwpLock();
+    if (stats.users > 0 && --stats.users == 0) {
+        sl_Stop(NWP_STOP_MS);
+    }
+    nwpUnlock();
+}
+
+void nwpGetStats(NwpStats *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,29 @@
+/*
+ *  ======== nwp.h ========
+ *  Shared power control of the SimpleLink network processor.
+ *
+ *  The NWP owns both the serial flash and the radio, and it is by far the
+ *  largest power draw on the board, so it runs only while some module
+ *  needs it. Users bracket their work with nwpAcquire() and nwpRelease();
+ *  the first acquire starts it and the last release stops it. Task level
+ *  only, from any number of task threads.
+ */
+#ifndef NWP_H_
+#define NWP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t starts;        // sl_Start() calls that succeeded
+    uint32_t startErrors;
+    uint8_t  users;         // current holders
+} NwpStats;
+
+/* Returns false, and holds nothing, if the NWP would not start */
+extern bool nwpAcquire(void);
+extern void nwpRelease(void);
+
+extern void nwpGetStats(NwpStats *out);
+
+#endif /* NWP_H_ */
@@ -0,0 +1,126 @@
+/*
+ *  ======== samplerate.c ========
+ *  Adaptive sensor sampling, see samplerate.h.
+ *
+ *  Temperatures are Q15 degC as in heatctl.c; every product stays within
+ *  32 bits, so a reading costs a handful of multiplies and one divide.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "samplerate.h"
+#include "tempq7.h"
+#include "zones.h"
+
+#define SLOPE_MAX   ((int32_t)1 << 15)      // 1 degC per s, Q15
+#define ERROR_MAX   ((int32_t)1 << 20)      // 32 degC, Q15
+#define DT_MAX_MS   30000                   // the longest gap the estimator takes
+#define LEVEL_SHIFT 1                       // level gain 1/2
+#define SLOPE_SHIFT 4                       // slope gain 1/16
+
+#define Q15(q7)     ((int32_t)(q7) << 8)
+
+static int32_t clamp(int32_t v, int32_t limit)
+{
+    return v > limit ? limit : v < -limit ? -limit : v;
+}
+
+void sampleRateInit(SampleRate *rate, uint32_t cycleMs)
+{
+    uint8_t z;
+
+    memset(rate, 0, sizeof(*rate));
+    rate->cycleMs = cycleMs;
+    for (z = 0; z < ZONES_MAX; ++z) {
+        rate->interval[z] = 1;
+    }
+}
+
+uint32_t sampleRateDue(const SampleRate *rate, uint32_t zones, uint32_t nowMs)
+{
+    uint32_t due = 0;
+    uint8_t z;
+
+    for (z = 0; z < ZONES_MAX; ++z) {
+        if ((zones & ZONE_BIT(z)) && (int32_t)(nowMs - rate->dueMs[z]) >= 0) {
+            due |= ZONE_BIT(z);
+        }
+    }
+    return due;
+}
+
+/* A new reading: the estimator's error, then the next interval */
+static void reading(SampleRate *rate, uint8_t z, tempq7_t temperature, int32_t setPoint, uint32_t nowMs)
+{
+    int32_t x = Q15(temperature), predicted, error, slope, distance;
+    uint32_t dt, perCycle;
+    uint8_t interval = rate->interval[z];
+
+    if (!(rate->seeded & ZONE_BIT(z))) {
+        rate->level[z] = x;
+        rate->slope[z] = 0;
+        rate->seeded |= ZONE_BIT(z);
+        error = 0;
+    } else {
+        dt = nowMs - rate->lastMs[z];
+        dt = dt == 0 ? 1 : dt > DT_MAX_MS ? DT_MAX_MS : dt;
+        predicted = rate->level[z] + rate->slope[z] * (int32_t)dt / 1000;
+        error = clamp(x - predicted, ERROR_MAX);
+        rate->level[z] = predicted + (error >> LEVEL_SHIFT);
+        rate->slope[z] = clamp(rate->slope[z] + (error >> SLOPE_SHIFT) * 1000 / (int32_t)dt, SLOPE_MAX);
+    }
+    rate->lastMs[z] = nowMs;
+
+    // Back off unless surprised, then as far as the slope allows
+    if (error > Q15(SAMPLE_SURPRISE) || error < -Q15(SAMPLE_SURPRISE)) {
+        interval = 1;
+    } else if (interval < SAMPLE_INTERVAL_MAX) {
+        interval = interval * 2 > SAMPLE_INTERVAL_MAX ? SAMPLE_INTERVAL_MAX : interval * 2;
+    }
+    slope = rate->slope[z];
+    perCycle = (uint32_t)(slope < 0 ? -slope : slope) * (rate->cycleMs / 100) / 10;
+    while (interval > 1 && perCycle * interval > (uint32_t)Q15(SAMPLE_DRIFT_MAX)) {
+        interval >>= 1;
+    }
+    distance = setPoint - rate->level[z];
+    if ((distance > Q15(SAMPLE_DRIFT_MAX) && slope > 0) || (distance < -Q15(SAMPLE_DRIFT_MAX) && slope < 0)) {
+        distance = distance < 0 ? -distance : distance;
+        while (interval > 1 && perCycle * interval > (uint32_t)distance) {
+            interval >>= 1;
+        }
+    }
+    rate->interval[z] = interval;
+    rate->dueMs[z] = nowMs + (interval - 1) * rate->cycleMs;
+}
+
+void sampleRateUpdate(SampleRate *rate, const ZoneSet *zones, uint32_t fresh, uint32_t nowMs)
+{
+    uint32_t changed = zones->heatMask ^ rate->heatMask;
+    int32_t soonest = INT32_MAX, wait;
+    uint8_t z;
+
+    rate->heatMask = zones->heatMask;
+    for (z = 0; z < zones->count; ++z) {
+        if (zones->setPoint[z] != rate->setPoint[z]) {
+            rate->setPoint[z] = zones->setPoint[z];
+            changed |= ZONE_BIT(z);
+        }
+        if (fresh & ZONE_BIT(z)) {
+            reading(rate, z, zones->temperature[z], Q15(TEMP_Q7(zones->setPoint[z])), nowMs);
+        }
+        if (changed & ZONE_BIT(z)) {
+            rate->interval[z] = 1;
+            rate->dueMs[z] = nowMs;
+        }
+        wait = (int32_t)(rate->dueMs[z] - nowMs);
+        if (wait < 0) {
+            rate->dueMs[z] = nowMs;     // still due, and the clock may wrap
+            wait = 0;
+        }
+        if (wait < soonest) {
+            soonest = wait;
+        }
+    }
+    rate->soonestMs = nowMs + (uint32_t)(zones->count != 0 ? soonest : 0);
+}
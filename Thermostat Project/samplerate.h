@@ -0,0 +1,75 @@
+/*
+ *  ======== samplerate.h ========
+ *  Adaptive sensor sampling: each zone is read only as often as its
+ *  temperature is moving.
+ *
+ *  The unit is the conversion cycle of sensorfault.h, a start sweep and a
+ *  read sweep. A zone sits out all but one of every interval cycles, 1 up
+ *  to SAMPLE_INTERVAL_MAX. A streaming estimator follows each zone's level
+ *  and slope (a two-state exponential filter, O(1) a reading). After each
+ *  reading the interval doubles, then halves until the slope drifts less
+ *  than SAMPLE_DRIFT_MAX in one interval and, heading for the set point,
+ *  does not cross it. A reading further than SAMPLE_SURPRISE from the
+ *  estimator's prediction, a set point change or a heat output switching
+ *  puts the zone back to every cycle.
+ *
+ *  A zone without a new reading stays due, so a failing sensor is tried
+ *  every cycle as sensorfault.h expects. While no zone is due the start
+ *  sweep has nothing to do; the scheduler leaves the sensor task's
+ *  releases out of its wakeups until one is.
+ *
+ *  Plain C with no driver dependencies; gpiointerrupt.c feeds it from the
+ *  heat task and fleet.c from its rooms.
+ */
+#ifndef SAMPLERATE_H_
+#define SAMPLERATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+#include "zones.h"
+
+#ifndef SAMPLE_INTERVAL_MAX
+#define SAMPLE_INTERVAL_MAX 16                  // cycles between readings, at most
+#endif
+#define SAMPLE_DRIFT_MAX    (TEMP_Q7_ONE / 16)  // the most a zone may move between readings
+#define SAMPLE_SURPRISE     (TEMP_Q7_ONE / 8)   // a reading this far off the prediction
+
+#if SAMPLE_INTERVAL_MAX < 1 || SAMPLE_INTERVAL_MAX > 128
+#error "SAMPLE_INTERVAL_MAX must be 1..128 cycles"
+#endif
+
+typedef struct {
+    int32_t     level[ZONES_MAX];       // estimated temperature, Q15 degC
+    int32_t     slope[ZONES_MAX];       // ... and its slope, Q15 degC per s
+    uint32_t    lastMs[ZONES_MAX];      // clock at the last reading
+    uint32_t    dueMs[ZONES_MAX];       // the zone takes part in cycles from then
+    uint32_t    soonestMs;              // earliest dueMs of the zones in use
+    uint32_t    cycleMs;                // a conversion cycle, whole timer ticks
+    uint32_t    seeded;                 // zones with a reading in the estimator
+    uint32_t    heatMask;               // outputs at the last update
+    int8_t      setPoint[ZONES_MAX];    // set points at the last update
+    uint8_t     interval[ZONES_MAX];    // cycles between readings
+} SampleRate;
+
+/* Every zone due now, every cycle; cycleMs at most 65 s */
+extern void sampleRateInit(SampleRate *rate, uint32_t cycleMs);
+
+/* Start sweep at nowMs: which of zones take part in this cycle */
+extern uint32_t sampleRateDue(const SampleRate *rate, uint32_t zones, uint32_t nowMs);
+
+/*
+ * After each control sweep at nowMs, on the same clock: the zones with a
+ * new reading in zones->temperature (fresh) update their estimators and
+ * intervals; set point and heat changes take effect.
+ */
+extern void sampleRateUpdate(SampleRate *rate, const ZoneSet *zones, uint32_t fresh, uint32_t nowMs);
+
+/* No zone is due at nowMs: a start sweep then would have nothing to do */
+static inline bool sampleRateResting(const SampleRate *rate, uint32_t nowMs)
+{
+    return (int32_t)(nowMs - rate->soonestMs) < 0;
+}
+
+#endif /* SAMPLERATE_H_ */
@@ -0,0 +1,128 @@
+/*
+ *  ======== sensorfault.c ========
+ *  Sensor fault handling, see sensorfault.h.
+ *
+ *  Called from the sensor and heat tasks only.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sensorfault.h"
+#include "zones.h"
+
+static uint8_t failures[ZONES_MAX];     // failed cycles in a row
+static uint8_t backoff[ZONES_MAX];      // cycles left to sit out
+static uint8_t failedSweeps;            // sweeps in a row with nothing but failures
+static uint8_t recoverWait;             // sweeps before another recovery may run
+static uint8_t recoverRun;              // recoveries since a transfer last succeeded
+static SensorFaultStats stats;
+
+void sensorFaultInit(void)
+{
+    memset(failures, 0, sizeof(failures));
+    memset(backoff, 0, sizeof(backoff));
+    failedSweeps = recoverWait = recoverRun = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t sensorFaultCycle(uint32_t zones)
+{
+    uint32_t due = 0;
+    uint8_t z;
+
+    for (z = 0; z < ZONES_MAX; ++z) {
+        if (!(zones & ZONE_BIT(z))) {
+            continue;
+        }
+        if (backoff[z] != 0) {
+            --backoff[z];
+        } else {
+            due |= ZONE_BIT(z);
+        }
+    }
+    return due;
+}
+
+void sensorFaultCycleEnd(uint32_t tried, uint32_t good, SensorFaultChange *change)
+{
+    uint8_t z, n;
+
+    memset(change, 0, sizeof(*change));
+    for (z = 0; z < ZONES_MAX; ++z) {
+        if (!(tried & ZONE_BIT(z))) {
+            continue;
+        }
+        if (good & ZONE_BIT(z)) {
+            if (failures[z] != 0) {
+                change->restored |= ZONE_BIT(z);
+            }
+            failures[z] = 0;
+            continue;
+        }
+        n = failures[z] < UINT8_MAX ? ++failures[z] : failures[z];
+        if (n == 1) {
+            change->failing |= ZONE_BIT(z);
+        }
+        if (n == SENSOR_FAILSAFE_FAILURES) {
+            change->heatOff |= ZONE_BIT(z);
+            ++stats.failSafes;
+        }
+        // 0, 1, 3, 7 ... cycles out
+        backoff[z] = n > 4 ? SENSOR_BACKOFF_MAX : (uint8_t)((1u << (n - 1)) - 1);
+    }
+    stats.failing = (stats.failing | change->failing) & ~change->restored;
+    stats.heatOff = (stats.heatOff | change->heatOff) & ~change->restored;
+}
+
+void sensorFaultSweep(uint32_t queued, uint32_t failed, bool stuck)
+{
+    uint8_t z;
+
+    for (z = 0; z < ZONES_MAX; ++z) {
+        stats.failedTransfers += (failed >> z) & 1;
+    }
+    if (stuck) {
+        ++stats.timeouts;
+    }
+    if (recoverWait != 0) {
+        --recoverWait;
+    }
+    if (queued == 0) {
+        return;     // nothing learned about the bus
+    }
+    if (stuck || failed == queued) {
+        if (failedSweeps < UINT8_MAX) {
+            ++failedSweeps;
+        }
+    } else {
+        failedSweeps = 0;
+        recoverRun = 0;
+    }
+}
+
+bool sensorFaultRecoveryDue(void)
+{
+    return failedSweeps >= SENSOR_RECOVER_SWEEPS && recoverWait == 0;
+}
+
+void sensorFaultRecovered(void)
+{
+    ++stats.recoveries;
+    failedSweeps = 0;
+    // 2, 4, 8 ... sweeps before the next one, if this one did not help
+    recoverWait = recoverRun >= 5 ? SENSOR_RECOVER_WAIT_MAX : (uint8_t)(2u << recoverRun);
+    if (recoverRun < UINT8_MAX) {
+        ++recoverRun;
+    }
+}
+
+uint32_t sensorFaultHeatOff(void)
+{
+    return stats.heatOff;
+}
+
+void sensorFaultGetStats(SensorFaultStats *out)
+{
+    *out = stats;
+}
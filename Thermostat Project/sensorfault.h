@@ -0,0 +1,70 @@
+/*
+ *  ======== sensorfault.h ========
+ *  Sensor fault handling: retries with backoff, bus recovery and a
+ *  fail-safe heat off.
+ *
+ *  The unit of work is a conversion cycle, the start sweep and the read
+ *  sweep of startTempRead; a zone whose cycle ends without a new reading
+ *  has failed it. A failing zone sits out 0, 1, 3, 7 ... cycles before
+ *  each retry, up to SENSOR_BACKOFF_MAX, so a glitch costs one reading
+ *  and a dead sensor one transfer every several seconds. After
+ *  SENSOR_FAILSAFE_FAILURES failed cycles in a row the zone's heat is held
+ *  off until it reads again, rather than acting on its last reading.
+ *
+ *  Retries cannot free a bus that a sensor holds: one reset in the middle
+ *  of a byte keeps SDA low for good. When every transfer of
+ *  SENSOR_RECOVER_SWEEPS sweeps in a row fails, or one hangs, the caller
+ *  is asked to recover the bus (clock SCL until SDA is released, send a
+ *  STOP and reopen the controller). Recoveries that do not help back off
+ *  the same way, up to SENSOR_RECOVER_WAIT_MAX sweeps apart.
+ *
+ *  Plain C with no driver dependencies; gpiointerrupt.c does the transfers.
+ */
+#ifndef SENSORFAULT_H_
+#define SENSORFAULT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SENSOR_BACKOFF_MAX          15  // cycles a failing zone sits out, at most
+#define SENSOR_FAILSAFE_FAILURES    3   // failed cycles in a row before its heat is held off
+#define SENSOR_RECOVER_SWEEPS       2   // sweeps in a row with every transfer failed
+#define SENSOR_RECOVER_WAIT_MAX     64  // sweeps between recoveries, at most
+
+typedef struct {
+    uint32_t failedTransfers;
+    uint32_t timeouts;      // transfers still running a tick later, cancelled
+    uint32_t recoveries;    // bus recoveries run
+    uint32_t failSafes;     // times a zone's heat was held off
+    uint32_t failing;       // zones in a failure run now, bit per zone
+    uint32_t heatOff;       // ... and of those, the ones held off
+} SensorFaultStats;
+
+/* What a cycle changed, bit per zone, for the messages */
+typedef struct {
+    uint32_t failing;       // started failing
+    uint32_t heatOff;       // held off from now on
+    uint32_t restored;      // read again after failing
+} SensorFaultChange;
+
+extern void sensorFaultInit(void);
+
+/* Start sweep: which of zones take part in this cycle; the rest count down */
+extern uint32_t sensorFaultCycle(uint32_t zones);
+
+/* End of a cycle: the zones that took part and the ones with a new reading */
+extern void sensorFaultCycleEnd(uint32_t tried, uint32_t good, SensorFaultChange *change);
+
+/* End of each sweep: the zones queued, the ones that failed, and whether one hung */
+extern void sensorFaultSweep(uint32_t queued, uint32_t failed, bool stuck);
+
+/* The bus needs recovering before the next sweep; report it done */
+extern bool sensorFaultRecoveryDue(void);
+extern void sensorFaultRecovered(void);
+
+/* Zones whose heat is held off */
+extern uint32_t sensorFaultHeatOff(void);
+
+extern void sensorFaultGetStats(SensorFaultStats *out);
+
+#endif /* SENSORFAULT_H_ */
@@ -0,0 +1,174 @@
+/*
+ *  ======== sensorhealth.c ========
+ *  Sensor health checks, see sensorhealth.h.
+ *
+ *  Called from the sensor task only (readTemps), and from initI2C before
+ *  the scheduler starts.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sensorhealth.h"
+#include "tempq7.h"
+#include "zones.h"
+
+#define JUMP_DT_MAX_MS  600000      // the slew allowed stops growing here, 60 degC at the default
+#define FILLING         (-1)        // the window is not full yet: neither used nor rejected
+
+static tempq7_t window[ZONES_MAX][SENSOR_HEALTH_WINDOW];   // readings in range, oldest first
+static tempq7_t accepted[ZONES_MAX];    // the last reading accepted...
+static uint32_t acceptedMs[ZONES_MAX];  // ... and when
+static uint32_t lastMs[ZONES_MAX];      // the last reading in range
+static uint32_t heatedMs[ZONES_MAX];    // heat on time with the code unchanged
+static uint32_t idleMs[ZONES_MAX];      // ... and heat off time
+static uint8_t rejected[ZONES_MAX];     // readings rejected in a row
+static uint8_t filled[ZONES_MAX];       // readings in window, up to SENSOR_HEALTH_WINDOW
+static uint32_t anchored;               // zones with a reading in accepted
+static uint32_t stuck;                  // zones found stuck, until the code moves
+static SensorHealthStats stats;
+
+void sensorHealthInit(void)
+{
+    memset(rejected, 0, sizeof(rejected));
+    memset(filled, 0, sizeof(filled));
+    anchored = stuck = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+static tempq7_t median(const tempq7_t in[SENSOR_HEALTH_WINDOW])
+{
+    tempq7_t v[SENSOR_HEALTH_WINDOW], t;
+    int i, j;
+
+    // Insertion sort; five elements are ten compares at most
+    for (i = 0; i < SENSOR_HEALTH_WINDOW; ++i) {
+        t = in[i];
+        for (j = i; j > 0 && v[j - 1] > t; --j) {
+            v[j] = v[j - 1];
+        }
+        v[j] = t;
+    }
+    return v[SENSOR_HEALTH_WINDOW / 2];
+}
+
+static int check(uint8_t z, tempq7_t x, bool heating, uint32_t nowMs)
+{
+    int32_t off;
+    uint32_t dt;
+    tempq7_t m;
+
+    if (x < TEMP_Q7(SENSOR_HEALTH_MIN_C) || x > TEMP_Q7(SENSOR_HEALTH_MAX_C)) {
+        return SENSOR_HEALTH_RANGE;
+    }
+    // Nothing to check the first readings against: they only fill the
+    // window, and the one that completes it is checked against the lot
+    if (filled[z] == 0) {
+        window[z][filled[z]++] = x;
+        lastMs[z] = nowMs;
+        heatedMs[z] = idleMs[z] = 0;
+        return FILLING;
+    }
+
+    // A code that does not move while the heat is on, or for far longer
+    // with it off
+    if (x != window[z][filled[z] - 1]) {
+        heatedMs[z] = idleMs[z] = 0;
+        stuck &= ~ZONE_BIT(z);
+    } else if (heating && heatedMs[z] < SENSOR_HEALTH_STUCK_MS) {
+        heatedMs[z] += nowMs - lastMs[z];
+    } else if (!heating && idleMs[z] < SENSOR_HEALTH_IDLE_STUCK_MS) {
+        idleMs[z] += nowMs - lastMs[z];
+    }
+    lastMs[z] = nowMs;
+    if (filled[z] < SENSOR_HEALTH_WINDOW) {
+        window[z][filled[z]++] = x;
+        if (filled[z] < SENSOR_HEALTH_WINDOW) {
+            return FILLING;
+        }
+    } else {
+        memmove(&window[z][0], &window[z][1], (SENSOR_HEALTH_WINDOW - 1) * sizeof(window[z][0]));
+        window[z][SENSOR_HEALTH_WINDOW - 1] = x;
+    }
+    if (heatedMs[z] >= SENSOR_HEALTH_STUCK_MS || idleMs[z] >= SENSOR_HEALTH_IDLE_STUCK_MS) {
+        if (!(stuck & ZONE_BIT(z))) {
+            stuck |= ZONE_BIT(z);
+            ++stats.stuck;
+        }
+        return SENSOR_HEALTH_STUCK;
+    }
+
+    m = median(window[z]);
+    off = x - m;
+    if (off > SENSOR_HEALTH_SPREAD || off < -SENSOR_HEALTH_SPREAD) {
+        return SENSOR_HEALTH_SPIKE;
+    }
+
+    // No faster than the room can move since the last one accepted; the
+    // first is measured from the median of the window it completed
+    if (!(anchored & ZONE_BIT(z))) {
+        anchored |= ZONE_BIT(z);
+        accepted[z] = m;
+        acceptedMs[z] = nowMs;
+    }
+    dt = nowMs - acceptedMs[z];
+    dt = dt > JUMP_DT_MAX_MS ? JUMP_DT_MAX_MS : dt;
+    off = x - accepted[z];
+    if ((uint32_t)(off < 0 ? -off : off) > SENSOR_HEALTH_SPREAD + dt * TEMP_Q7_ONE / SENSOR_HEALTH_MS_PER_C) {
+        return SENSOR_HEALTH_JUMP;
+    }
+    accepted[z] = x;
+    acceptedMs[z] = nowMs;
+    return SENSOR_HEALTH_OK;
+}
+
+uint32_t sensorHealthSweep(uint32_t fresh, const tempq7_t reading[], uint32_t heating,
+                           uint32_t nowMs, SensorHealthChange *change)
+{
+    uint32_t good = 0;
+    uint8_t z, n;
+    int verdict;
+
+    memset(change, 0, sizeof(*change));
+    for (z = 0; z < ZONES_MAX; ++z) {
+        if (!(fresh & ZONE_BIT(z))) {
+            continue;
+        }
+        verdict = check(z, reading[z], (heating & ZONE_BIT(z)) != 0, nowMs);
+        if (verdict == FILLING) {
+            continue;
+        }
+        if (verdict == SENSOR_HEALTH_OK) {
+            if (rejected[z] != 0) {
+                change->restored |= ZONE_BIT(z);
+            }
+            rejected[z] = 0;
+            good |= ZONE_BIT(z);
+            continue;
+        }
+        stats.spikes += verdict == SENSOR_HEALTH_SPIKE;
+        stats.jumps += verdict == SENSOR_HEALTH_JUMP;
+        stats.outOfRange += verdict == SENSOR_HEALTH_RANGE;
+        n = rejected[z] < UINT8_MAX ? ++rejected[z] : rejected[z];
+        if (n == 1) {
+            change->suspect |= ZONE_BIT(z);
+            change->verdict[z] = (uint8_t)verdict;
+        }
+        if (n == SENSOR_HEALTH_FAILSAFE) {
+            change->heatOff |= ZONE_BIT(z);
+        }
+    }
+    stats.suspect = (stats.suspect | change->suspect) & ~change->restored;
+    stats.heatOff = (stats.heatOff | change->heatOff) & ~change->restored;
+    return good;
+}
+
+uint32_t sensorHealthHeatOff(void)
+{
+    return stats.heatOff;
+}
+
+void sensorHealthGetStats(SensorHealthStats *out)
+{
+    *out = stats;
+}
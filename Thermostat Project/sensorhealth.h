@@ -0,0 +1,118 @@
+/*
+ *  ======== sensorhealth.h ========
+ *  Sensor health: readings that a working sensor could not have returned
+ *  are kept from the heat control.
+ *
+ *  A transfer that succeeds says nothing about the value: a sensor that
+ *  is stuck, glitched or answering for a part that is gone still acks.
+ *  Each new reading of a zone goes through these checks, in order:
+ *
+ *      range   outside SENSOR_HEALTH_MIN_C..SENSOR_HEALTH_MAX_C
+ *      stuck   the same code as the last reading, after the zone's heat
+ *              has been on for SENSOR_HEALTH_STUCK_MS since it last
+ *              changed, or off for SENSOR_HEALTH_IDLE_STUCK_MS; rejected
+ *              until the code moves
+ *      spike   further than SENSOR_HEALTH_SPREAD from the median of the
+ *              last SENSOR_HEALTH_WINDOW readings in range, itself
+ *              included: one or two glitches, where a real step is taken
+ *              once it holds for most of the window
+ *      jump    further from the last accepted reading than the room can
+ *              move in the time since, 1 degC every SENSOR_HEALTH_MS_PER_C
+ *              plus SENSOR_HEALTH_SPREAD
+ *
+ *  A zone's first SENSOR_HEALTH_WINDOW - 1 readings in range only fill its
+ *  window, neither used nor rejected; the one that completes it goes
+ *  through the checks above, the jump measured from the median of the
+ *  window. A glitch in the first reading after reset is outvoted, not
+ *  taken as the value every later one is judged by.
+ *
+ *  A rejected reading is not used: the zone keeps its last one and, with
+ *  samplerate.h, is read again the next cycle. After
+ *  SENSOR_HEALTH_FAILSAFE rejected in a row the zone's heat is held off
+ *  until a reading is accepted, as sensorfault.h does for a sensor that
+ *  does not answer. A reading costs a few compares, a multiply and a
+ *  five-element median, O(1).
+ *
+ *  Plain C with no driver dependencies; readTemps in gpiointerrupt.c runs
+ *  it between the sensor task's reads and adjustHeat.
+ */
+#ifndef SENSORHEALTH_H_
+#define SENSORHEALTH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+#include "zones.h"
+
+#ifndef SENSOR_HEALTH_MIN_C
+#define SENSOR_HEALTH_MIN_C     (-20)       // degC, the coldest a room reading may be
+#endif
+#ifndef SENSOR_HEALTH_MAX_C
+#define SENSOR_HEALTH_MAX_C     60          // ... and the hottest
+#endif
+#ifndef SENSOR_HEALTH_MS_PER_C
+#define SENSOR_HEALTH_MS_PER_C  10000       // fastest a room moves: 1 degC in this
+#endif
+#ifndef SENSOR_HEALTH_STUCK_MS
+#define SENSOR_HEALTH_STUCK_MS  1800000     // heat on without the code moving
+#endif
+#ifndef SENSOR_HEALTH_IDLE_STUCK_MS
+#define SENSOR_HEALTH_IDLE_STUCK_MS 43200000    // ... and heat off, a room that drifts slowly
+#endif
+#define SENSOR_HEALTH_SPREAD    (TEMP_Q7_ONE / 2)   // off the median, or on top of the slew
+#define SENSOR_HEALTH_WINDOW    5           // readings the median is taken over
+#define SENSOR_HEALTH_FAILSAFE  3           // rejected in a row before the heat is held off
+
+#if SENSOR_HEALTH_MIN_C >= SENSOR_HEALTH_MAX_C || SENSOR_HEALTH_MIN_C < -255 || SENSOR_HEALTH_MAX_C > 255
+#error "SENSOR_HEALTH_MIN_C..SENSOR_HEALTH_MAX_C must be a range of Q7 degC"
+#endif
+#if SENSOR_HEALTH_IDLE_STUCK_MS < SENSOR_HEALTH_STUCK_MS || SENSOR_HEALTH_IDLE_STUCK_MS > 2147483647
+#error "SENSOR_HEALTH_IDLE_STUCK_MS must be SENSOR_HEALTH_STUCK_MS..2^31 - 1 ms"
+#endif
+#if SENSOR_HEALTH_MS_PER_C < 1
+#error "SENSOR_HEALTH_MS_PER_C must be at least 1 ms"
+#endif
+
+/* Why a reading was rejected */
+enum SENSOR_HEALTH_VERDICTS {
+    SENSOR_HEALTH_OK,
+    SENSOR_HEALTH_RANGE,
+    SENSOR_HEALTH_STUCK,
+    SENSOR_HEALTH_SPIKE,
+    SENSOR_HEALTH_JUMP
+};
+
+typedef struct {
+    uint32_t spikes;        // readings rejected as spikes
+    uint32_t jumps;         // ... as faster than the room moves
+    uint32_t outOfRange;    // ... as out of range
+    uint32_t stuck;         // times a zone's code was found stuck
+    uint32_t suspect;       // zones whose last reading was rejected, bit per zone
+    uint32_t heatOff;       // ... and of those, the ones held off
+} SensorHealthStats;
+
+/* What a sweep changed, bit per zone, for the messages */
+typedef struct {
+    uint32_t suspect;       // started rejecting readings
+    uint32_t heatOff;       // held off from now on
+    uint32_t restored;      // a reading accepted again
+    uint8_t  verdict[ZONES_MAX];    // for the zones in suspect
+} SensorHealthChange;
+
+extern void sensorHealthInit(void);
+
+/*
+ * The zones in fresh have a new reading in reading[] at nowMs, on a
+ * free-running ms clock; heating has the zones whose heat was on until
+ * now. Returns the zones whose readings may be used.
+ */
+extern uint32_t sensorHealthSweep(uint32_t fresh, const tempq7_t reading[], uint32_t heating,
+                                  uint32_t nowMs, SensorHealthChange *change);
+
+/* Zones whose heat is held off */
+extern uint32_t sensorHealthHeatOff(void);
+
+extern void sensorHealthGetStats(SensorHealthStats *out);
+
+#endif /* SENSORHEALTH_H_ */
@@ -0,0 +1,173 @@
+/*
+ *  ======== taskstats.c ========
+ *  Scheduler and task run-time statistics, see taskstats.h.
+ *
+ *  The wake and release stamps are written at interrupt level, a task's
+ *  figures by the thread that runs it and the rest by the scheduler.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cyclecount.h"
+#include "taskstats.h"
+
+static TaskStats tasks[TASKSTATS_MAX];
+static SchedStats sched;
+static uint32_t tickCycles;
+static volatile uint32_t wakeStamp;     // cycle count when the wakeup was raised
+static uint32_t passStamp;              // wake stamp of the current pass
+static volatile uint32_t releaseStamp[TASKSTATS_MAX];  // first release not yet started
+static volatile uint8_t released[TASKSTATS_MAX];       // ... is stamped
+static uint32_t runRelease[TASKSTATS_MAX];      // release of the run in progress
+static bool runReleased[TASKSTATS_MAX];         // ... is known: not the boot run
+
+void taskStatsInit(uint32_t cyclesPerTick)
+{
+    unsigned char i;
+
+    cycleCountInit();
+    memset(tasks, 0, sizeof(tasks));
+    memset(&sched, 0, sizeof(sched));
+    for (i = 0; i < TASKSTATS_MAX; ++i) {
+        tasks[i].minCycles = UINT32_MAX;
+    }
+    sched.minLatency = UINT32_MAX;
+    memset((void *)released, 0, sizeof(released));
+    tickCycles = cyclesPerTick;
+    wakeStamp = passStamp = cycleCount();
+}
+
+void taskStatsWake(void)
+{
+    wakeStamp = cycleCount();
+}
+
+void taskStatsRelease(uint32_t mask)
+{
+    uint32_t now = cycleCount();
+    unsigned char i;
+
+    for (i = 0; i < TASKSTATS_MAX && mask != 0; ++i, mask >>= 1) {
+        if ((mask & 1) && !released[i]) {
+            releaseStamp[i] = now;
+            released[i] = 1;
+        }
+    }
+}
+
+void taskStatsPass(unsigned long ticks)
+{
+    uint32_t latency;
+
+    passStamp = wakeStamp;
+    latency = cycleCount() - passStamp;
+    sched.passes++;
+    sched.ticks += (uint32_t)ticks;
+    sched.totalLatency += latency;
+    if (latency < sched.minLatency) {
+        sched.minLatency = latency;
+    }
+    if (latency > sched.maxLatency) {
+        sched.maxLatency = latency;
+    }
+}
+
+void taskStatsTick(void)
+{
+    sched.ticks++;
+}
+
+uint32_t taskStatsTaskStart(unsigned char task)
+{
+    if (task < TASKSTATS_MAX) {
+        // Cleared first: a release from here on is the next run's
+        runReleased[task] = released[task];
+        released[task] = 0;
+        runRelease[task] = releaseStamp[task];
+    }
+    return cycleCount();
+}
+
+void taskStatsTaskEnd(unsigned char task, uint32_t start,
+                      unsigned long lateTicks, bool overrun)
+{
+    uint32_t end = cycleCount();
+    uint32_t cycles = end - start;
+    TaskStats *s;
+
+    if (task >= TASKSTATS_MAX) {
+        return;
+    }
+    s = &tasks[task];
+    s->runs++;
+    s->totalCycles += cycles;
+    if (cycles < s->minCycles) {
+        s->minCycles = cycles;
+    }
+    if (cycles > s->maxCycles) {
+        s->maxCycles = cycles;
+    }
+    if (lateTicks != 0) {
+        s->lateReleases++;
+    }
+    // The boot run and the extra runs of a catch-up were released by nothing
+    if (runReleased[task]) {
+        if (lateTicks == 0 && start - runRelease[task] > s->maxJitter) {
+            s->maxJitter = start - runRelease[task];
+        }
+        if (end - runRelease[task] > s->maxResponse) {
+            s->maxResponse = end - runRelease[task];
+        }
+        runReleased[task] = false;
+    }
+    if (overrun) {
+        s->overruns++;
+    }
+}
+
+void taskStatsSkipped(unsigned char task, unsigned int releases)
+{
+    if (task < TASKSTATS_MAX) {
+        tasks[task].skippedReleases += releases;
+    }
+}
+
+void taskStatsPassOverrun(void)
+{
+    sched.overruns++;
+}
+
+void taskStatsGet(unsigned char task, TaskStats *out)
+{
+    if (task < TASKSTATS_MAX) {
+        *out = tasks[task];
+    } else {
+        memset(out, 0, sizeof(*out));
+    }
+}
+
+// Summed when asked, so no two threads add to one total
+static uint64_t busyCycles(void)
+{
+    uint64_t busy = 0;
+    unsigned char i;
+
+    for (i = 0; i < TASKSTATS_MAX; ++i) {
+        busy += tasks[i].totalCycles;
+    }
+    return busy;
+}
+
+void taskStatsGetSched(SchedStats *out)
+{
+    *out = sched;
+    out->busyCycles = busyCycles();
+}
+
+uint32_t taskStatsLoadPermille(void)
+{
+    uint64_t elapsed = (uint64_t)sched.ticks * tickCycles;
+
+    return elapsed ? (uint32_t)(busyCycles() * 1000U / elapsed) : 0;
+}
@@ -0,0 +1,81 @@
+/*
+ *  ======== taskstats.h ========
+ *  Run-time statistics for the scheduler and its tasks.
+ *
+ *  Times are in CPU cycles from cyclecount.h (80 per microsecond). A task
+ *  is released by an interrupt, normally the timer tick, and
+ *  taskStatsRelease() stamps the time; a release before the task has
+ *  started keeps the stamp of the first. Its jitter is the time from that
+ *  stamp to the start of its TickFct when it started in the tick it was
+ *  released in, and its response the time to the end of the TickFct
+ *  however late, the worst case of which is what a control task promises.
+ *  Load is the share of elapsed ticks spent in task code, which is what
+ *  limits how many more tasks fit.
+ *
+ *  Each task's figures are written by the thread that runs it, so the
+ *  tasks may be threads of their own (THERMOSTAT_RTOS).
+ */
+#ifndef TASKSTATS_H_
+#define TASKSTATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef TASKSTATS_MAX
+#define TASKSTATS_MAX 8
+#endif
+
+typedef struct {
+    uint32_t runs;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t maxJitter;     // cycles from the release to the start
+    uint32_t maxResponse;   // cycles from the release to the end
+    uint32_t lateReleases;  // started one or more whole ticks after release
+    uint32_t overruns;      // the next tick fired while the task was running
+    uint32_t skippedReleases; // missed releases its policy did not run
+} TaskStats;
+
+typedef struct {
+    uint32_t passes;        // scheduler wakeups
+    uint32_t ticks;         // timer ticks covered by those passes
+    uint32_t overruns;      // passes still running when the next tick fired
+    uint32_t minLatency;    // cycles from the waking interrupt to the pass
+    uint32_t maxLatency;
+    uint64_t totalLatency;
+    uint64_t busyCycles;    // cycles spent in all tasks
+} SchedStats;
+
+extern void taskStatsInit(uint32_t cyclesPerTick);
+
+/* Interrupt or task level, whenever the scheduler is told to wake */
+extern void taskStatsWake(void);
+
+/* Interrupt level: the tasks in the mask, bit per task, are released now */
+extern void taskStatsRelease(uint32_t tasks);
+
+/* Scheduler: once per pass, after waking, with the ticks since the last */
+extern void taskStatsPass(unsigned long ticks);
+
+/* Timer interrupt of a build without passes (THERMOSTAT_RTOS): one tick */
+extern void taskStatsTick(void);
+
+/* Around each TickFct call, in the thread that runs it */
+extern uint32_t taskStatsTaskStart(unsigned char task);
+extern void taskStatsTaskEnd(unsigned char task, uint32_t start,
+                             unsigned long lateTicks, bool overrun);
+
+/* Scheduler: releases of a late task that were dropped */
+extern void taskStatsSkipped(unsigned char task, unsigned int releases);
+
+/* Scheduler: end of a pass that ran into the next tick */
+extern void taskStatsPassOverrun(void);
+
+extern void taskStatsGet(unsigned char task, TaskStats *out);
+extern void taskStatsGetSched(SchedStats *out);
+
+/* Task cycles per thousand cycles of elapsed ticks */
+extern uint32_t taskStatsLoadPermille(void);
+
+#endif /* TASKSTATS_H_ */
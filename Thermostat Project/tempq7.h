@@ -0,0 +1,36 @@
+/*
+ *  ======== tempq7.h ========
+ *  Integer temperature representation used from the I2C bytes through
+ *  control and telemetry.
+ *
+ *  Temperatures are signed Q8.7 degrees C: one LSB is 1/128 degC, which is
+ *  also the LSB of the TMP11x result register, so a reading needs no
+ *  scaling at all and the range is -256 to +255.99 degC. Nothing here
+ *  touches the floating-point library.
+ */
+#ifndef TEMPQ7_H_
+#define TEMPQ7_H_
+
+#include <stdint.h>
+
+typedef int16_t tempq7_t;
+
+#define TEMP_Q7_SHIFT   7
+#define TEMP_Q7_ONE     (1 << TEMP_Q7_SHIFT)
+
+/* Whole degrees to Q7 */
+#define TEMP_Q7(degrees) ((tempq7_t)((degrees) * TEMP_Q7_ONE))
+
+/* TMP11x result register (MSB first, two's complement) to Q7 */
+static inline tempq7_t tempFromTmp11x(uint8_t msb, uint8_t lsb)
+{
+    return (tempq7_t)(uint16_t)((msb << 8) | lsb);
+}
+
+/* Q7 to whole degrees, rounded toward zero like the old integer report */
+static inline int tempWholeDegrees(tempq7_t t)
+{
+    return t / TEMP_Q7_ONE;
+}
+
+#endif /* TEMPQ7_H_ */
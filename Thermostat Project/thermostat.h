@@ -0,0 +1,32 @@
+/*
+ *  ======== thermostat.h ========
+ *  Application interface of gpiointerrupt.c for the other build targets
+ *  (main_nortos.c, the host simulation).
+ */
+#ifndef THERMOSTAT_H_
+#define THERMOSTAT_H_
+
+#include "tempq7.h"
+
+/* Output format of the UART2Output report */
+enum TELEMETRY_FORMATS {TELEMETRY_ASCII, TELEMETRY_BINARY};
+extern enum TELEMETRY_FORMATS telemetryFormat;
+
+/* When UART2Output reports: every run, or on change with a heartbeat */
+enum TELEMETRY_MODES {TELEMETRY_PERIODIC, TELEMETRY_ON_CHANGE};
+extern enum TELEMETRY_MODES telemetryMode;
+extern tempq7_t telemetryDeadband;     // 1/128 degC the temperature may drift unreported
+
+/* Scheduler tasks */
+extern int changeSetPointTemp(int state);
+extern int startTempRead(int state);
+extern int adjustHeat(int state);
+extern int UART2Output(int state);
+extern int reportTaskStats(int state);
+extern int logHistory(int state);
+extern int runCommands(int state);
+extern int wifiUplink(int state);
+
+extern void *mainThread(void *arg0);
+
+#endif /* THERMOSTAT_H_ */
@@ -0,0 +1,350 @@
+/*
+ *  ======== tlmframe.c ========
+ *  Binary telemetry record codec, see tlmframe.h.
+ *
+ *  Plain C with no driver dependencies so the host decoder can link the
+ *  same code the firmware uses.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tlmframe.h"
+
+/*
+ *  ======== tlmCrc16 ========
+ *  CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF). Computed bitwise: a
+ *  record is only a few bytes, so a 512-byte table is not worth the flash.
+ */
+uint16_t tlmCrc16(const uint8_t *data, size_t len)
+{
+    return tlmCrc16Update(TLM_CRC16_INIT, data, len);
+}
+
+uint16_t tlmCrc16Update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    uint8_t bit;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*
+ *  ======== tlmCobsEncode ========
+ *  Consistent Overhead Byte Stuffing: every zero is replaced by the
+ *  distance to the next one, so the only zero on the wire is the delimiter.
+ */
+size_t tlmCobsEncode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code = 0, o = 1, i;
+
+    for (i = 0; i < len; ++i) {
+        if (in[i] != 0) {
+            out[o++] = in[i];
+            if (o - code < 0xFF) {
+                continue;
+            }
+        }
+        out[code] = (uint8_t)(o - code);
+        code = o++;
+    }
+    out[code] = (uint8_t)(o - code);
+    out[o++] = 0x00;
+    return o;
+}
+
+size_t tlmCobsDecode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        uint8_t n;
+
+        if (code == 0 || i + code - 1 > len) {
+            return 0;
+        }
+        for (n = 1; n < code; ++n) {
+            if (in[i] == 0) {
+                return 0;
+            }
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            out[o++] = 0x00;
+        }
+    }
+    return o;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// A field at offset, 0 if the record ends before it (records only grow)
+static uint16_t getField16(const uint8_t *record, size_t len, size_t offset)
+{
+    return offset + 2 <= len - 2 ? get16(&record[offset]) : 0;
+}
+
+static uint32_t getField32(const uint8_t *record, size_t len, size_t offset)
+{
+    return offset + 4 <= len - 2 ? get32(&record[offset]) : 0;
+}
+
+int tlmRecordType(const uint8_t *record, size_t len)
+{
+    if (len < 3 || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if ((record[0] >> 4) != TLM_VERSION) {
+        return -2;
+    }
+    return record[0] & 0x0F;
+}
+
+size_t tlmPackStatus(const TlmStatus *status, uint8_t *record)
+{
+    record[0] = (TLM_VERSION << 4) | TLM_TYPE_STATUS;
+    put16(&record[1], status->sequence);
+    put32(&record[3], status->uptime);
+    put16(&record[7], (uint16_t)status->temperature);
+    put16(&record[9], (uint16_t)status->setPoint);
+    record[11] = status->flags;
+    put16(&record[12], tlmCrc16(record, 12));
+    return TLM_STATUS_SIZE;
+}
+
+int tlmUnpackStatus(const uint8_t *record, size_t len, TlmStatus *status)
+{
+    if (len < TLM_STATUS_SIZE || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if (record[0] != ((TLM_VERSION << 4) | TLM_TYPE_STATUS)) {
+        return -2;
+    }
+    status->sequence = get16(&record[1]);
+    status->uptime = get32(&record[3]);
+    status->temperature = (int16_t)get16(&record[7]);
+    status->setPoint = (int16_t)get16(&record[9]);
+    status->flags = record[11];
+    return 0;
+}
+
+size_t tlmEncodeStatus(const TlmStatus *status, uint8_t *out)
+{
+    uint8_t record[TLM_STATUS_SIZE];
+
+    tlmPackStatus(status, record);
+    return tlmCobsEncode(record, sizeof(record), out);
+}
+
+size_t tlmPackTask(const TlmTask *task, uint8_t *record)
+{
+    record[0] = (TLM_VERSION << 4) | TLM_TYPE_TASK;
+    record[1] = task->task;
+    put32(&record[2], task->runs);
+    put32(&record[6], task->minCycles);
+    put32(&record[10], task->avgCycles);
+    put32(&record[14], task->maxCycles);
+    put32(&record[18], task->maxJitter);
+    put16(&record[22], task->lateReleases);
+    put16(&record[24], task->overruns);
+    put16(&record[26], task->skippedReleases);
+    put32(&record[28], task->maxResponse);
+    put16(&record[32], tlmCrc16(record, 32));
+    return TLM_TASK_SIZE;
+}
+
+int tlmUnpackTask(const uint8_t *record, size_t len, TlmTask *task)
+{
+    if (len < TLM_TASK_SIZE_MIN || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if (record[0] != ((TLM_VERSION << 4) | TLM_TYPE_TASK)) {
+        return -2;
+    }
+    task->task = record[1];
+    task->runs = get32(&record[2]);
+    task->minCycles = get32(&record[6]);
+    task->avgCycles = get32(&record[10]);
+    task->maxCycles = get32(&record[14]);
+    task->maxJitter = get32(&record[18]);
+    task->lateReleases = get16(&record[22]);
+    task->overruns = get16(&record[24]);
+    task->skippedReleases = getField16(record, len, 26);
+    task->maxResponse = getField32(record, len, 28);
+    return 0;
+}
+
+size_t tlmEncodeTask(const TlmTask *task, uint8_t *out)
+{
+    uint8_t record[TLM_TASK_SIZE];
+
+    tlmPackTask(task, record);
+    return tlmCobsEncode(record, sizeof(record), out);
+}
+
+size_t tlmPackSched(const TlmSched *sched, uint8_t *record)
+{
+    record[0] = (TLM_VERSION << 4) | TLM_TYPE_SCHED;
+    put32(&record[1], sched->passes);
+    put32(&record[5], sched->ticks);
+    put16(&record[9], sched->overruns);
+    put32(&record[11], sched->minLatency);
+    put32(&record[15], sched->avgLatency);
+    put32(&record[19], sched->maxLatency);
+    put16(&record[23], sched->loadPermille);
+    put16(&record[25], tlmCrc16(record, 25));
+    return TLM_SCHED_SIZE;
+}
+
+int tlmUnpackSched(const uint8_t *record, size_t len, TlmSched *sched)
+{
+    if (len < TLM_SCHED_SIZE || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if (record[0] != ((TLM_VERSION << 4) | TLM_TYPE_SCHED)) {
+        return -2;
+    }
+    sched->passes = get32(&record[1]);
+    sched->ticks = get32(&record[5]);
+    sched->overruns = get16(&record[9]);
+    sched->minLatency = get32(&record[11]);
+    sched->avgLatency = get32(&record[15]);
+    sched->maxLatency = get32(&record[19]);
+    sched->loadPermille = get16(&record[23]);
+    return 0;
+}
+
+size_t tlmEncodeSched(const TlmSched *sched, uint8_t *out)
+{
+    uint8_t record[TLM_SCHED_SIZE];
+
+    tlmPackSched(sched, record);
+    return tlmCobsEncode(record, sizeof(record), out);
+}
+
+size_t tlmPackZones(const TlmZones *zones, uint8_t *record)
+{
+    size_t n = zones->count > TLM_ZONES_MAX ? TLM_ZONES_MAX : zones->count, z;
+    uint8_t *p = &record[13];
+
+    record[0] = (TLM_VERSION << 4) | TLM_TYPE_ZONES;
+    put16(&record[1], zones->sequence);
+    put32(&record[3], zones->uptime);
+    record[7] = zones->flags;
+    record[8] = (uint8_t)n;
+    put32(&record[9], zones->heatMask);
+    for (z = 0; z < n; ++z, p += 4) {
+        put16(p, (uint16_t)zones->temperature[z]);
+        put16(p + 2, (uint16_t)zones->setPoint[z]);
+    }
+    put16(p, tlmCrc16(record, (size_t)(p - record)));
+    return TLM_ZONES_SIZE(n);
+}
+
+int tlmUnpackZones(const uint8_t *record, size_t len, TlmZones *zones)
+{
+    const uint8_t *p = &record[13];
+    size_t z;
+
+    if (len < TLM_ZONES_SIZE(1) || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if (record[0] != ((TLM_VERSION << 4) | TLM_TYPE_ZONES)) {
+        return -2;
+    }
+    if (record[8] == 0 || record[8] > TLM_ZONES_MAX || len < TLM_ZONES_SIZE(record[8])) {
+        return -1;
+    }
+    zones->sequence = get16(&record[1]);
+    zones->uptime = get32(&record[3]);
+    zones->flags = record[7];
+    zones->count = record[8];
+    zones->heatMask = get32(&record[9]);
+    for (z = 0; z < zones->count; ++z, p += 4) {
+        zones->temperature[z] = (int16_t)get16(p);
+        zones->setPoint[z] = (int16_t)get16(p + 2);
+    }
+    return 0;
+}
+
+size_t tlmEncodeZones(const TlmZones *zones, uint8_t *out)
+{
+    uint8_t record[TLM_ZONES_SIZE(TLM_ZONES_MAX)];
+
+    return tlmCobsEncode(record, tlmPackZones(zones, record), out);
+}
+
+size_t tlmPackFaults(const TlmFaults *faults, uint8_t *record)
+{
+    record[0] = (TLM_VERSION << 4) | TLM_TYPE_FAULTS;
+    put32(&record[1], faults->failedTransfers);
+    put32(&record[5], faults->timeouts);
+    put32(&record[9], faults->recoveries);
+    put32(&record[13], faults->failSafes);
+    put32(&record[17], faults->failing);
+    put32(&record[21], faults->heatOff);
+    put32(&record[25], faults->spikes);
+    put32(&record[29], faults->jumps);
+    put32(&record[33], faults->outOfRange);
+    put32(&record[37], faults->stuck);
+    put32(&record[41], faults->suspect);
+    put32(&record[45], faults->suspectHeatOff);
+    put16(&record[49], tlmCrc16(record, 49));
+    return TLM_FAULTS_SIZE;
+}
+
+int tlmUnpackFaults(const uint8_t *record, size_t len, TlmFaults *faults)
+{
+    if (len < TLM_FAULTS_SIZE_MIN || tlmCrc16(record, len - 2) != get16(&record[len - 2])) {
+        return -1;
+    }
+    if (record[0] != ((TLM_VERSION << 4) | TLM_TYPE_FAULTS)) {
+        return -2;
+    }
+    faults->failedTransfers = get32(&record[1]);
+    faults->timeouts = get32(&record[5]);
+    faults->recoveries = get32(&record[9]);
+    faults->failSafes = get32(&record[13]);
+    faults->failing = get32(&record[17]);
+    faults->heatOff = get32(&record[21]);
+    faults->spikes = getField32(record, len, 25);
+    faults->jumps = getField32(record, len, 29);
+    faults->outOfRange = getField32(record, len, 33);
+    faults->stuck = getField32(record, len, 37);
+    faults->suspect = getField32(record, len, 41);
+    faults->suspectHeatOff = getField32(record, len, 45);
+    return 0;
+}
+
+size_t tlmEncodeFaults(const TlmFaults *faults, uint8_t *out)
+{
+    uint8_t record[TLM_FAULTS_SIZE];
+
+    tlmPackFaults(faults, record);
+    return tlmCobsEncode(record, sizeof(record), out);
+}
@@ -0,0 +1,238 @@
+/*
+ *  ======== tlmframe.h ========
+ *  Binary telemetry record format, shared by the firmware and the host
+ *  decoder.
+ *
+ *  A record is a little-endian byte string that starts with a header byte
+ *  (version in the high nibble, record type in the low nibble) and ends
+ *  with a CRC-16/CCITT-FALSE over everything before it. On the wire each
+ *  record is COBS encoded and followed by a single 0x00 delimiter, so a
+ *  receiver can resynchronise at any zero byte.
+ *
+ *  Records only grow: a new field goes at the end, before the CRC, and
+ *  TLM_VERSION changes only when a field moves or changes meaning. An
+ *  unpack takes any record of its type at least as long as the first
+ *  layout (TLM_*_SIZE_MIN where the type has grown). Fields the record
+ *  is too short for read as 0, and bytes after the fields it knows are
+ *  skipped, so traces from older firmware still decode and an older
+ *  decoder still reads newer records.
+ *
+ *  Status record (TLM_TYPE_STATUS), 14 bytes before framing:
+ *
+ *      offset  size  field
+ *      0       1     header: TLM_VERSION << 4 | TLM_TYPE_STATUS
+ *      1       2     sequence number, wraps at 65536
+ *      3       4     uptime in seconds
+ *      7       2     temperature, signed, 1/128 degC
+ *      9       2     set point, signed, 1/128 degC
+ *      11      1     flags: TLM_FLAG_HEAT_ON, TLM_FLAG_HEARTBEAT
+ *      12      2     CRC-16 of bytes 0..11
+ *
+ *  Task record (TLM_TYPE_TASK), one per scheduler task, 34 bytes; 28 and
+ *  30 from older firmware, which end before skipped releases and before
+ *  maximum response time:
+ *
+ *      offset  size  field
+ *      0       1     header: TLM_VERSION << 4 | TLM_TYPE_TASK
+ *      1       1     task index
+ *      2       4     runs
+ *      6       4     minimum execution time, CPU cycles
+ *      10      4     average execution time, CPU cycles
+ *      14      4     maximum execution time, CPU cycles
+ *      18      4     maximum release jitter, CPU cycles
+ *      22      2     late releases, saturates at 65535
+ *      24      2     overruns, saturates at 65535
+ *      26      2     skipped releases, saturates at 65535
+ *      28      4     maximum response time, release to end, CPU cycles
+ *      32      2     CRC-16 of bytes 0..31
+ *
+ *  Scheduler record (TLM_TYPE_SCHED), 27 bytes:
+ *
+ *      offset  size  field
+ *      0       1     header: TLM_VERSION << 4 | TLM_TYPE_SCHED
+ *      1       4     scheduler passes
+ *      5       4     timer ticks
+ *      9       2     pass overruns, saturates at 65535
+ *      11      4     minimum wakeup latency, CPU cycles
+ *      15      4     average wakeup latency, CPU cycles
+ *      19      4     maximum wakeup latency, CPU cycles
+ *      23      2     task load, per mille of elapsed time
+ *      25      2     CRC-16 of bytes 0..24
+ *
+ *  Zones record (TLM_TYPE_ZONES), the status of every zone in one report
+ *  when there is more than one, TLM_ZONES_SIZE(n) = 15 + 4n bytes:
+ *
+ *      offset  size  field
+ *      0       1     header: TLM_VERSION << 4 | TLM_TYPE_ZONES
+ *      1       2     sequence number, shared with status records
+ *      3       4     uptime in seconds
+ *      7       1     flags: TLM_FLAG_HEARTBEAT
+ *      8       1     zone count n, 1..TLM_ZONES_MAX
+ *      9       4     heat outputs on, bit per zone
+ *      13      4n    per zone: temperature, set point, signed, 1/128 degC
+ *      13+4n   2     CRC-16 of bytes 0..12+4n
+ *
+ *  Sensor faults record (TLM_TYPE_FAULTS), see sensorfault.h and
+ *  sensorhealth.h, 51 bytes; 27 from older firmware, which ends before
+ *  the reading counts:
+ *
+ *      offset  size  field
+ *      0       1     header: TLM_VERSION << 4 | TLM_TYPE_FAULTS
+ *      1       4     failed I2C transfers
+ *      5       4     transfers cancelled for hanging
+ *      9       4     bus recoveries
+ *      13      4     times a zone's heat was held off
+ *      17      4     zones failing now, bit per zone
+ *      21      4     zones with their heat held off now, bit per zone
+ *      25      4     readings rejected as spikes
+ *      29      4     readings rejected as jumps
+ *      33      4     readings rejected as out of range
+ *      37      4     times a zone's reading was found stuck
+ *      41      4     zones rejecting their readings now, bit per zone
+ *      45      4     ... and of those, the ones with their heat held off
+ *      49      2     CRC-16 of bytes 0..48
+ *
+ *  CPU cycles are 80 MHz core clock cycles (TLM_CYCLES_PER_US).
+ */
+#ifndef TLMFRAME_H_
+#define TLMFRAME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TLM_VERSION         1
+#define TLM_TYPE_STATUS     1
+#define TLM_TYPE_TASK       2
+#define TLM_TYPE_SCHED      3
+#define TLM_TYPE_ZONES      4
+#define TLM_TYPE_FAULTS     5
+
+/* Temperatures on the wire are in TMP11x LSBs: 1/128 degC */
+#define TLM_TEMP_SCALE      128
+
+#define TLM_FLAG_HEAT_ON    0x01
+#define TLM_FLAG_HEARTBEAT  0x02    // on-change mode: nothing changed, proof of life
+
+#define TLM_CYCLES_PER_US   80
+
+#define TLM_STATUS_SIZE     14
+#define TLM_TASK_SIZE       34
+#define TLM_TASK_SIZE_MIN   28
+#define TLM_SCHED_SIZE      27
+#define TLM_ZONES_MAX       32
+#define TLM_ZONES_SIZE(n)   (15 + 4 * (n))
+#define TLM_FAULTS_SIZE     51
+#define TLM_FAULTS_SIZE_MIN 27
+
+/* Largest encoded frame for a record of n bytes: COBS overhead + delimiter */
+#define TLM_FRAME_MAX(n)    ((n) + ((n) / 254) + 2)
+
+typedef struct {
+    uint16_t sequence;
+    uint32_t uptime;        // seconds
+    int16_t  temperature;   // 1/128 degC
+    int16_t  setPoint;      // 1/128 degC
+    uint8_t  flags;
+} TlmStatus;
+
+typedef struct {
+    uint8_t  task;
+    uint32_t runs;
+    uint32_t minCycles;
+    uint32_t avgCycles;
+    uint32_t maxCycles;
+    uint32_t maxJitter;     // cycles
+    uint16_t lateReleases;
+    uint16_t overruns;
+    uint16_t skippedReleases;
+    uint32_t maxResponse;   // cycles
+} TlmTask;
+
+typedef struct {
+    uint32_t passes;
+    uint32_t ticks;
+    uint16_t overruns;
+    uint32_t minLatency;    // cycles
+    uint32_t avgLatency;
+    uint32_t maxLatency;
+    uint16_t loadPermille;
+} TlmSched;
+
+typedef struct {
+    uint16_t sequence;
+    uint32_t uptime;        // seconds
+    uint8_t  flags;
+    uint8_t  count;
+    uint32_t heatMask;      // bit per zone
+    int16_t  temperature[TLM_ZONES_MAX];    // 1/128 degC
+    int16_t  setPoint[TLM_ZONES_MAX];
+} TlmZones;
+
+typedef struct {
+    uint32_t failedTransfers;
+    uint32_t timeouts;
+    uint32_t recoveries;
+    uint32_t failSafes;
+    uint32_t failing;       // bit per zone
+    uint32_t heatOff;       // bit per zone
+    uint32_t spikes;
+    uint32_t jumps;
+    uint32_t outOfRange;
+    uint32_t stuck;
+    uint32_t suspect;       // bit per zone
+    uint32_t suspectHeatOff;    // bit per zone
+} TlmFaults;
+
+#define TLM_CRC16_INIT      0xFFFF
+
+extern uint16_t tlmCrc16(const uint8_t *data, size_t len);
+
+/* Continues a CRC over more bytes: tlmCrc16Update(tlmCrc16(a), b) is the CRC of a then b */
+extern uint16_t tlmCrc16Update(uint16_t crc, const uint8_t *data, size_t len);
+
+/* COBS encode len bytes and append the 0x00 delimiter; returns frame size */
+extern size_t tlmCobsEncode(const uint8_t *in, size_t len, uint8_t *out);
+
+/* Decode one frame without its delimiter; returns 0 if it is malformed */
+extern size_t tlmCobsDecode(const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * Check the CRC and version of a decoded record. Returns its record type,
+ * -1 on a bad CRC or a record too short to have one, -2 on an unknown
+ * version.
+ */
+extern int tlmRecordType(const uint8_t *record, size_t len);
+
+/* Serialise a status record including its CRC; returns TLM_STATUS_SIZE */
+extern size_t tlmPackStatus(const TlmStatus *status, uint8_t *record);
+
+/*
+ * Check the CRC and header of a decoded record and unpack it.
+ * Returns 0 on success, -1 on a bad CRC or a record too short for its
+ * type, -2 on an unknown version or record type.
+ */
+extern int tlmUnpackStatus(const uint8_t *record, size_t len, TlmStatus *status);
+
+/* Pack, encode and delimit a status record; out needs TLM_FRAME_MAX(TLM_STATUS_SIZE) bytes */
+extern size_t tlmEncodeStatus(const TlmStatus *status, uint8_t *out);
+
+/* Task and scheduler records, same conventions as the status record */
+extern size_t tlmPackTask(const TlmTask *task, uint8_t *record);
+extern int tlmUnpackTask(const uint8_t *record, size_t len, TlmTask *task);
+extern size_t tlmEncodeTask(const TlmTask *task, uint8_t *out);
+
+extern size_t tlmPackSched(const TlmSched *sched, uint8_t *record);
+extern int tlmUnpackSched(const uint8_t *record, size_t len, TlmSched *sched);
+extern size_t tlmEncodeSched(const TlmSched *sched, uint8_t *out);
+
+/* Zones record: the size depends on the count; encoding needs
+   TLM_FRAME_MAX(TLM_ZONES_SIZE(count)) bytes */
+extern size_t tlmPackZones(const TlmZones *zones, uint8_t *record);
+extern int tlmUnpackZones(const uint8_t *record, size_t len, TlmZones *zones);
+extern size_t tlmEncodeZones(const TlmZones *zones, uint8_t *out);
+
+extern size_t tlmPackFaults(const TlmFaults *faults, uint8_t *record);
+extern int tlmUnpackFaults(const uint8_t *record, size_t len, TlmFaults *faults);
+extern size_t tlmEncodeFaults(const TlmFaults *faults, uint8_t *out);
+
+#endif /* TLMFRAME_H_ */
@@ -0,0 +1,171 @@
+/*
+ *  ======== tmpsensor.c ========
+ *  TMP sensor drivers, see tmpsensor.h.
+ *
+ *  Plain C with no driver dependencies; gpiointerrupt.c does the register
+ *  accesses the descriptors ask for.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+#include "tmpsensor.h"
+
+static bool fits(uint16_t conversionMs, uint16_t windowMs)
+{
+    return conversionMs + conversionMs / 8 <= windowMs;
+}
+
+/*
+ * ======== TMP116/TMP117 ========
+ */
+
+// Averaging settings: samples, and ms a conversion takes (15.5 ms each)
+static const struct {
+    uint8_t     averages;
+    uint16_t    conversionMs;
+} tmp11xAveraging[] = {
+    { 1, 16 }, { 8, 125 }, { 32, 500 }, { 64, 1000 }
+};
+
+// Device ID register: revision in bits 15..12, 0x116 or 0x117 below
+static bool tmp11xProbe(uint16_t id)
+{
+    return (id & 0x0FFF) == 0x116 || (id & 0x0FFF) == 0x117;
+}
+
+static void tmp11xMode(uint16_t readyMs, uint16_t periodMs, TmpSensorMode *mode)
+{
+    uint8_t i;
+
+    // Deepest averaging that is done before the read; one sample at least
+    for (i = 0; i + 1 < sizeof(tmp11xAveraging) / sizeof(tmp11xAveraging[0]) &&
+                fits(tmp11xAveraging[i + 1].conversionMs, readyMs); ++i) {}
+    mode->configReg = TMP11X_REG_CONFIG;
+    mode->config = TMP11X_MOD_ONE_SHOT | (uint16_t)(i << TMP11X_AVG_SHIFT);
+    mode->oneShot = true;
+    mode->averages = tmp11xAveraging[i].averages;
+    mode->conversionMs = tmp11xAveraging[i].conversionMs;
+}
+
+static tempq7_t tmp11xConvert(const uint8_t result[2], const uint8_t aux[2])
+{
+    return tempFromTmp11x(result[0], result[1]);
+}
+
+const TmpDriver tmp11xDriver = {
+    "TMP11x", TMP11X_REG_DEVICE_ID, tmp11xProbe, TMP11X_REG_RESULT, TMP_REG_NONE,
+    tmp11xMode, tmp11xConvert
+};
+
+/*
+ * ======== TMP006 ========
+ *  Datasheet calibration, with temperatures in Q7 and voltages in pV:
+ *
+ *      S    = S0 (1 + a1 (Tdie - Tref) + a2 (Tdie - Tref)^2)
+ *      Vos  = b0 + b1 (Tdie - Tref) + b2 (Tdie - Tref)^2
+ *      f    = (Vobj - Vos) + c2 (Vobj - Vos)^2
+ *      Tobj = (Tdie^4 + f / S)^(1/4)                      in kelvin
+ *
+ *  S0 = 6.4e-14 V/K^4, a1 = 1.75e-3, a2 = -1.678e-5, b0 = -2.94e-5 V,
+ *  b1 = -5.7e-7 V/K, b2 = 4.63e-9 V/K^2, c2 = 13.4 /V, Tref = 25 degC.
+ */
+#define TMP006_CR_MAX       4       // 2^CR samples...
+#define TMP006_SAMPLE_MS    250     // ... of 250 ms each
+#define TMP006_PV_PER_LSB   156250  // sensor voltage register
+#define KELVIN_Q7           34963   // 273.15 K
+#define TREF_Q7             TEMP_Q7(25)
+#define S_ONE               (1 << 20)   // scale of the S / S0 factor
+
+static bool tmp006Probe(uint16_t id)
+{
+    return id == 0x0067;
+}
+
+static void tmp006Mode(uint16_t readyMs, uint16_t periodMs, TmpSensorMode *mode)
+{
+    uint8_t cr;
+
+    // Continuous: a new result at least once a reading
+    for (cr = 0; cr < TMP006_CR_MAX && fits((TMP006_SAMPLE_MS << (cr + 1)), periodMs); ++cr) {}
+    mode->configReg = TMP006_REG_CONFIG;
+    mode->config = TMP006_MOD_CONTINUOUS | (uint16_t)(cr << TMP006_CR_SHIFT);
+    mode->oneShot = false;
+    mode->averages = (uint8_t)(1u << cr);
+    mode->conversionMs = (uint16_t)(TMP006_SAMPLE_MS << cr);
+}
+
+#define ROOT_STEPS_MAX      8
+
+/*
+ * Fourth root of x, which is Q7 kelvin to the fourth, by Newton's method
+ * from guess. The object is rarely far from the die temperature, so from
+ * there two or three steps settle.
+ */
+static uint32_t fourthRoot(uint64_t x, uint64_t guess)
+{
+    uint64_t t = guess, next;
+    int i;
+
+    for (i = 0; i < ROOT_STEPS_MAX && t != 0; ++i) {
+        next = (3 * t + x / (t * t * t) + 2) / 4;
+        if (next == t) {
+            break;
+        }
+        t = next;
+    }
+    return (uint32_t)t;
+}
+
+tempq7_t tempFromTmp006(int16_t voltage, int16_t die)
+{
+    int32_t dt = die - TREF_Q7;
+    int64_t dt2 = (int64_t)dt * dt;
+    int64_t s, vos, d, dk, f, fs;
+    uint64_t tk, tk4;
+
+    // Scale factors are binary fractions, so the only division is by S:
+    // S / S0 in 1/2^20, a1 * 2^20 / 128 = 14680 / 2^10, a2 * 2^20 / 128^2 = 72070 / 2^26
+    s = S_ONE + ((dt * 14680) >> 10) - ((dt2 * 72070) >> 26);
+
+    // Vos and f in pV: b1 / 128 = 570000 / 2^7, b2 / 128^2 = 4630 / 2^14 pV,
+    // and c2 d^2 with d in 1024 pV is 60348 d^2 / 2^32 pV
+    vos = -29400000 - (((int64_t)dt * 570000) >> 7) + ((dt2 * 4630) >> 14);
+    d = (int64_t)voltage * TMP006_PV_PER_LSB - vos;
+    dk = d / 1024;
+    f = d + ((dk * dk * 60348) >> 32);
+
+    // f / S in K^4 with 28 fraction bits, which is Q7 kelvin to the fourth:
+    // 1e-12 / 6.4e-14 * 2^28 * 2^20 = 1000 * 2^42. Limited to 2^62 so the
+    // sum below fits, about 100 degC either side of the die.
+    fs = f * 1000 / s;
+    if (fs > (1 << 20)) {
+        fs = 1 << 20;
+    } else if (fs < -(1 << 20)) {
+        fs = -(1 << 20);
+    }
+    fs *= (int64_t)1 << 42;
+
+    tk = (uint64_t)(die + KELVIN_Q7);
+    tk4 = (tk * tk) * (tk * tk);
+    if (fs >= 0) {
+        tk4 += (uint64_t)fs;
+    } else if ((uint64_t)-fs < tk4) {
+        tk4 -= (uint64_t)-fs;
+    } else {
+        tk4 = 0;
+    }
+
+    return (tempq7_t)((int32_t)fourthRoot(tk4, tk) - KELVIN_Q7);
+}
+
+static tempq7_t tmp006Convert(const uint8_t result[2], const uint8_t aux[2])
+{
+    return tempFromTmp006((int16_t)(uint16_t)((result[0] << 8) | result[1]),
+                          (int16_t)(uint16_t)((aux[0] << 8) | aux[1]));
+}
+
+const TmpDriver tmp006Driver = {
+    "TMP006", TMP006_REG_DEVICE_ID, tmp006Probe, TMP006_REG_VOLTAGE, TMP006_REG_DIE_TEMP,
+    tmp006Mode, tmp006Convert
+};
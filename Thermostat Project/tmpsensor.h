@@ -0,0 +1,86 @@
+/*
+ *  ======== tmpsensor.h ========
+ *  TMP temperature sensor drivers: one descriptor per part family, chosen
+ *  by the boot scan, saying how to recognise the part, how to configure
+ *  it, which registers a reading takes and how to turn them into Q7.
+ *
+ *  Out of reset a TMP116/TMP117 converts continuously, eight averaged
+ *  samples once a second with standby in between, and a TMP006 converts
+ *  back to back. The thermostat only needs a result when it reads one, so
+ *  a TMP11x is put in one-shot mode: the firmware starts each conversion a
+ *  sensor period before it reads the result, and the part shuts down as
+ *  soon as the conversion is done. The averaging depth is the deepest whose
+ *  conversion finishes in that time, so the part does the filtering and
+ *  the MCU still reads a single register. A TMP006 has no one-shot mode;
+ *  its averaging is set so that a conversion finishes between two reads.
+ *
+ *  A TMP11x result is already Q7. A TMP006 is a thermopile: it measures
+ *  the temperature of what it faces from its sensor voltage and its own
+ *  die temperature, with the fourth-power law of its datasheet. The die
+ *  temperature is read the sweep before the voltage (auxReg), and the
+ *  conversion is done in 64-bit integers, with a fourth root by Newton's
+ *  method from the die temperature; no floating point.
+ */
+#ifndef TMPSENSOR_H_
+#define TMPSENSOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tempq7.h"
+
+/* TMP116/TMP117 registers */
+#define TMP11X_REG_RESULT       0x00
+#define TMP11X_REG_CONFIG       0x01
+#define TMP11X_REG_DEVICE_ID    0x0F
+#define TMP11X_MOD_CONTINUOUS   (0u << 10)
+#define TMP11X_MOD_SHUTDOWN     (1u << 10)
+#define TMP11X_MOD_ONE_SHOT     (3u << 10)
+#define TMP11X_MOD_MASK         (3u << 10)
+#define TMP11X_AVG_SHIFT        5
+#define TMP11X_AVG_MASK         (3u << TMP11X_AVG_SHIFT)
+#define TMP11X_DATA_READY       (1u << 13)
+
+/* TMP006 registers */
+#define TMP006_REG_VOLTAGE      0x00    // sensor voltage, 156.25 nV per LSB
+#define TMP006_REG_DIE_TEMP     0x01    // 14 bits left-justified, 1/32 degC: Q7 as read
+#define TMP006_REG_CONFIG       0x02
+#define TMP006_REG_DEVICE_ID    0xFF
+#define TMP006_MOD_CONTINUOUS   (7u << 12)
+#define TMP006_MOD_MASK         (7u << 12)
+#define TMP006_CR_SHIFT         9
+#define TMP006_CR_MASK          (7u << TMP006_CR_SHIFT)
+
+#define TMP_REG_NONE            0xFF    // TmpDriver.auxReg: a reading is one register
+
+typedef struct {
+    uint8_t     configReg;      // configuration register address
+    uint16_t    config;         // its value; on a one-shot part, writing it starts a conversion
+    bool        oneShot;        // the firmware starts every conversion
+    uint8_t     averages;       // samples averaged into each result
+    uint16_t    conversionMs;   // time one result takes
+} TmpSensorMode;
+
+typedef struct {
+    const char *name;
+    uint8_t     idReg;          // probe: read this register...
+    bool      (*probe)(uint16_t id);   // ... and check it is this part
+    uint8_t     resultReg;      // read for every reading
+    uint8_t     auxReg;         // also read the sweep before, or TMP_REG_NONE
+    /*
+     * The mode for one reading every periodMs, with readyMs from starting
+     * a conversion to reading its result (one-shot parts). A conversion is
+     * given an eighth of its time as margin for the part's oscillator.
+     */
+    void      (*mode)(uint16_t readyMs, uint16_t periodMs, TmpSensorMode *mode);
+    /* Result register bytes (and auxReg bytes), MSB first, to Q7 degC */
+    tempq7_t  (*convert)(const uint8_t result[2], const uint8_t aux[2]);
+} TmpDriver;
+
+extern const TmpDriver tmp11xDriver;   // TMP116, TMP117
+extern const TmpDriver tmp006Driver;
+
+/* TMP006 object temperature from the sensor voltage and die temperature registers */
+extern tempq7_t tempFromTmp006(int16_t voltage, int16_t die);
+
+#endif /* TMPSENSOR_H_ */
@@ -0,0 +1,139 @@
+/*
+ *  ======== txqueue.c ========
+ *  Non-blocking UART transmit queue, see txqueue.h.
+ *
+ *  Producers are the tasks, several of them when each has a thread
+ *  (THERMOSTAT_RTOS), and the consumer is the UART2 write callback.
+ *  Producers only advance head and the callback only advances tail. A
+ *  message is checked, copied in and published with interrupts masked,
+ *  which on one core also keeps a second producer out; a message is at
+ *  most a line, a few microseconds of copying.
+ */
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "txqueue.h"
+
+#define TXQUEUE_MASK (TXQUEUE_SIZE - 1)
+
+#if (TXQUEUE_SIZE & TXQUEUE_MASK) != 0 || TXQUEUE_SIZE > 32768
+#error "TXQUEUE_SIZE must be a power of two no larger than 32768"
+#endif
+
+static UART2_Handle uart;
+static uint8_t ring[TXQUEUE_SIZE];
+static volatile uint16_t head;      // next byte to fill, producers only
+static volatile uint16_t tail;      // next byte to send, callback only
+static volatile uint16_t inFlight;  // bytes handed to the UART, 0 when idle
+static TxQueueStats stats;
+
+/*
+ *  ======== startTransfer ========
+ *  Hands the next contiguous run of the ring to the UART. Called with
+ *  interrupts masked or from the write callback.
+ */
+static void startTransfer(void)
+{
+    uint16_t start, len;
+
+    if (inFlight != 0 || head == tail) {
+        return;
+    }
+    start = tail & TXQUEUE_MASK;
+    len = (uint16_t)(head - tail);
+    if (start + len > TXQUEUE_SIZE) {
+        len = TXQUEUE_SIZE - start;     // stop at the wrap, send the rest next
+    }
+    inFlight = len;
+    if (UART2_write(uart, &ring[start], len, NULL) != UART2_STATUS_SUCCESS) {
+        inFlight = 0;
+    }
+}
+
+void txQueueWriteCallback(UART2_Handle handle, void *buf, size_t count,
+                          void *userArg, int_fast16_t status)
+{
+    // The whole run is released even if the write was cut short
+    tail += inFlight;
+    stats.sentBytes += (uint32_t)count;
+    inFlight = 0;
+    startTransfer();
+}
+
+void txQueueInit(UART2_Handle handle)
+{
+    uart = handle;
+    head = tail = inFlight = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+size_t txQueueWrite(const void *buf, size_t len)
+{
+    uint16_t used, start, first;
+    uintptr_t key;
+
+    key = HwiP_disable();
+    used = (uint16_t)(head - tail);
+    if (uart == NULL || len > (size_t)(TXQUEUE_SIZE - used)) {
+        stats.droppedMessages++;
+        stats.droppedBytes += (uint32_t)len;
+        HwiP_restore(key);
+        return 0;
+    }
+
+    // Copy in at most two pieces around the wrap
+    start = head & TXQUEUE_MASK;
+    first = (uint16_t)(len < (size_t)(TXQUEUE_SIZE - start) ? len : TXQUEUE_SIZE - start);
+    memcpy(&ring[start], buf, first);
+    memcpy(&ring[0], (const uint8_t *)buf + first, len - first);
+
+    head += (uint16_t)len;
+    used = (uint16_t)(head - tail);
+    startTransfer();
+
+    stats.queuedBytes += (uint32_t)len;
+    if (used > stats.highWater) {
+        stats.highWater = used;
+    }
+    HwiP_restore(key);
+    return len;
+}
+
+size_t txQueuePrintf(const char *fmt, ...)
+{
+    char line[TXQUEUE_LINE_MAX];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return 0;
+    }
+    if ((size_t)len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+    return txQueueWrite(line, (size_t)len);
+}
+
+size_t txQueuePending(void)
+{
+    return (uint16_t)(head - tail);
+}
+
+void txQueueGetStats(TxQueueStats *out)
+{
+    uintptr_t key = HwiP_disable();
+
+    *out = stats;
+    HwiP_restore(key);
+}
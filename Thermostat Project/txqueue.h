@@ -0,0 +1,55 @@
+/*
+ *  ======== txqueue.h ========
+ *  Non-blocking UART transmit queue.
+ *
+ *  Tasks append whole messages to a ring buffer and return immediately;
+ *  any number of task threads may write, but not interrupts.
+ *  The ring is drained by UART2 in callback mode (DMA on the CC3220S); each
+ *  completed transfer starts the next one from the write callback.
+ */
+#ifndef TXQUEUE_H_
+#define TXQUEUE_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ti/drivers/UART2.h>
+
+/* Ring size in bytes, must be a power of two; holds a whole stats burst */
+#ifndef TXQUEUE_SIZE
+#define TXQUEUE_SIZE 2048
+#endif
+
+/* Longest message txQueuePrintf() formats */
+#define TXQUEUE_LINE_MAX 96
+
+typedef struct {
+    uint32_t queuedBytes;       // bytes accepted into the ring
+    uint32_t sentBytes;         // bytes the UART has finished sending
+    uint32_t droppedMessages;   // messages refused because the ring was full
+    uint32_t droppedBytes;
+    uint16_t highWater;         // most bytes ever waiting in the ring
+} TxQueueStats;
+
+extern void txQueueInit(UART2_Handle handle);
+
+/*
+ * Overflow policy: a message is queued whole or not at all. When it does
+ * not fit, it is dropped and counted, so lines already queued are never
+ * cut and the caller never waits on the UART.
+ * Returns the number of bytes queued (0 or len).
+ */
+extern size_t txQueueWrite(const void *buf, size_t len);
+extern size_t txQueuePrintf(const char *fmt, ...);
+
+/* Bytes waiting to be sent, including the transfer in flight */
+extern size_t txQueuePending(void);
+
+extern void txQueueGetStats(TxQueueStats *stats);
+
+/* UART2 writeCallback; install it in UART2_Params before UART2_open() */
+extern void txQueueWriteCallback(UART2_Handle handle, void *buf, size_t count,
+                                 void *userArg, int_fast16_t status);
+
+#endif /* TXQUEUE_H_ */
@@ -0,0 +1,291 @@
+/*
+ *  ======== uplink.c ========
+ *  Batched Wi-Fi telemetry uplink, see uplink.h.
+ *
+ *  NoRTOS SimpleLink delivers its asynchronous events from sl_Task(), which
+ *  uplinkRun() calls while a session is open; with an RTOS
+ *  (THERMOSTAT_RTOS) the spawn thread runs it instead. The handlers at the
+ *  bottom only set flags for the state machine to act on. The queue is touched
+ *  at task level only.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Driver Header files */
+#include <ti/drivers/net/wifi/simplelink.h>
+
+#include "nwp.h"
+#include "tlmframe.h"
+#include "uplink.h"
+
+#define UPLINK_MASK (UPLINK_QUEUE - 1)
+
+#if (UPLINK_QUEUE & UPLINK_MASK) != 0 || UPLINK_QUEUE > 32768
+#error "UPLINK_QUEUE must be a power of two no larger than 32768"
+#endif
+
+static enum UPLINK_STATES {UPLINK_IDLE, UPLINK_JOIN, UPLINK_CONNECT, UPLINK_SEND, UPLINK_CLOSE} state;
+
+static TlmStatus queue[UPLINK_QUEUE];
+static uint16_t head;               // next slot to fill
+static uint16_t tail;               // oldest reading
+static uint16_t sendNext;           // next reading of the batch to frame
+static uint16_t batchEnd;           // head when the batch started
+
+static uint8_t frame[TLM_FRAME_MAX(TLM_STATUS_SIZE)];
+static size_t frameLen;
+static size_t framePos;             // bytes of frame already sent
+
+static _i16 sd = -1;                // collector socket
+static uint32_t sessionStart;
+static uint32_t progressAt;         // uptime the socket last took data, while sending
+static uint32_t nextSession;        // uptime of the next attempt
+static uint32_t retryDelay = UPLINK_RETRY_S;
+static volatile bool connected;     // set by the event handlers
+static volatile bool ipAcquired;
+static UplinkStats stats;
+
+void uplinkInit(void)
+{
+    head = tail = 0;
+    state = UPLINK_IDLE;
+    sd = -1;
+    nextSession = UPLINK_BATCH_S;
+    retryDelay = UPLINK_RETRY_S;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void uplinkQueue(const TlmStatus *status)
+{
+    if ((uint16_t)(head - tail) >= UPLINK_QUEUE) {
+        stats.dropped++;
+        if (state != UPLINK_IDLE) {
+            return;         // the batch in flight owns the oldest readings
+        }
+        tail++;
+    }
+    queue[head & UPLINK_MASK] = *status;
+    head++;
+    stats.queued++;
+}
+
+// End the session; the batch stays queued unless it was delivered
+static void endSession(uint32_t uptime, bool delivered)
+{
+    NwpStats nwp;
+
+    if (sd >= 0) {
+        if (sl_Close(sd) < 0) {
+            delivered = false;
+        }
+        sd = -1;
+    }
+    nwpRelease();
+    nwpGetStats(&nwp);
+    if (nwp.users == 0) {
+        connected = ipAcquired = false;
+    }
+
+    if (delivered) {
+        stats.delivered += (uint16_t)(batchEnd - tail);
+        tail = batchEnd;
+        retryDelay = UPLINK_RETRY_S;
+        nextSession = uptime + UPLINK_BATCH_S;
+    } else {
+        stats.failures++;
+        nextSession = uptime + retryDelay;
+        retryDelay = retryDelay * 2 > UPLINK_RETRY_MAX_S ? UPLINK_RETRY_MAX_S : retryDelay * 2;
+    }
+    state = UPLINK_IDLE;
+}
+
+// Sends from the current frame onwards; false if the socket failed
+static bool sendBatch(uint32_t uptime)
+{
+    size_t budget = UPLINK_SEND_MAX;
+    _i16 n;
+
+    while (budget > 0) {
+        if (framePos == frameLen) {
+            if (sendNext == batchEnd) {
+                state = UPLINK_CLOSE;
+                return true;
+            }
+            frameLen = tlmEncodeStatus(&queue[sendNext & UPLINK_MASK], frame);
+            framePos = 0;
+            sendNext++;
+        }
+        n = sl_Send(sd, &frame[framePos], (_i16)(frameLen - framePos), 0);
+        if (n == SL_ERROR_BSD_EAGAIN) {
+            return true;    // socket buffers full, carry on next run
+        }
+        if (n <= 0) {
+            return false;
+        }
+        framePos += (size_t)n;
+        stats.bytes += (uint32_t)n;
+        progressAt = uptime;
+        budget = (size_t)n < budget ? budget - (size_t)n : 0;
+    }
+    return true;
+}
+
+void uplinkRun(uint32_t uptime)
+{
+    SlSockAddrIn_t addr;
+    NwpStats nwp;
+    SlSockNonblocking_t nonBlocking = {.NonBlockingEnabled = 1};
+    _i16 rc;
+
+    if (state != UPLINK_IDLE) {
+#if !defined(THERMOSTAT_RTOS)
+        sl_Task(NULL);      // deliver pending SimpleLink events
+#endif
+        // Joining and connecting have a deadline; sending has one that
+        // moves on whenever the socket takes data
+        if (uptime - (state == UPLINK_SEND || state == UPLINK_CLOSE ? progressAt : sessionStart) >=
+            UPLINK_TIMEOUT_S) {
+            endSession(uptime, false);
+            return;
+        }
+        if (state != UPLINK_JOIN && !connected) {
+            endSession(uptime, false);  // the access point went away
+            return;
+        }
+    }
+
+    switch (state) {
+    case UPLINK_IDLE:
+        if (head == tail ||
+            ((int32_t)(uptime - nextSession) < 0 && (uint16_t)(head - tail) < UPLINK_QUEUE * 3 / 4)) {
+            break;
+        }
+        nwpGetStats(&nwp);
+        if (!nwpAcquire()) {
+            stats.failures++;
+            nextSession = uptime + retryDelay;
+            break;
+        }
+        if (nwp.users == 0) {
+            connected = ipAcquired = false;     // fresh start, nothing joined yet
+        }
+        // Join the stored profiles on our own; the NWP keeps the policy
+        sl_WlanPolicySet(SL_WLAN_POLICY_CONNECTION, SL_WLAN_CONNECTION_POLICY(1, 0, 0, 0), NULL, 0);
+        stats.sessions++;
+        sessionStart = uptime;
+        state = UPLINK_JOIN;
+        break;
+
+    case UPLINK_JOIN:
+        if (!ipAcquired) {
+            break;
+        }
+        sd = sl_Socket(SL_AF_INET, SL_SOCK_STREAM, SL_IPPROTO_TCP);
+        if (sd < 0 ||
+            sl_SetSockOpt(sd, SL_SOL_SOCKET, SL_SO_NONBLOCKING, &nonBlocking, sizeof(nonBlocking)) < 0) {
+            endSession(uptime, false);
+            break;
+        }
+        state = UPLINK_CONNECT;
+        // fall through: start connecting now
+
+    case UPLINK_CONNECT:
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = SL_AF_INET;
+        addr.sin_port = sl_Htons(UPLINK_COLLECTOR_PORT);
+        addr.sin_addr.s_addr = sl_Htonl(UPLINK_COLLECTOR_IP);
+        rc = sl_Connect(sd, (SlSockAddr_t *)&addr, sizeof(addr));
+        if (rc == SL_ERROR_BSD_EALREADY) {
+            break;          // still connecting
+        }
+        if (rc < 0) {
+            endSession(uptime, false);
+            break;
+        }
+        // The batch is what is queued now; a leading delimiter ends any
+        // partial frame the collector might hold
+        batchEnd = head;
+        sendNext = tail;
+        frame[0] = 0;
+        frameLen = 1;
+        framePos = 0;
+        progressAt = uptime;
+        state = UPLINK_SEND;
+        // fall through: start sending now
+
+    case UPLINK_SEND:
+        if (!sendBatch(uptime)) {
+            endSession(uptime, false);
+        }
+        break;
+
+    case UPLINK_CLOSE:
+        endSession(uptime, true);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void uplinkGetStats(UplinkStats *out)
+{
+    *out = stats;
+    out->pending = (uint16_t)(head - tail);
+}
+
+/*
+ *  ======== SimpleLink Event Handlers ========
+ *  Called from sl_Task(). The host driver requires all of them.
+ */
+void SimpleLinkWlanEventHandler(SlWlanEvent_t *pWlanEvent)
+{
+    switch (pWlanEvent->Id) {
+    case SL_WLAN_EVENT_CONNECT:
+        connected = true;
+        break;
+    case SL_WLAN_EVENT_DISCONNECT:
+        connected = false;
+        ipAcquired = false;
+        break;
+    default:
+        break;
+    }
+}
+
+void SimpleLinkNetAppEventHandler(SlNetAppEvent_t *pNetAppEvent)
+{
+    if (pNetAppEvent != NULL && pNetAppEvent->Id == SL_NETAPP_EVENT_IPV4_ACQUIRED) {
+        ipAcquired = true;
+    }
+}
+
+void SimpleLinkGeneralEventHandler(SlDeviceEvent_t *pDevEvent)
+{
+}
+
+void SimpleLinkSockEventHandler(SlSockEvent_t *pSock)
+{
+}
+
+void SimpleLinkFatalErrorEventHandler(SlDeviceFatal_t *slFatalErrorEvent)
+{
+    connected = false;
+    ipAcquired = false;
+}
+
+void SimpleLinkHttpServerEventHandler(SlNetAppHttpServerEvent_t *pHttpEvent,
+                                      SlNetAppHttpServerResponse_t *pHttpResponse)
+{
+}
+
+void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
+                                         SlNetAppResponse_t *pNetAppResponse)
+{
+}
+
+void SimpleLinkNetAppRequestMemFreeEventHandler(_u8 *buffer)
+{
+}
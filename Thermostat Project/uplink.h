@@ -0,0 +1,75 @@
+/*
+ *  ======== uplink.h ========
+ *  Batched Wi-Fi telemetry uplink with store-and-forward.
+ *
+ *  Readings are queued in RAM as they are taken. Every UPLINK_BATCH_S, or
+ *  sooner when the queue is filling, one radio session starts the NWP,
+ *  waits for the stored Wi-Fi profile to connect, opens a TCP connection
+ *  to the collector and sends every queued reading as status frames
+ *  (tlmframe.h: COBS framed, 0x00 delimited, the same stream the UART
+ *  carries in binary mode), then shuts the NWP down again. Joining the
+ *  network costs far more energy than the readings, so the radio is woken
+ *  once per batch instead of once per reading.
+ *
+ *  Readings leave the queue only when their session has closed cleanly.
+ *  A session that fails anywhere keeps them for the next attempt, retried
+ *  after UPLINK_RETRY_S and then at doubling intervals. A collector that
+ *  connects but stops reading fails the session once the socket has taken
+ *  nothing for UPLINK_TIMEOUT_S, so the radio does not stay up for it. When the queue is
+ *  full between sessions the oldest reading gives way; during a session
+ *  the new one is dropped instead. Both are counted.
+ *
+ *  Every step is non-blocking: uplinkRun() advances the session by one
+ *  state per call and returns, so it can run from a scheduler task.
+ *  The Wi-Fi profile is provisioned separately (SmartConfig, or
+ *  sl_WlanProfileAdd at the factory) and the connection policy set here
+ *  makes the NWP join it on its own.
+ */
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tlmframe.h"
+
+#ifndef UPLINK_QUEUE
+#define UPLINK_QUEUE        256     // readings held between sessions, a power of two
+#endif
+#define UPLINK_SAMPLE_S     10      // seconds between queued readings
+#define UPLINK_BATCH_S      300     // seconds between sessions
+#define UPLINK_RETRY_S      30      // first retry after a failed session
+#define UPLINK_RETRY_MAX_S  1800
+#define UPLINK_TIMEOUT_S    20      // longest a session may take to join and connect,
+                                    // or go without the socket taking a byte
+#define UPLINK_SEND_MAX     1024    // bytes handed to the socket per uplinkRun()
+
+/* Collector address, overridden by the build */
+#ifndef UPLINK_COLLECTOR_IP
+#define UPLINK_COLLECTOR_IP     SL_IPV4_VAL(192, 168, 1, 10)
+#endif
+#ifndef UPLINK_COLLECTOR_PORT
+#define UPLINK_COLLECTOR_PORT   5000
+#endif
+
+typedef struct {
+    uint32_t queued;        // readings accepted
+    uint32_t dropped;       // readings lost to a full queue
+    uint32_t delivered;     // readings sent in a session that closed cleanly
+    uint32_t sessions;      // sessions started
+    uint32_t failures;      // sessions that ended without delivering
+    uint32_t bytes;         // bytes sent, failed sessions included
+    uint16_t pending;       // readings waiting now
+} UplinkStats;
+
+extern void uplinkInit(void);
+
+/* Adds a reading to the next batch */
+extern void uplinkQueue(const TlmStatus *status);
+
+/* Call once a second with the uptime in seconds; steps the session */
+extern void uplinkRun(uint32_t uptime);
+
+extern void uplinkGetStats(UplinkStats *out);
+
+#endif /* UPLINK_H_ */
@@ -0,0 +1,72 @@
+/*
+ *  ======== zones.c ========
+ *  Heating zone state and control sweep, see zones.h.
+ *
+ *  Plain C with no driver dependencies, so the host benchmark links the
+ *  same sweep the firmware runs.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "heatctl.h"
+#include "tempq7.h"
+#include "zones.h"
+
+void zonesInit(ZoneSet *zones)
+{
+    memset(zones, 0, sizeof(*zones));
+}
+
+int zonesAdd(ZoneSet *zones, uint8_t address, uint8_t resultReg,
+             uint_least8_t output, int8_t setPoint)
+{
+    uint8_t z = zones->count;
+
+    if (z == ZONES_MAX) {
+        return -1;
+    }
+    zones->address[z] = address;
+    zones->resultReg[z] = resultReg;
+    zones->output[z] = output;
+    zones->setPoint[z] = setPoint;
+    zones->temperature[z] = TEMP_Q7(setPoint);  // shown until it reads
+    heatCtlInit(&zones->control[z]);
+    zones->unread |= ZONE_BIT(z);
+    zones->heatMask &= ~ZONE_BIT(z);
+    zones->count = z + 1;
+    return z;
+}
+
+void zonesStepSetPoint(ZoneSet *zones, uint8_t zone, int delta)
+{
+    int setPoint = zones->setPoint[zone] + delta;
+
+    if (setPoint > ZONE_SET_POINT_MAX) {
+        setPoint = ZONE_SET_POINT_MAX;
+    } else if (setPoint < ZONE_SET_POINT_MIN) {
+        setPoint = ZONE_SET_POINT_MIN;
+    }
+    zones->setPoint[zone] = (int8_t)setPoint;
+}
+
+void zonesControl(ZoneSet *zones, const tempq7_t reading[], uint32_t fresh, uint32_t nowMs)
+{
+    uint32_t heat = 0, held;
+    unsigned z, n = zones->count;
+
+    zones->unread &= ~fresh;
+    held = zones->heatOff | zones->unread;
+    for (z = 0; z < n; ++z) {
+        if (fresh & ZONE_BIT(z)) {
+            zones->temperature[z] = reading[z];
+        }
+        if (held & ZONE_BIT(z)) {
+            heatCtlHold(&zones->control[z], nowMs);
+        } else {
+            heat |= (uint32_t)heatCtlUpdate(&zones->control[z], zones->temperature[z],
+                                            TEMP_Q7(zones->setPoint[z]), nowMs) << z;
+        }
+    }
+    zones->heatMask = heat;
+}
@@ -0,0 +1,75 @@
+/*
+ *  ======== zones.h ========
+ *  Heating zones: one sensor, set point and heat output each.
+ *
+ *  The zone state is kept as a structure of arrays, one array per field
+ *  indexed by zone, with the heat outputs packed into a bit mask. The
+ *  control sweep only touches the temperature, set point and controller
+ *  arrays, one heatctl.h update per zone, so no addresses or GPIO indices
+ *  come along for the ride. One word holds every output for the report.
+ */
+#ifndef ZONES_H_
+#define ZONES_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "heatctl.h"
+#include "tempq7.h"
+
+#ifndef ZONES_MAX
+#define ZONES_MAX       4       // zones the arrays hold
+#endif
+
+#if ZONES_MAX < 1 || ZONES_MAX > 32
+#error "ZONES_MAX must be 1..32, the zone masks are 32 bits"
+#endif
+
+#define ZONE_BIT(zone)  ((uint32_t)1 << (zone))
+
+#define ZONE_SET_POINT_MIN  10  // degC, the range the buttons and commands allow
+#define ZONE_SET_POINT_MAX  40
+
+typedef struct {
+    uint8_t         count;                  // zones in use
+    uint32_t        heatMask;               // outputs on, bit per zone
+    uint32_t        heatOff;                // outputs held off whatever the reading
+    uint32_t        unread;                 // zones without a reading yet, held off too
+    tempq7_t        temperature[ZONES_MAX]; // last good reading, 1/128 degC
+    int8_t          setPoint[ZONES_MAX];    // degC
+    uint8_t         address[ZONES_MAX];     // sensor I2C address
+    uint8_t         resultReg[ZONES_MAX];   // sensor result register
+    uint_least8_t   output[ZONES_MAX];      // heat output GPIO index
+    HeatCtl         control[ZONES_MAX];     // controller state
+} ZoneSet;
+
+extern void zonesInit(ZoneSet *zones);
+
+/* Adds a zone with its heat off; returns its index, or -1 when full */
+extern int zonesAdd(ZoneSet *zones, uint8_t address, uint8_t resultReg,
+                    uint_least8_t output, int8_t setPoint);
+
+/* A button press: moves a zone's set point by delta degC, within the range */
+extern void zonesStepSetPoint(ZoneSet *zones, uint8_t zone, int delta);
+
+/*
+ * One control sweep at nowMs, the scheduler's clock in ms. Zones whose
+ * bit is set in fresh take their new reading from reading[]; the others
+ * keep their last one. Then each zone's controller sets its output in
+ * heatMask, except that a zone whose bit is set in heatOff, or that has
+ * never read, is held off.
+ */
+extern void zonesControl(ZoneSet *zones, const tempq7_t reading[], uint32_t fresh, uint32_t nowMs);
+
+/* Bit per zone in use */
+static inline uint32_t zonesMask(const ZoneSet *zones)
+{
+    return zones->count >= 32 ? UINT32_MAX : ZONE_BIT(zones->count) - 1;
+}
+
+static inline bool zoneHeatOn(const ZoneSet *zones, uint8_t zone)
+{
+    return (zones->heatMask & ZONE_BIT(zone)) != 0;
+}
+
+#endif /* ZONES_H_ */